@@ -0,0 +1,134 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// base64url encode/decode throughput from 16 B to 64 KB, both allocating
+// std::string API and caller buffer API used on hot paths.
+
+#include <benchmark/benchmark.h>
+
+#include <jwtpp/jwtpp.hh>
+
+#include "fixtures.hh"
+
+namespace {
+
+std::string payload(size_t size) {
+	std::string s(size, '\0');
+
+	for (size_t i = 0; i < size; i++) {
+		s[i] = static_cast<char>((i * 131) ^ (i >> 3));
+	}
+
+	return s;
+}
+
+void BM_b64_encode_uri(benchmark::State &state) {
+	auto in = payload(static_cast<size_t>(state.range(0)));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::b64::encode_uri(in));
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+void BM_b64_encode_uri_buffer(benchmark::State &state) {
+	auto        in = payload(static_cast<size_t>(state.range(0)));
+	std::string out(jwtpp::b64::encoded_uri_size(in.size()), '\0');
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::b64::encode_uri(reinterpret_cast<const uint8_t *>(in.data()), in.size(), &out[0]));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+void BM_b64_decode_uri(benchmark::State &state) {
+	auto in = jwtpp::b64::encode_uri(payload(static_cast<size_t>(state.range(0))));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::b64::decode_uri(in));
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+void BM_b64_decode_uri_buffer(benchmark::State &state) {
+	auto                 in = jwtpp::b64::encode_uri(payload(static_cast<size_t>(state.range(0))));
+	std::vector<uint8_t> out(static_cast<size_t>(state.range(0)));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		size_t size = out.size();
+		benchmark::DoNotOptimize(jwtpp::b64::decode_uri(in.data(), in.size(), out.data(), size));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+void BM_b64_encode(benchmark::State &state) {
+	auto in = payload(static_cast<size_t>(state.range(0)));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::b64::encode(in));
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+void BM_b64_decode(benchmark::State &state) {
+	auto in = jwtpp::b64::encode(payload(static_cast<size_t>(state.range(0))));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::b64::decode(in));
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+} // namespace
+
+BENCHMARK(BM_b64_encode_uri)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_b64_encode_uri_buffer)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_b64_decode_uri)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_b64_decode_uri_buffer)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_b64_encode)->RangeMultiplier(4)->Range(16, 64 << 10);
+BENCHMARK(BM_b64_decode)->RangeMultiplier(4)->Range(16, 64 << 10);
@@ -0,0 +1,167 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Coroutine sign/verify against blocking jws API under high concurrency.
+// Blocking variant occupies one caller thread per in-flight token, coroutine
+// variant keeps all tokens in flight from a single caller thread.
+
+#include <benchmark/benchmark.h>
+
+#include <jwtpp/coro.hh>
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+
+struct detached {
+	struct promise_type {
+		detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+// resumes coroutine right on the pool worker
+struct inline_resume {
+	template <typename F>
+	void post(F &&f) { f(); }
+};
+
+class latch {
+public:
+	explicit latch(size_t n) : _n(n) {}
+
+	void count_down() {
+		std::lock_guard<std::mutex> l(_lock);
+		if (--_n == 0) {
+			_cv.notify_one();
+		}
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> l(_lock);
+		_cv.wait(l, [this]() { return _n == 0; });
+	}
+
+private:
+	std::mutex              _lock;
+	std::condition_variable _cv;
+	size_t                  _n;
+};
+
+jwtpp::sp_crypto rs256() {
+	static auto c = std::make_shared<jwtpp::rsa>(jwtpp::rsa::gen(2048), jwtpp::alg_t::RS256);
+	return c;
+}
+
+jwtpp::sp_claims claims() {
+	auto cl = std::make_shared<jwtpp::claims>();
+	cl->set().iss("https://issuer.example");
+	cl->set().sub("alice");
+	return cl;
+}
+
+const std::string &bearer() {
+	static std::string b = jwtpp::jws::sign_bearer(*claims(), rs256());
+	return b;
+}
+
+void BM_verify_blocking(benchmark::State &state) {
+	auto c = rs256();
+	auto b = bearer();
+
+	for (auto _ : state) {
+		auto j = jwtpp::jws::parse(b);
+		benchmark::DoNotOptimize(j->verify(c));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_verify_coro(benchmark::State &state) {
+	auto              c = rs256();
+	auto              b = bearer();
+	auto              in_flight = static_cast<size_t>(state.range(0));
+	inline_resume     r;
+
+	for (auto _ : state) {
+		latch done(in_flight);
+
+		for (size_t i = 0; i < in_flight; i++) {
+			[&]() -> detached {
+				benchmark::DoNotOptimize(co_await jwtpp::async_verify(b, c, r));
+				done.count_down();
+			}();
+		}
+
+		done.wait();
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(in_flight));
+}
+
+void BM_sign_blocking(benchmark::State &state) {
+	auto c  = rs256();
+	auto cl = claims();
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::jws::sign_claims(*cl, c));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_sign_coro(benchmark::State &state) {
+	auto              c  = rs256();
+	auto              cl = claims();
+	auto              in_flight = static_cast<size_t>(state.range(0));
+	inline_resume     r;
+
+	for (auto _ : state) {
+		latch done(in_flight);
+
+		for (size_t i = 0; i < in_flight; i++) {
+			[&]() -> detached {
+				benchmark::DoNotOptimize(co_await jwtpp::async_sign_claims(cl, c, r));
+				done.count_down();
+			}();
+		}
+
+		done.wait();
+	}
+
+	state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(in_flight));
+}
+
+} // namespace
+
+BENCHMARK(BM_verify_blocking)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_verify_coro)->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+BENCHMARK(BM_sign_blocking)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_sign_coro)->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+
+#endif // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
@@ -0,0 +1,122 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// jws::sign_claims and jws::verify for every alg_t and key size, scaling
+// of single sp_crypto shared by 1..N threads and jws::sign_batch. Benchmarks are named
+// BM_<op>/<alg>/<bits> so results stay comparable between releases.
+
+#include <benchmark/benchmark.h>
+
+#include <jwtpp/jwtpp.hh>
+
+#include "fixtures.hh"
+
+namespace {
+
+void sign(benchmark::State &state, bench::key_spec s) {
+	auto c  = bench::crypto(s);
+	auto cl = bench::claims();
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::jws::sign_claims(*cl, c));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	bench::report_allocs(state, allocs);
+}
+
+void verify(benchmark::State &state, bench::key_spec s) {
+	auto c     = bench::crypto(s);
+	auto token = jwtpp::jws::sign_bearer(*bench::claims(), c);
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		auto j = jwtpp::jws::parse(token);
+		if (!j->verify(c)) {
+			state.SkipWithError("verify failed");
+			break;
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	bench::report_allocs(state, allocs);
+}
+
+// jws::sign_batch of state.range(0) tokens, items are tokens
+void sign_batch(benchmark::State &state, bench::key_spec s) {
+	auto c = bench::crypto(s);
+
+	std::vector<jwtpp::claims> cls(static_cast<size_t>(state.range(0)), *bench::claims());
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::jws::sign_batch(cls, c));
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	bench::report_allocs(state, allocs);
+}
+
+const std::vector<bench::key_spec> &scaling_specs() {
+	static const std::vector<bench::key_spec> specs = {
+		{jwtpp::alg_t::HS256, 256},
+		{jwtpp::alg_t::RS256, 2048},
+		{jwtpp::alg_t::ES256, 256},
+		{jwtpp::alg_t::PS256, 2048},
+	};
+
+	return specs;
+}
+
+std::string bench_name(const char *op, const bench::key_spec &s) {
+	return std::string("BM_") + op + "/" + jwtpp::crypto::alg2str(s.alg) + "/" + std::to_string(s.bits);
+}
+
+bool register_all() {
+	for (const auto &s : bench::key_specs()) {
+		benchmark::RegisterBenchmark(bench_name("sign", s).c_str(), sign, s);
+		benchmark::RegisterBenchmark(bench_name("verify", s).c_str(), verify, s);
+	}
+
+	// all threads hit the same crypto object, as servers usually do
+	for (const auto &s : scaling_specs()) {
+		benchmark::RegisterBenchmark(bench_name("sign_shared", s).c_str(), sign, s)
+			->ThreadRange(1, bench::max_threads())
+			->UseRealTime();
+		benchmark::RegisterBenchmark(bench_name("verify_shared", s).c_str(), verify, s)
+			->ThreadRange(1, bench::max_threads())
+			->UseRealTime();
+		benchmark::RegisterBenchmark(bench_name("sign_batch", s).c_str(), sign_batch, s)
+			->Arg(64)
+			->UseRealTime();
+	}
+
+	return true;
+}
+
+const bool registered = register_all();
+
+} // namespace
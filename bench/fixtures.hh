@@ -0,0 +1,169 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Keys, claims and tokens shared by benchmarks. Key generation is expensive
+// (RSA 4096 especially) so every key is made once, on first use.
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <openssl/obj_mac.h>
+
+#include <benchmark/benchmark.h>
+
+#include <jwtpp/jwtpp.hh>
+
+#include "alloc_hook.hh"
+
+namespace bench {
+
+struct key_spec {
+	jwtpp::alg_t alg;
+	int          bits;
+};
+
+/**
+ * \brief Every supported algorithm with key sizes worth comparing
+ *
+ * HMAC: secret size in bits, RSA/PSS: modulus size, ECDSA/EdDSA: curve size
+ */
+inline const std::vector<key_spec> &key_specs() {
+	static const std::vector<key_spec> specs = {
+		{jwtpp::alg_t::HS256, 256},
+		{jwtpp::alg_t::HS384, 384},
+		{jwtpp::alg_t::HS512, 512},
+		{jwtpp::alg_t::RS256, 2048},
+		{jwtpp::alg_t::RS256, 3072},
+		{jwtpp::alg_t::RS256, 4096},
+		{jwtpp::alg_t::RS384, 2048},
+		{jwtpp::alg_t::RS384, 3072},
+		{jwtpp::alg_t::RS384, 4096},
+		{jwtpp::alg_t::RS512, 2048},
+		{jwtpp::alg_t::RS512, 3072},
+		{jwtpp::alg_t::RS512, 4096},
+		{jwtpp::alg_t::ES256, 256},
+		{jwtpp::alg_t::ES384, 384},
+		{jwtpp::alg_t::ES512, 521},
+		{jwtpp::alg_t::PS256, 2048},
+		{jwtpp::alg_t::PS256, 3072},
+		{jwtpp::alg_t::PS256, 4096},
+		{jwtpp::alg_t::PS384, 2048},
+		{jwtpp::alg_t::PS384, 3072},
+		{jwtpp::alg_t::PS384, 4096},
+		{jwtpp::alg_t::PS512, 2048},
+		{jwtpp::alg_t::PS512, 3072},
+		{jwtpp::alg_t::PS512, 4096},
+#if defined(JWTPP_SUPPORTED_EDDSA)
+		{jwtpp::alg_t::EdDSA, 255},
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	};
+
+	return specs;
+}
+
+inline jwtpp::sp_crypto make_crypto(const key_spec &s) {
+	switch (s.alg) {
+	case jwtpp::alg_t::HS256:
+	case jwtpp::alg_t::HS384:
+	case jwtpp::alg_t::HS512:
+		return std::make_shared<jwtpp::hmac>(jwtpp::secure_string(static_cast<size_t>(s.bits / 8), 'k'), s.alg);
+	case jwtpp::alg_t::RS256:
+	case jwtpp::alg_t::RS384:
+	case jwtpp::alg_t::RS512:
+		return std::make_shared<jwtpp::rsa>(jwtpp::rsa::gen(s.bits), s.alg);
+	case jwtpp::alg_t::ES256:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), s.alg);
+	case jwtpp::alg_t::ES384:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_secp384r1), s.alg);
+	case jwtpp::alg_t::ES512:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_secp521r1), s.alg);
+	case jwtpp::alg_t::PS256:
+	case jwtpp::alg_t::PS384:
+	case jwtpp::alg_t::PS512:
+		return std::make_shared<jwtpp::pss>(jwtpp::rsa::gen(s.bits), s.alg);
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	case jwtpp::alg_t::EdDSA:
+		return std::make_shared<jwtpp::eddsa>(jwtpp::eddsa::gen(), s.alg);
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	default:
+		throw std::invalid_argument("unsupported alg");
+	}
+}
+
+/**
+ * \brief Cached crypto for given spec, safe to call from benchmark threads
+ */
+inline jwtpp::sp_crypto crypto(const key_spec &s) {
+	static std::mutex                                             lock;
+	static std::map<std::pair<jwtpp::alg_t, int>, jwtpp::sp_crypto> cache;
+
+	std::lock_guard<std::mutex> l(lock);
+
+	auto &c = cache[std::make_pair(s.alg, s.bits)];
+	if (!c) {
+		c = make_crypto(s);
+	}
+
+	return c;
+}
+
+/**
+ * \brief Claims set typical for access token
+ */
+inline jwtpp::sp_claims claims() {
+	auto cl = std::make_shared<jwtpp::claims>();
+
+	cl->set().iss("https://issuer.example");
+	cl->set().sub("alice");
+	cl->set().aud("https://api.example");
+	cl->set().exp("4102444800");
+	cl->set().iat("1600000000");
+	cl->set().jti("0f8fad5b-d9cb-469f-a165-70867728950e");
+	cl->set().any("scope", "read write");
+
+	return cl;
+}
+
+/**
+ * \brief Report heap allocations per iteration made since s was created
+ */
+inline void report_allocs(benchmark::State &state, const alloc_hook::scope &s) {
+	state.counters["allocs"] = benchmark::Counter(static_cast<double>(s.allocs()), benchmark::Counter::kAvgIterations);
+	state.counters["alloc_bytes"] = benchmark::Counter(static_cast<double>(s.bytes()), benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * \brief Upper bound for thread scaling benchmarks
+ */
+inline int max_threads() {
+	auto n = static_cast<int>(std::thread::hardware_concurrency());
+
+	return n < 2 ? 2 : n * 2;
+}
+
+} // namespace bench
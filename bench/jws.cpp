@@ -0,0 +1,118 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Token plumbing without crypto: claims construction and serialization,
+// jws::parse of a typical access token.
+
+#include <benchmark/benchmark.h>
+
+#include <openssl/rand.h>
+
+#include <jwtpp/jwtpp.hh>
+
+#include "fixtures.hh"
+
+namespace {
+
+void BM_claims_construct(benchmark::State &state) {
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(bench::claims());
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	bench::report_allocs(state, allocs);
+}
+
+void BM_claims_b64(benchmark::State &state) {
+	auto cl = bench::claims();
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(cl->b64());
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	bench::report_allocs(state, allocs);
+}
+
+void BM_claims_from_b64(benchmark::State &state) {
+	auto data = bench::claims()->b64();
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		jwtpp::claims cl(data, true);
+		benchmark::DoNotOptimize(cl);
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	bench::report_allocs(state, allocs);
+}
+
+// RAND_bytes + encode + set, what callers did before claims::set::jti()
+void BM_claims_jti_rand_bytes(benchmark::State &state) {
+	jwtpp::claims cl;
+
+	for (auto _ : state) {
+		uint8_t raw[16];
+		RAND_bytes(raw, sizeof(raw));
+		cl.set().jti(jwtpp::b64::encode_uri(raw, sizeof(raw)));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_claims_jti(benchmark::State &state) {
+	jwtpp::claims cl;
+
+	for (auto _ : state) {
+		cl.set().jti();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_jws_parse(benchmark::State &state) {
+	auto token = jwtpp::jws::sign_bearer(*bench::claims(), bench::crypto({jwtpp::alg_t::HS256, 256}));
+
+	alloc_hook::scope allocs;
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(jwtpp::jws::parse(token));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(token.size()));
+	bench::report_allocs(state, allocs);
+}
+
+} // namespace
+
+BENCHMARK(BM_claims_construct);
+BENCHMARK(BM_claims_b64);
+BENCHMARK(BM_claims_from_b64);
+BENCHMARK(BM_claims_jti_rand_bytes)->ThreadRange(1, bench::max_threads());
+BENCHMARK(BM_claims_jti)->ThreadRange(1, bench::max_threads());
+BENCHMARK(BM_jws_parse);
@@ -0,0 +1,32 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// No-op trace hooks, so benchmarks and jwtpp-loadgen link against library
+// built with JWTPP_WITH_TRACE and show cost of the instrumentation itself.
+
+#include <jwtpp/trace.hh>
+
+#if defined(JWTPP_WITH_TRACE)
+void jwtpp::trace::begin(jwtpp::stats::stage, jwtpp::alg_t, uint64_t) noexcept {}
+
+void jwtpp::trace::end(jwtpp::stats::stage, jwtpp::alg_t, jwtpp::stats::result, uint64_t) noexcept {}
+#endif // defined(JWTPP_WITH_TRACE)
@@ -0,0 +1,243 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+enum alg_family {
+#else
+enum class alg_family {
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+	HMAC,
+	RSA,
+	PSS,
+	ECDSA,
+	EDDSA
+};
+
+namespace detail {
+
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+struct alg_traits_base {
+	static constexpr alg_family   family = F;
+	static constexpr digest::type hash = H;
+	static constexpr size_t       hash_size = HashSize;
+	static constexpr int          hash_nid = HashNid;
+
+	/**
+	 * \brief Upper bound of raw signature, equals signature size when fixed_size
+	 */
+	static constexpr size_t       max_signature_size = MaxSig;
+	static constexpr bool         fixed_size = Fixed;
+};
+
+#if __cplusplus < 201703L
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr alg_family alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::family;
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr digest::type alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::hash;
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr size_t alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::hash_size;
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr int alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::hash_nid;
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr size_t alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::max_signature_size;
+template <alg_family F, digest::type H, size_t HashSize, int HashNid, size_t MaxSig, bool Fixed>
+constexpr bool alg_traits_base<F, H, HashSize, HashNid, MaxSig, Fixed>::fixed_size;
+#endif // __cplusplus < 201703L
+
+// RSA modulus is bounded by OPENSSL_RSA_MAX_MODULUS_BITS (16384)
+static const size_t rsa_max_signature = 2048;
+
+} // namespace detail
+
+/**
+ * \brief Compile time properties of an algorithm
+ *
+ * key_type is what the polymorphic crypto of the same family keeps
+ */
+template <alg_t A>
+struct alg_traits;
+
+template <> struct alg_traits<alg_t::HS256> : detail::alg_traits_base<alg_family::HMAC, digest::type::SHA256, 32, NID_sha256, 32, true> { using key_type = secure_string; };
+template <> struct alg_traits<alg_t::HS384> : detail::alg_traits_base<alg_family::HMAC, digest::type::SHA384, 48, NID_sha384, 48, true> { using key_type = secure_string; };
+template <> struct alg_traits<alg_t::HS512> : detail::alg_traits_base<alg_family::HMAC, digest::type::SHA512, 64, NID_sha512, 64, true> { using key_type = secure_string; };
+
+template <> struct alg_traits<alg_t::RS256> : detail::alg_traits_base<alg_family::RSA, digest::type::SHA256, 32, NID_sha256, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+template <> struct alg_traits<alg_t::RS384> : detail::alg_traits_base<alg_family::RSA, digest::type::SHA384, 48, NID_sha384, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+template <> struct alg_traits<alg_t::RS512> : detail::alg_traits_base<alg_family::RSA, digest::type::SHA512, 64, NID_sha512, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+
+template <> struct alg_traits<alg_t::PS256> : detail::alg_traits_base<alg_family::PSS, digest::type::SHA256, 32, NID_sha256, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+template <> struct alg_traits<alg_t::PS384> : detail::alg_traits_base<alg_family::PSS, digest::type::SHA384, 48, NID_sha384, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+template <> struct alg_traits<alg_t::PS512> : detail::alg_traits_base<alg_family::PSS, digest::type::SHA512, 64, NID_sha512, detail::rsa_max_signature, false> { using key_type = sp_rsa_key; };
+
+// DER encoded ECDSA-Sig-Value, maximum of ECDSA_size() for the curve
+template <> struct alg_traits<alg_t::ES256> : detail::alg_traits_base<alg_family::ECDSA, digest::type::SHA256, 32, NID_sha256, 72, false> { using key_type = sp_ecdsa_key; };
+template <> struct alg_traits<alg_t::ES384> : detail::alg_traits_base<alg_family::ECDSA, digest::type::SHA384, 48, NID_sha384, 104, false> { using key_type = sp_ecdsa_key; };
+template <> struct alg_traits<alg_t::ES512> : detail::alg_traits_base<alg_family::ECDSA, digest::type::SHA512, 64, NID_sha512, 139, false> { using key_type = sp_ecdsa_key; };
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+// Ed25519 signs the message itself, hash members are unused
+template <> struct alg_traits<alg_t::EdDSA> : detail::alg_traits_base<alg_family::EDDSA, digest::type::SHA512, 0, NID_undef, 64, true> { using key_type = sp_evp_key; };
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+
+/**
+ * \brief Signer with hash, padding and buffer sizes fixed at compile time
+ *
+ * Signature is produced into stack buffers, the only allocation made here
+ * is the returned string. EdDSA is the exception: OpenSSL signs it through
+ * an EVP_MD_CTX, which basic_signer and basic_verifier create per call.
+ * Static overloads take key by reference and are what the polymorphic
+ * crypto classes forward to.
+ */
+template <alg_t A>
+class basic_signer final {
+public:
+	using traits   = alg_traits<A>;
+	using key_type = typename traits::key_type;
+
+	static constexpr size_t max_signature_size = traits::max_signature_size;
+	static constexpr size_t max_encoded_size = b64::encoded_uri_size(max_signature_size);
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param key
+	 *
+	 * \throw std::invalid_argument if key is empty or too large for the stack buffers
+	 */
+	explicit basic_signer(key_type key);
+
+	/**
+	 * \brief Raw signature
+	 *
+	 * \param data
+	 * \param size
+	 * \param sig: at least max_signature_size bytes
+	 *
+	 * \return signature size
+	 */
+	size_t sign(const uint8_t *data, size_t size, uint8_t *sig) const { return sign(_key, data, size, sig); }
+
+	/**
+	 * \brief base64url encoded signature, same as crypto::sign
+	 */
+	std::string sign(const std::string &data) const { return sign(_key, data); }
+
+public:
+	static size_t sign(const key_type &key, const uint8_t *data, size_t size, uint8_t *sig);
+
+	static std::string sign(const key_type &key, const std::string &data);
+
+private:
+	key_type _key;
+};
+
+/**
+ * \brief Verifier with hash, padding and buffer sizes fixed at compile time
+ *
+ * Encoded signature is decoded into a stack buffer. HMAC is compared in
+ * constant time.
+ */
+template <alg_t A>
+class basic_verifier final {
+public:
+	using traits   = alg_traits<A>;
+	using key_type = typename traits::key_type;
+
+	static constexpr size_t max_signature_size = traits::max_signature_size;
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param key
+	 *
+	 * \throw std::invalid_argument if key is empty or too large for the stack buffers
+	 */
+	explicit basic_verifier(key_type key);
+
+	bool verify(const uint8_t *data, size_t size, const uint8_t *sig, size_t sig_size) const {
+		return verify(_key, data, size, sig, sig_size);
+	}
+
+	/**
+	 * \brief Verify base64url encoded signature, same as crypto::verify
+	 */
+	bool verify(const std::string &data, const std::string &sig) const { return verify(_key, data, sig); }
+
+public:
+	static bool verify(const key_type &key, const uint8_t *data, size_t size, const uint8_t *sig, size_t sig_size);
+
+	static bool verify(const key_type &key, const std::string &data, const std::string &sig);
+
+private:
+	key_type _key;
+};
+
+#if __cplusplus < 201703L
+template <alg_t A> constexpr size_t basic_signer<A>::max_signature_size;
+template <alg_t A> constexpr size_t basic_signer<A>::max_encoded_size;
+template <alg_t A> constexpr size_t basic_verifier<A>::max_signature_size;
+#endif // __cplusplus < 201703L
+
+extern template class basic_signer<alg_t::HS256>;
+extern template class basic_signer<alg_t::HS384>;
+extern template class basic_signer<alg_t::HS512>;
+extern template class basic_signer<alg_t::RS256>;
+extern template class basic_signer<alg_t::RS384>;
+extern template class basic_signer<alg_t::RS512>;
+extern template class basic_signer<alg_t::PS256>;
+extern template class basic_signer<alg_t::PS384>;
+extern template class basic_signer<alg_t::PS512>;
+extern template class basic_signer<alg_t::ES256>;
+extern template class basic_signer<alg_t::ES384>;
+extern template class basic_signer<alg_t::ES512>;
+
+extern template class basic_verifier<alg_t::HS256>;
+extern template class basic_verifier<alg_t::HS384>;
+extern template class basic_verifier<alg_t::HS512>;
+extern template class basic_verifier<alg_t::RS256>;
+extern template class basic_verifier<alg_t::RS384>;
+extern template class basic_verifier<alg_t::RS512>;
+extern template class basic_verifier<alg_t::PS256>;
+extern template class basic_verifier<alg_t::PS384>;
+extern template class basic_verifier<alg_t::PS512>;
+extern template class basic_verifier<alg_t::ES256>;
+extern template class basic_verifier<alg_t::ES384>;
+extern template class basic_verifier<alg_t::ES512>;
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+extern template class basic_signer<alg_t::EdDSA>;
+extern template class basic_verifier<alg_t::EdDSA>;
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+
+} // namespace jwtpp
@@ -0,0 +1,154 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/executor.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Completion queue for event loops that cannot block on futures
+ *
+ * Operations submitted through the queue run on an executor and push their
+ * result into a bounded lock-free MPSC ring. Readiness is signalled through
+ * an eventfd that the loop registers for EPOLLIN. Producers write the eventfd
+ * only on transition from drained to non-empty, so one wakeup and one read()
+ * in drain() cover any number of completions.
+ *
+ * Exactly one thread may call drain(). When ring is full producers yield
+ * until the loop drains it.
+ */
+class completion_queue final {
+public:
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	enum op {
+#else
+	enum class op {
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+		SIGN,
+		VERIFY
+	};
+
+	struct completion {
+		uint64_t           tag;
+		op                 kind;
+		bool               ok;
+		std::string        token;
+		std::exception_ptr error;
+	};
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param capacity: ring size, rounded up to power of two
+	 *
+	 * \throw std::system_error if eventfd cannot be created
+	 */
+	explicit completion_queue(size_t capacity = 4096);
+
+	~completion_queue();
+
+	completion_queue(const completion_queue &) = delete;
+	completion_queue &operator=(const completion_queue &) = delete;
+
+	/**
+	 * \brief eventfd to register with epoll, readable when completions are pending
+	 *
+	 * \return
+	 */
+	__NODISCARD
+	int fd() const { return _fd; }
+
+	__NODISCARD
+	size_t capacity() const { return _mask + 1; }
+
+	/**
+	 * \brief Sign claims on executor, completion carries token on success
+	 *
+	 * \param ex
+	 * \param tag: opaque value returned in completion
+	 * \param cl
+	 * \param c
+	 */
+	void sign_claims(executor &ex, uint64_t tag, sp_claims cl, sp_crypto c);
+
+	/**
+	 * \brief Parse and verify bearer on executor, completion carries result in ok
+	 *
+	 * \param ex
+	 * \param tag: opaque value returned in completion
+	 * \param bearer
+	 * \param c
+	 * \param v
+	 */
+	void verify(executor &ex, uint64_t tag, std::string bearer, sp_crypto c, jws::verify_cb v = nullptr);
+
+	/**
+	 * \brief Push completion, safe from any number of threads
+	 *
+	 * \param c
+	 */
+	void push(completion &&c);
+
+	/**
+	 * \brief Consume signal and move pending completions into out
+	 *
+	 * \param out: completions are appended
+	 * \param max: upper bound of completions moved by this call
+	 *
+	 * \return number of completions appended
+	 */
+	size_t drain(std::vector<completion> &out, size_t max = SIZE_MAX);
+
+private:
+	struct slot {
+		std::atomic<size_t> seq;
+		completion          value;
+	};
+
+private:
+	void signal();
+
+private:
+	std::unique_ptr<slot[]> _ring;
+	size_t                  _mask;
+	std::atomic<size_t>     _tail;
+	size_t                  _head;
+	std::atomic<bool>       _signalled;
+	int                     _fd;
+};
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
@@ -0,0 +1,298 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/executor.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief co_await-able sign/verify operations
+ *
+ * Awaiting suspends the coroutine, crypto runs on executor pool and the
+ * coroutine is resumed by posting it to resume_on. resume_on is any object
+ * with post(F) accepting a nullary callable, e.g. own event loop or jwtpp::executor.
+ * Nothing blocks and no futures are involved. Operands are captured by the
+ * awaitable; resume_on and pool must outlive the operation.
+ */
+namespace coro {
+
+namespace detail {
+
+template <typename Resume>
+void resume(Resume &on, std::coroutine_handle<> h) {
+	on.post([h]() { h.resume(); });
+}
+
+} // namespace detail
+
+template <typename Resume>
+class sign_awaitable final {
+public:
+	sign_awaitable(sp_claims cl, sp_crypto c, Resume &resume_on, executor &pool)
+		: _cl(std::move(cl))
+		, _c(std::move(c))
+		, _resume(resume_on)
+		, _pool(pool)
+	{}
+
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> h) {
+		_pool.sign_claims(_cl, _c, [this, h](std::exception_ptr e, std::string token) {
+			_error = e;
+			_token = std::move(token);
+			detail::resume(_resume, h);
+		});
+	}
+
+	std::string await_resume() {
+		if (_error) {
+			std::rethrow_exception(_error);
+		}
+
+		return std::move(_token);
+	}
+
+private:
+	sp_claims          _cl;
+	sp_crypto          _c;
+	Resume            &_resume;
+	executor          &_pool;
+	std::string        _token;
+	std::exception_ptr _error;
+};
+
+template <typename Resume>
+class verify_awaitable final {
+public:
+	verify_awaitable(std::string bearer, sp_crypto c, jws::verify_cb v, Resume &resume_on, executor &pool)
+		: _bearer(std::move(bearer))
+		, _c(std::move(c))
+		, _v(std::move(v))
+		, _resume(resume_on)
+		, _pool(pool)
+	{}
+
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> h) {
+		_pool.verify(std::move(_bearer), _c, _v, [this, h](std::exception_ptr e, bool ok) {
+			_error = e;
+			_ok    = ok;
+			detail::resume(_resume, h);
+		});
+	}
+
+	bool await_resume() {
+		if (_error) {
+			std::rethrow_exception(_error);
+		}
+
+		return _ok;
+	}
+
+private:
+	std::string        _bearer;
+	sp_crypto          _c;
+	jws::verify_cb     _v;
+	Resume            &_resume;
+	executor          &_pool;
+	bool               _ok = false;
+	std::exception_ptr _error;
+};
+
+/**
+ * \brief Signs every claims set with the same key, resumes once all are done
+ *
+ * First failure is rethrown from co_await
+ */
+template <typename Resume>
+class sign_batch_awaitable final {
+public:
+	sign_batch_awaitable(std::vector<sp_claims> cl, sp_crypto c, Resume &resume_on, executor &pool)
+		: _cl(std::move(cl))
+		, _c(std::move(c))
+		, _resume(resume_on)
+		, _pool(pool)
+		, _tokens(_cl.size())
+		, _errors(_cl.size())
+		, _left(_cl.size() + 1)
+	{}
+
+	bool await_ready() const noexcept { return _cl.empty(); }
+
+	void await_suspend(std::coroutine_handle<> h) {
+		for (size_t i = 0; i < _cl.size(); ++i) {
+			// tasks already posted refer to this, so failures must not leave await_suspend
+			try {
+				if (!_cl[i] || !_c) {
+					throw std::invalid_argument("claims and crypto must not be null");
+				}
+
+				_pool.sign_claims(_cl[i], _c, [this, h, i](std::exception_ptr e, std::string token) {
+					_errors[i] = e;
+					_tokens[i] = std::move(token);
+
+					if (_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+						detail::resume(_resume, h);
+					}
+				});
+			} catch (...) {
+				// extra reference is still held, countdown cannot reach zero here
+				_errors[i] = std::current_exception();
+				_left.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+
+		// extra reference keeps awaitable alive until submission loop is over
+		if (_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			detail::resume(_resume, h);
+		}
+	}
+
+	std::vector<std::string> await_resume() {
+		for (auto &e : _errors) {
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+
+		return std::move(_tokens);
+	}
+
+private:
+	std::vector<sp_claims>          _cl;
+	sp_crypto                       _c;
+	Resume                         &_resume;
+	executor                       &_pool;
+	std::vector<std::string>        _tokens;
+	std::vector<std::exception_ptr> _errors;
+	std::atomic<size_t>             _left;
+};
+
+/**
+ * \brief Verifies every bearer with the same key, resumes once all are done
+ *
+ * Malformed bearer yields false for its position instead of failing the batch
+ */
+template <typename Resume>
+class verify_batch_awaitable final {
+public:
+	verify_batch_awaitable(std::vector<std::string> bearers, sp_crypto c, jws::verify_cb v, Resume &resume_on, executor &pool)
+		: _bearers(std::move(bearers))
+		, _c(std::move(c))
+		, _v(std::move(v))
+		, _resume(resume_on)
+		, _pool(pool)
+		, _ok(_bearers.size(), 0)
+		, _left(_bearers.size() + 1)
+	{}
+
+	bool await_ready() const noexcept { return _bearers.empty(); }
+
+	void await_suspend(std::coroutine_handle<> h) {
+		for (size_t i = 0; i < _bearers.size(); ++i) {
+			// tasks already posted refer to this, so failures must not leave await_suspend
+			try {
+				if (!_c) {
+					throw std::invalid_argument("crypto must not be null");
+				}
+
+				_pool.verify(std::move(_bearers[i]), _c, _v, [this, h, i](std::exception_ptr e, bool ok) {
+					_ok[i] = (!e && ok) ? 1 : 0;
+
+					if (_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+						detail::resume(_resume, h);
+					}
+				});
+			} catch (...) {
+				// position fails like any other error, extra reference keeps countdown above zero
+				_ok[i] = 0;
+				_left.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+
+		// extra reference keeps awaitable alive until submission loop is over
+		if (_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			detail::resume(_resume, h);
+		}
+	}
+
+	std::vector<bool> await_resume() {
+		return std::vector<bool>(_ok.begin(), _ok.end());
+	}
+
+private:
+	std::vector<std::string> _bearers;
+	sp_crypto                _c;
+	jws::verify_cb           _v;
+	Resume                  &_resume;
+	executor                &_pool;
+	std::vector<uint8_t>     _ok;
+	std::atomic<size_t>      _left;
+};
+
+} // namespace coro
+
+/**
+ * \brief co_await async_sign_claims(cl, c, loop) yields same token as jws::sign_claims
+ */
+template <typename Resume>
+coro::sign_awaitable<Resume> async_sign_claims(sp_claims cl, sp_crypto c, Resume &resume_on, executor &pool = executor::global()) {
+	return coro::sign_awaitable<Resume>(std::move(cl), std::move(c), resume_on, pool);
+}
+
+/**
+ * \brief co_await async_verify(bearer, c, loop) yields same result as jws::parse + jws::verify
+ */
+template <typename Resume>
+coro::verify_awaitable<Resume> async_verify(std::string bearer, sp_crypto c, Resume &resume_on, jws::verify_cb v = nullptr, executor &pool = executor::global()) {
+	return coro::verify_awaitable<Resume>(std::move(bearer), std::move(c), std::move(v), resume_on, pool);
+}
+
+template <typename Resume>
+coro::sign_batch_awaitable<Resume> async_sign_claims_batch(std::vector<sp_claims> cl, sp_crypto c, Resume &resume_on, executor &pool = executor::global()) {
+	return coro::sign_batch_awaitable<Resume>(std::move(cl), std::move(c), resume_on, pool);
+}
+
+template <typename Resume>
+coro::verify_batch_awaitable<Resume> async_verify_batch(std::vector<std::string> bearers, sp_crypto c, Resume &resume_on, jws::verify_cb v = nullptr, executor &pool = executor::global()) {
+	return coro::verify_batch_awaitable<Resume>(std::move(bearers), std::move(c), std::move(v), resume_on, pool);
+}
+
+} // namespace jwtpp
+
+#endif // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
@@ -0,0 +1,175 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Work-stealing thread pool running sign/verify off the caller thread
+ *
+ * Every worker owns a task deque. Tasks posted from a worker go to its own
+ * deque and are taken LIFO, tasks posted from outside are spread round robin.
+ * Idle worker steals the oldest task of another worker before going to sleep.
+ *
+ * Workers run jws::sign_claims and jws::parse + jws::verify unchanged, so
+ * tokens, stats and trace spans are the same as on the calling thread.
+ * Crypto objects are shared between workers as is, OpenSSL keys are safe
+ * for concurrent sign/verify.
+ *
+ * Destructor runs all queued tasks before joining workers.
+ */
+class executor final {
+public:
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::function<void ()>                                     task;
+	typedef std::function<void (std::exception_ptr, std::string)>      sign_done;
+	typedef std::function<void (std::exception_ptr, bool)>             verify_done;
+#else
+	using task        = typename std::function<void ()>;
+	using sign_done   = typename std::function<void (std::exception_ptr, std::string)>;
+	using verify_done = typename std::function<void (std::exception_ptr, bool)>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param threads: number of workers. 0 selects hardware concurrency
+	 */
+	explicit executor(unsigned threads = 0);
+
+	~executor();
+
+	executor(const executor &) = delete;
+	executor &operator=(const executor &) = delete;
+
+	/**
+	 * \brief Queue task. Exceptions escaping task are dropped
+	 *
+	 * \param t
+	 */
+	void post(task t);
+
+	__NODISCARD
+	unsigned size() const { return static_cast<unsigned>(_workers.size()); }
+
+	/**
+	 * \brief Sign claims on the pool, same output as jws::sign_claims
+	 *
+	 * Claims are serialized on the worker and must not be modified until completion
+	 *
+	 * \param cl
+	 * \param c
+	 *
+	 * \return compact token
+	 */
+	std::future<std::string> sign_claims(sp_claims cl, sp_crypto c);
+
+	/**
+	 * \brief Sign claims on the pool, done is invoked on the worker
+	 *
+	 * \param cl
+	 * \param c
+	 * \param done: receives exception or compact token
+	 */
+	void sign_claims(sp_claims cl, sp_crypto c, sign_done done);
+
+	/**
+	 * \brief Parse and verify bearer on the pool, same semantic as jws::parse + jws::verify
+	 *
+	 * \param bearer
+	 * \param c
+	 * \param v
+	 *
+	 * \return
+	 */
+	std::future<bool> verify(std::string bearer, sp_crypto c, jws::verify_cb v = nullptr);
+
+	/**
+	 * \brief Parse and verify bearer on the pool, done is invoked on the worker
+	 *
+	 * \param bearer
+	 * \param c
+	 * \param v
+	 * \param done: receives exception or verification result
+	 */
+	void verify(std::string bearer, sp_crypto c, jws::verify_cb v, verify_done done);
+
+	/**
+	 * \brief Process wide executor sized to hardware concurrency, created on first use
+	 *
+	 * \return
+	 */
+	static executor &global();
+
+	/**
+	 * \brief Index of the worker calling this function
+	 *
+	 * \return -1 if caller is not a worker of any executor
+	 */
+	static int worker_index();
+
+private:
+	struct worker {
+		std::mutex       lock;
+		std::deque<task> tasks;
+		std::thread      thread;
+	};
+
+private:
+	void run(unsigned index);
+
+	bool take(unsigned index, task &t);
+
+	static bool do_verify(const std::string &bearer, sp_crypto c, const jws::verify_cb &v);
+
+private:
+	std::vector<std::unique_ptr<worker>> _workers;
+	std::atomic<unsigned>                _next;
+	std::atomic<size_t>                  _pending;
+	std::mutex                           _sleep_lock;
+	std::condition_variable              _wake;
+	bool                                 _stop;
+};
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::shared_ptr<executor> sp_executor;
+#else
+	using sp_executor = typename std::shared_ptr<executor>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+} // namespace jwtpp
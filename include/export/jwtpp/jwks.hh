@@ -0,0 +1,168 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/keyset.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief JSON Web Key (RFC 7517) loader
+ */
+class jwk final {
+public:
+	/**
+	 * \brief Construct crypto from JWK
+	 *
+	 * Supported key types are RSA, EC (P-256, P-384, P-521), OKP (Ed25519) and oct.
+	 * "alg" selects between RSxxx and PSxxx for RSA keys, defaults to RS256 and HS256
+	 * for RSA and oct keys respectively. "kid" is assigned to the crypto, RFC 7638
+	 * thumbprint of asymmetric key is used when "kid" is absent. oct key without
+	 * "kid" keeps it empty, its thumbprint would expose a hash of the secret.
+	 *
+	 * \param key
+	 *
+	 * \return
+	 */
+	static sp_crypto load(const Json::Value &key);
+
+	static sp_crypto load_from_string(const std::string &str);
+};
+
+/**
+ * \brief JSON Web Key Set loader
+ */
+class jwks final {
+public:
+	/**
+	 * \brief Build keyset from "keys" member of JWKS. Keys marked with "use":"enc" are skipped
+	 *
+	 * \param set
+	 *
+	 * \return
+	 */
+	static keyset load(const Json::Value &set);
+
+	static keyset load_from_string(const std::string &str);
+
+	static keyset load_from_file(const std::string &path);
+};
+
+/**
+ * \brief Keeps keyset_holder in sync with JWKS file on disk
+ *
+ * File is watched in background thread with inotify where available, file
+ * metadata is polled otherwise. On change file is parsed and diffed against
+ * previous load by "kid": keys with unchanged JWK reuse existing crypto,
+ * only new or modified ones are constructed and warmed before the whole set
+ * is published to the holder. Readers of the holder are never blocked.
+ */
+class jwks_watcher final {
+public:
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::function<void (const std::exception &e)> error_cb;
+#else
+	using error_cb = typename std::function<void (const std::exception &e)>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param path: JWKS file
+	 * \param holder: holder to publish keys into
+	 * \param on_error: invoked from watcher thread when reload fails. Current keys stay published
+	 * \param interval: polling interval. Bounds reaction time when inotify is not available
+	 */
+	jwks_watcher(
+		const std::string &path,
+		sp_keyset_holder holder,
+		error_cb on_error = nullptr,
+		std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+	~jwks_watcher();
+
+	jwks_watcher(const jwks_watcher &) = delete;
+	jwks_watcher &operator=(const jwks_watcher &) = delete;
+
+	/**
+	 * \brief Load file synchronously and start watching it
+	 *
+	 * \throw std::exception if initial load fails
+	 */
+	void start();
+
+	void stop();
+
+	/**
+	 * \brief Reload file now
+	 *
+	 * \return true if new keyset has been published
+	 */
+	bool reload();
+
+	/**
+	 * \brief Number of keysets published so far
+	 */
+	__NODISCARD
+	uint64_t generation() const { return _generation.load(); }
+
+private:
+	void run();
+
+	std::string signature() const;
+
+private:
+	struct loaded_key {
+		std::string jwk;
+		sp_crypto   c;
+	};
+
+private:
+	std::string                                  _path;
+	sp_keyset_holder                             _holder;
+	error_cb                                     _on_error;
+	std::chrono::milliseconds                    _interval;
+	std::mutex                                   _reload_lock;
+	std::unordered_map<std::string, loaded_key>  _loaded;
+	std::string                                  _signature;
+	std::atomic<uint64_t>                        _generation;
+	std::atomic<bool>                            _stop;
+	std::mutex                                   _lock;
+	std::condition_variable                      _cv;
+	std::thread                                  _thread;
+	int                                          _wake[2];
+};
+
+} // namespace jwtpp
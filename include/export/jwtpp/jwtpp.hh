@@ -24,9 +24,19 @@
 
 #include <memory>
 #include <functional>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cstring>
+
+#if __cplusplus >= 201703L
+#   include <string_view>
+#endif
+
+#if __cplusplus >= 202002L
+#   include <span>
+#endif
 
 #include <json/json.h>
 
@@ -141,6 +151,107 @@ public:
 
 using secure_string = std::basic_string<char, std::char_traits<char>, secure_allocator<char>>;
 
+#if __cplusplus >= 201703L
+using string_view = std::string_view;
+#else
+/**
+ * \brief Subset of std::string_view for pre C++17 builds
+ */
+class string_view final {
+public:
+	constexpr string_view() noexcept
+		: _data(nullptr)
+		, _size(0)
+	{}
+
+	constexpr string_view(const char *data, size_t size) noexcept
+		: _data(data)
+		, _size(size)
+	{}
+
+	string_view(const char *str) noexcept
+		: _data(str)
+		, _size(str == nullptr ? 0 : std::strlen(str))
+	{}
+
+	string_view(const std::string &str) noexcept
+		: _data(str.data())
+		, _size(str.size())
+	{}
+
+	explicit operator std::string() const { return std::string(_data, _size); }
+
+	constexpr const char *data() const noexcept { return _data; }
+	constexpr size_t size() const noexcept { return _size; }
+	constexpr size_t length() const noexcept { return _size; }
+	constexpr bool empty() const noexcept { return _size == 0; }
+
+	constexpr const char *begin() const noexcept { return _data; }
+	constexpr const char *end() const noexcept { return _data + _size; }
+
+	constexpr char operator[](size_t pos) const noexcept { return _data[pos]; }
+
+private:
+	const char *_data;
+	size_t      _size;
+};
+
+inline bool operator==(string_view lhs, string_view rhs) noexcept {
+	return lhs.size() == rhs.size() && (lhs.size() == 0 || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(string_view lhs, string_view rhs) noexcept {
+	return !(lhs == rhs);
+}
+#endif // __cplusplus >= 201703L
+
+#if __cplusplus >= 202002L
+template <class T>
+using span = std::span<T>;
+#else
+/**
+ * \brief Subset of std::span for pre C++20 builds
+ */
+template <class T>
+class span final {
+public:
+	constexpr span() noexcept
+		: _data(nullptr)
+		, _size(0)
+	{}
+
+	constexpr span(T *data, size_t size) noexcept
+		: _data(data)
+		, _size(size)
+	{}
+
+	template <size_t N>
+	constexpr span(T (&arr)[N]) noexcept
+		: _data(arr)
+		, _size(N)
+	{}
+
+	template <class A>
+	span(std::vector<T, A> &v) noexcept
+		: _data(v.data())
+		, _size(v.size())
+	{}
+
+	constexpr T *data() const noexcept { return _data; }
+	constexpr size_t size() const noexcept { return _size; }
+	constexpr bool empty() const noexcept { return _size == 0; }
+
+	constexpr T *begin() const noexcept { return _data; }
+	constexpr T *end() const noexcept { return _data + _size; }
+
+	T &operator[](size_t pos) const noexcept { return _data[pos]; }
+
+private:
+	T     *_data;
+	size_t _size;
+};
+#endif // __cplusplus >= 202002L
+
 class b64 final {
 private:
 	static const std::string base64_chars;
@@ -176,6 +287,36 @@ public:
 	static std::vector<uint8_t> decode_uri(const char *in, size_t in_size);
 	static std::string decode(const std::string &in);
 	static std::string decode_uri(const std::string &in);
+
+	/**
+	 * \brief Decode base64url into caller provided buffer, no allocations
+	 *
+	 * \param[in]     in: base64url input, padding is optional
+	 * \param[in]     in_size
+	 * \param[out]    out: output buffer
+	 * \param[in,out] out_size: capacity of out on input, decoded size on output
+	 *
+	 * \return false if input is malformed or output buffer is too small
+	 */
+	static bool decode_uri(const char *in, size_t in_size, uint8_t *out, size_t &out_size) noexcept;
+
+	/**
+	 * \brief Encode base64url without padding into caller provided buffer, no allocations
+	 *
+	 * \param[in]  in
+	 * \param[in]  in_size
+	 * \param[out] out: must hold at least encoded_uri_size(in_size) chars
+	 *
+	 * \return number of chars written
+	 */
+	static size_t encode_uri(const uint8_t *in, size_t in_size, char *out) noexcept;
+
+	/**
+	 * \brief Length of unpadded base64url encoding
+	 */
+	static constexpr size_t encoded_uri_size(size_t in_size) {
+		return (in_size / 3) * 4 + ((in_size % 3) ? (in_size % 3) + 1 : 0);
+	}
 };
 
 /**
@@ -352,6 +493,11 @@ private:
 		void iat(const std::string &value) { any("iat", value); }
 		void jti(const std::string &value) { any("jti", value); }
 
+		/**
+		 * \brief Set random "jti": 128 bits from per-thread CSPRNG, base64url encoded
+		 */
+		void jti();
+
 	private:
 		Json::Value *_claims;
 	};
@@ -368,6 +514,15 @@ public:
 	 */
 	explicit claims(const std::string &d, bool b64 = false);
 
+	/**
+	 * \brief Accessors of the copy refer to its own claims, not to the source
+	 */
+	claims(const claims &other);
+	claims(claims &&other) noexcept;
+
+	claims &operator=(const claims &other);
+	claims &operator=(claims &&other) noexcept;
+
 	/**
 	 * \brief
 	 *
@@ -431,6 +586,8 @@ class hdr final {
 public:
 	explicit hdr(jwtpp::alg_t alg);
 
+	hdr(jwtpp::alg_t alg, const std::string &kid);
+
 	explicit hdr(const std::string &data);
 
 	std::string b64();
@@ -439,6 +596,41 @@ private:
 	Json::Value _h;
 };
 
+/**
+ * \brief Tokens minted by jws::sign_batch
+ *
+ * Tokens are stored back to back in one buffer, views returned by
+ * operator[] point into it and are valid while the batch is alive.
+ */
+class token_batch final {
+public:
+	token_batch() = default;
+
+	__NODISCARD
+	size_t size() const noexcept { return _ends.size(); }
+
+	__NODISCARD
+	bool empty() const noexcept { return _ends.empty(); }
+
+	__NODISCARD
+	string_view operator[](size_t i) const noexcept {
+		size_t begin = i == 0 ? 0 : _ends[i - 1];
+		return string_view(_buf.data() + begin, _ends[i] - begin);
+	}
+
+	/**
+	 * \brief All tokens concatenated without separators
+	 */
+	__NODISCARD
+	const std::string &buffer() const noexcept { return _buf; }
+
+private:
+	friend class jws;
+
+	std::string         _buf;
+	std::vector<size_t> _ends;
+};
+
 /**
  * \brief
  */
@@ -464,8 +656,9 @@ private:
 	 * \param data
 	 * \param cl
 	 * \param sig
+	 * \param kid
 	 */
-	jws(alg_t a, const std::string &data, sp_claims cl, const std::string &sig);
+	jws(alg_t a, const std::string &data, sp_claims cl, const std::string &sig, const std::string &kid);
 
 public:
 	/**
@@ -493,6 +686,22 @@ public:
 		return *(_claims.get());
 	}
 
+	/**
+	 * \brief Key ID from the token header
+	 *
+	 * \return empty string if header does not carry "kid"
+	 */
+	__NODISCARD
+	const std::string &kid() const { return _kid; }
+
+	/**
+	 * \brief Algorithm from the token header
+	 *
+	 * \return
+	 */
+	__NODISCARD
+	alg_t alg() const { return _alg; }
+
 public:
 	/**
 	 * \brief
@@ -516,6 +725,24 @@ public:
 	static std::string sign_claims(class claims &cl, sp_crypto c);
 
 	static std::string sign_bearer(class claims &cl, sp_crypto c);
+
+	/**
+	 * \brief Sign many claims with the same key
+	 *
+	 * Header is serialized once and signing inputs are built in one buffer.
+	 * Asymmetric signatures are computed by up to threads threads, HMAC
+	 * reuses one keyed context for all inputs on the calling thread.
+	 * Stats and trace see the whole batch as one SIGN operation.
+	 *
+	 * \param cl
+	 * \param c
+	 * \param threads: 0 selects hardware concurrency
+	 *
+	 * \return tokens in order of cl, same as sign_claims would produce
+	 *
+	 * \throw std::invalid_argument if c is null
+	 */
+	static token_batch sign_batch(span<class claims> cl, sp_crypto c, unsigned threads = 0);
 private:
 	/**
 	 * \brief
@@ -531,6 +758,94 @@ private:
 	std::string  _data;
 	sp_claims    _claims;
 	std::string  _sig;
+	std::string  _kid;
+};
+
+/**
+ * \brief Reads token header and claims WITHOUT verifying signature
+ *
+ * UNVERIFIED: nothing obtained here is authenticated. Values are meant only
+ * for routing decisions, e.g. picking keyset by "iss" or key by "kid", before
+ * token is passed to jws::parse and verified.
+ *
+ * Segments are decoded into fixed buffer within the object and indexed by top
+ * level member, no heap allocations are made. Returned views point into the
+ * object and are valid until next parse() or destruction.
+ */
+class unverified_peek final {
+public:
+	static const size_t buffer_size = 4096;
+	static const size_t max_members = 32;
+
+public:
+	unverified_peek() noexcept;
+
+	/**
+	 * \brief Split and decode token
+	 *
+	 * \param token: compact JWS, optionally prefixed with "Bearer "
+	 * \param size
+	 *
+	 * \return false if token is malformed, has more than max_members top level members
+	 *         in a segment, or decoded segments do not fit buffer_size
+	 */
+	bool parse(const char *token, size_t size) noexcept;
+
+	bool parse(const std::string &token) noexcept { return parse(token.data(), token.size()); }
+
+	/**
+	 * \brief Header member
+	 *
+	 * \param name
+	 *
+	 * \return unescaped content of string value, raw JSON text for other
+	 *         values, empty view if member does not exist
+	 */
+	__NODISCARD
+	string_view header(string_view name) const noexcept;
+
+	/**
+	 * \brief Claim, UNVERIFIED
+	 *
+	 * \param name
+	 *
+	 * \return see header()
+	 */
+	__NODISCARD
+	string_view claim(string_view name) const noexcept;
+
+	__NODISCARD
+	bool has_claim(string_view name) const noexcept;
+
+	__NODISCARD
+	string_view alg() const noexcept { return header("alg"); }
+
+	__NODISCARD
+	string_view kid() const noexcept { return header("kid"); }
+
+	/**
+	 * \brief Token without "Bearer " prefix as passed to parse()
+	 */
+	__NODISCARD
+	string_view token() const noexcept { return _token; }
+
+private:
+	struct member {
+		string_view key;
+		string_view value;
+	};
+
+	static bool index(char *begin, char *end, member *members, size_t &count) noexcept;
+
+	static string_view find(const member *members, size_t count, string_view name) noexcept;
+
+private:
+	char        _buf[buffer_size];
+	member      _header[max_members];
+	member      _claims[max_members];
+	size_t      _header_count;
+	size_t      _claims_count;
+	string_view _token;
 };
 
 class crypto {
@@ -570,6 +885,16 @@ public:
 	__NODISCARD
 	alg_t alg() const { return _alg; }
 
+	/**
+	 * \brief Key ID emitted into the header of tokens signed with this crypto
+	 *
+	 * \return
+	 */
+	__NODISCARD
+	const std::string &kid() const { return _kid; }
+
+	void kid(const std::string &k) { _kid = k; }
+
 	/**
 	 * \brief
 	 *
@@ -589,26 +914,101 @@ public:
 	 */
 	virtual bool verify(const std::string &data, const std::string &sig) = 0;
 
+	/**
+	 * \brief Sign many inputs with the same key
+	 *
+	 * Default signs inputs one by one, implementations override it to share
+	 * per key setup among inputs
+	 *
+	 * \param data: count signing inputs
+	 * \param count
+	 * \param sigs: count strings, receive base64url encoded signatures
+	 */
+	virtual void sign_many(const string_view *data, size_t count, std::string *sigs);
+
+	/**
+	 * \brief Precompute key dependent state so first verify does not pay for it
+	 */
+	virtual void warm() {}
+
+	/**
+	 * \brief RFC 7638 JWK thumbprint
+	 *
+	 * Computed on first call and cached within the instance
+	 *
+	 * \return base64url encoded SHA-256 of canonical JWK
+	 *
+	 * \throw std::runtime_error if key type does not support thumbprints
+	 */
+	__NODISCARD
+	const std::string &thumbprint() const;
+
+private:
+	// indexed by alg_t, must follow its order
+	static constexpr const char *alg_names[] = {
+		"none",
+		"HS256",
+		"HS384",
+		"HS512",
+		"RS256",
+		"RS384",
+		"RS512",
+		"ES256",
+		"ES384",
+		"ES512",
+		"PS256",
+		"PS384",
+		"PS512",
+#if defined(JWTPP_SUPPORTED_EDDSA)
+		"EdDSA",
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	};
+
 public:
 	/**
 	 * \brief
 	 *
 	 * \param alg
 	 *
-	 * \return
+	 * \return nullptr for alg_t::UNKNOWN
 	 */
-	static const char *alg2str(alg_t a);
+	static constexpr const char *alg2str(alg_t a) {
+		return static_cast<size_t>(a) < static_cast<size_t>(alg_t::UNKNOWN) ? alg_names[static_cast<size_t>(a)] : nullptr;
+	}
 
-	static alg_t str2alg(const std::string &a);
+	/**
+	 * \brief Algorithm by its JWA name
+	 *
+	 * Perfect hash on length and two characters followed by one memcmp
+	 *
+	 * \param a: e.g. value of "alg" header member
+	 *
+	 * \return alg_t::UNKNOWN if name is not recognized or support is compiled out
+	 */
+	static alg_t str2alg(string_view a) noexcept;
 
 
 protected:
 	static int hash2nid(digest::type type);
 
+	static int password_loader(char *buf, int size, int rwflag, void *u);
+
+	/**
+	 * \brief Required members of public JWK serialized as described in RFC 7638 section 3.2
+	 *
+	 * \return
+	 */
+	virtual std::string canonical_jwk() const;
+
 protected:
 	alg_t          _alg;
 	Json::Value    _hdr;
 	digest::type   _hash_type;
+	std::string    _kid;
+
+private:
+	mutable std::once_flag _thumbprint_once;
+	mutable std::string    _thumbprint;
 };
 
 class hmac : public crypto {
@@ -621,6 +1021,14 @@ public:
 	std::string sign(const std::string &data) override;
 	bool verify(const std::string &data, const std::string &sig) override;
 
+	/**
+	 * \brief Key is hashed into HMAC context once and reused for every input
+	 */
+	void sign_many(const string_view *data, size_t count, std::string *sigs) override;
+
+protected:
+	std::string canonical_jwk() const override;
+
 #if !(defined(_MSC_VER) && (_MSC_VER < 1700))
 public:
 	template <typename... _Args>
@@ -642,6 +1050,10 @@ public:
 public:
 	std::string sign(const std::string &data) override;
 	bool verify(const std::string &data, const std::string &sig) override;
+	void warm() override;
+
+protected:
+	std::string canonical_jwk() const override;
 
 public:
 #if !(defined(_MSC_VER) && (_MSC_VER < 1700))
@@ -657,8 +1069,37 @@ public:
 
 	static sp_rsa_key load_from_string(const std::string &str, password_cb on_password = nullptr);
 
-private:
-	static int password_loader(char *buf, int size, int rwflag, void *u);
+	/**
+	 * \brief Load private key from DER
+	 *
+	 * \param der: PKCS#1 RSAPrivateKey or unencrypted PKCS#8 PrivateKeyInfo
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_rsa_key load_private_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load public key from DER
+	 *
+	 * \param der: SubjectPublicKeyInfo or PKCS#1 RSAPublicKey
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_rsa_key load_public_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load public key from raw modulus and exponent
+	 *
+	 * \param n: big-endian modulus
+	 * \param n_size
+	 * \param e: big-endian public exponent
+	 * \param e_size
+	 *
+	 * \return
+	 */
+	static sp_rsa_key load_raw(const uint8_t *n, size_t n_size, const uint8_t *e, size_t e_size);
 
 private:
 	sp_rsa_key   _r;
@@ -675,6 +1116,9 @@ public:
 	std::string sign(const std::string &data) override;
 	bool verify(const std::string &data, const std::string &sig) override;
 
+protected:
+	std::string canonical_jwk() const override;
+
 public:
 
 #if !(defined(_MSC_VER) && (_MSC_VER < 1700))
@@ -686,6 +1130,52 @@ public:
 
 	static sp_ecdsa_key gen(int nid);
 
+	static sp_ecdsa_key load_from_file(const std::string &path, password_cb on_password = nullptr);
+
+	static sp_ecdsa_key load_from_string(const std::string &str, password_cb on_password = nullptr);
+
+	/**
+	 * \brief Load private key from DER
+	 *
+	 * \param der: SEC1 ECPrivateKey or unencrypted PKCS#8 PrivateKeyInfo
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_ecdsa_key load_private_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load public key from DER SubjectPublicKeyInfo
+	 *
+	 * \param der
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_ecdsa_key load_public_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load public key from raw point
+	 *
+	 * \param nid: curve
+	 * \param point: uncompressed (0x04 || X || Y) or compressed point
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_ecdsa_key load_raw_public(int nid, const uint8_t *point, size_t size);
+
+	/**
+	 * \brief Load private key from raw big-endian scalar. Public key is derived
+	 *
+	 * \param nid: curve
+	 * \param d
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_ecdsa_key load_raw_private(int nid, const uint8_t *d, size_t size);
+
 private:
 	sp_ecdsa_key _e;
 };
@@ -701,6 +1191,9 @@ public:
 	std::string sign(const std::string &data) override;
 	bool verify(const std::string &data, const std::string &sig) override;
 
+protected:
+	std::string canonical_jwk() const override;
+
 public:
 
 #if !(defined(_MSC_VER) && (_MSC_VER < 1700))
@@ -713,6 +1206,50 @@ public:
 	static sp_evp_key gen();
 	static sp_evp_key get_pub(sp_evp_key priv);
 
+	static sp_evp_key load_from_file(const std::string &path, password_cb on_password = nullptr);
+
+	static sp_evp_key load_from_string(const std::string &str, password_cb on_password = nullptr);
+
+	/**
+	 * \brief Load private key from unencrypted PKCS#8 DER
+	 *
+	 * \param der
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_evp_key load_private_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load public key from DER SubjectPublicKeyInfo
+	 *
+	 * \param der
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_evp_key load_public_der(const uint8_t *der, size_t size);
+
+	/**
+	 * \brief Load private key from raw 32 bytes seed
+	 *
+	 * \param key
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_evp_key load_raw_private(const uint8_t *key, size_t size);
+
+	/**
+	 * \brief Load public key from raw 32 bytes
+	 *
+	 * \param key
+	 * \param size
+	 *
+	 * \return
+	 */
+	static sp_evp_key load_raw_public(const uint8_t *key, size_t size);
+
 private:
 	sp_evp_key _e;
 };
@@ -727,6 +1264,10 @@ public:
 public:
 	std::string sign(const std::string &data) override;
 	bool verify(const std::string &data, const std::string &sig) override;
+	void warm() override;
+
+protected:
+	std::string canonical_jwk() const override;
 
 private:
 	sp_rsa_key _r;
@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/keyset.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Key store holding serialized keys and a bounded cache of materialized ones
+ *
+ * Only blobs are kept for every key. On first use a blob is turned into crypto
+ * and cached in LRU limited by capacity, least recently used keys are dropped
+ * once capacity is exceeded. Store is split into shards each guarded by own
+ * mutex and owning equal part of capacity, materialization runs outside of
+ * shard lock.
+ */
+class key_store final {
+public:
+	struct stats {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		size_t   keys;
+		size_t   materialized;
+	};
+
+public:
+	/**
+	 * \brief
+	 *
+	 * \param capacity: max number of materialized keys
+	 * \param shards: number of independently locked shards. 0 selects default
+	 */
+	explicit key_store(size_t capacity, size_t shards = 0);
+
+	key_store(const key_store &) = delete;
+	key_store &operator=(const key_store &) = delete;
+
+	/**
+	 * \brief Add or replace key. Replaced key is dropped from cache
+	 *
+	 * \param blob: blob.kid must not be empty
+	 */
+	void add(key_blob blob);
+
+	/**
+	 * \brief Remove key
+	 *
+	 * \param kid
+	 *
+	 * \return false if key does not exist
+	 */
+	bool remove(const std::string &kid);
+
+	/**
+	 * \brief Get key, materialize it if not in cache
+	 *
+	 * \param kid
+	 *
+	 * \return nullptr if key does not exist
+	 *
+	 * \throw std::exception if blob cannot be loaded
+	 */
+	sp_crypto get(const std::string &kid);
+
+	__NODISCARD
+	size_t capacity() const { return _capacity; }
+
+	__NODISCARD
+	struct stats stats() const;
+
+private:
+	using sp_blob = std::shared_ptr<const key_blob>;
+
+	using lru_list = std::list<std::string>;
+
+	struct cached {
+		sp_crypto          c;
+		lru_list::iterator pos;
+	};
+
+	struct shard {
+		std::mutex                              lock;
+		std::unordered_map<std::string, sp_blob> blobs;
+		std::unordered_map<std::string, cached>  cache;
+		lru_list                                lru;
+	};
+
+private:
+	shard &select(const std::string &kid);
+
+private:
+	size_t                              _capacity;
+	size_t                              _shard_capacity;
+	std::vector<std::unique_ptr<shard>> _shards;
+	std::atomic<uint64_t>               _hits;
+	std::atomic<uint64_t>               _misses;
+	std::atomic<uint64_t>               _evictions;
+};
+
+} // namespace jwtpp
@@ -0,0 +1,242 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Serialized key material which is turned into crypto on demand
+ */
+struct key_blob {
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	enum format {
+#else
+	enum class format {
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+		JWK,
+		PEM,
+		DER_PRIVATE,
+		DER_PUBLIC
+	};
+
+	std::string kid;
+	format      fmt;
+	alg_t       alg;
+	std::string data;
+
+	/**
+	 * \brief Construct crypto from blob
+	 *
+	 * JWK carries algorithm in "alg" member, alg is used when member is absent.
+	 * For PEM (private key) and DER formats alg selects key type
+	 *
+	 * \return crypto with kid assigned
+	 */
+	__NODISCARD
+	sp_crypto load() const;
+};
+
+/**
+ * \brief Key which failed to load in keyset::load
+ */
+struct key_error {
+	size_t      index;
+	std::string kid;
+	std::string what;
+};
+
+/**
+ * \brief Immutable set of verification keys indexed by "kid"
+ *
+ * Populate with add() and hand over to keyset_holder. Once published
+ * the set is only read, thus lookups need no synchronization.
+ */
+class keyset final {
+public:
+	keyset() = default;
+
+	/**
+	 * \brief Add key to the set
+	 *
+	 * \param c: crypto to add. Indexed by c->kid()
+	 *
+	 * \return
+	 */
+	void add(sp_crypto c);
+
+	/**
+	 * \brief Add key to the set under explicit kid
+	 *
+	 * \param kid
+	 * \param c
+	 */
+	void add(const std::string &kid, sp_crypto c);
+
+	/**
+	 * \brief Find key by "kid"
+	 *
+	 * \param kid
+	 *
+	 * \return nullptr if key does not exist
+	 */
+	__NODISCARD
+	sp_crypto find(const std::string &kid) const;
+
+	/**
+	 * \brief Find key by RFC 7638 thumbprint, e.g. from "jkt" confirmation claim
+	 *
+	 * Only asymmetric keys are indexed, HMAC keys are reachable by kid only
+	 *
+	 * \param jkt: base64url encoded SHA-256 thumbprint
+	 *
+	 * \return nullptr if key does not exist
+	 */
+	__NODISCARD
+	sp_crypto find_by_thumbprint(const std::string &jkt) const;
+
+	__NODISCARD
+	size_t size() const { return _keys.size(); }
+
+	__NODISCARD
+	bool empty() const { return _keys.empty(); }
+
+	__NODISCARD
+	const std::unordered_map<std::string, sp_crypto> &keys() const { return _keys; }
+
+public:
+	/**
+	 * \brief Materialize and warm keys in parallel
+	 *
+	 * Blobs are distributed among worker threads, each key is loaded and
+	 * warmed by the worker that picked it. Keys that failed to load are
+	 * reported in errors and left out of the keyset. Later blob wins if kid repeats.
+	 *
+	 * \param blobs
+	 * \param errors: receives failed keys, cleared on entry
+	 * \param threads: number of worker threads. 0 selects hardware concurrency
+	 *
+	 * \return
+	 */
+	static keyset load(const std::vector<key_blob> &blobs, std::vector<key_error> &errors, unsigned threads = 0);
+
+private:
+	std::unordered_map<std::string, sp_crypto> _keys;
+	std::unordered_map<std::string, sp_crypto> _thumbprints;
+};
+
+/**
+ * \brief Publishes keyset snapshots to concurrent readers
+ *
+ * Readers obtain the current snapshot with read() without taking locks.
+ * publish() swaps the snapshot with a single atomic exchange, previous
+ * snapshot is reclaimed once all readers that could observe it are gone.
+ * Writers are serialized between each other but never wait for readers.
+ */
+class keyset_holder final {
+public:
+	/**
+	 * \brief RAII guard keeping snapshot alive while in scope
+	 *
+	 * Guard is bound to the thread that created it and must not outlive holder
+	 */
+	class snapshot final {
+	public:
+		snapshot(snapshot &&other) noexcept;
+		~snapshot();
+
+		snapshot(const snapshot &) = delete;
+		snapshot &operator=(const snapshot &) = delete;
+		snapshot &operator=(snapshot &&) = delete;
+
+		const keyset *operator->() const { return _ks; }
+		const keyset &operator*() const { return *_ks; }
+
+	private:
+		friend class keyset_holder;
+
+		explicit snapshot(const std::atomic<keyset *> &ks) noexcept;
+
+	private:
+		const keyset *_ks;
+	};
+
+public:
+	keyset_holder();
+
+	explicit keyset_holder(keyset ks);
+
+	~keyset_holder();
+
+	keyset_holder(const keyset_holder &) = delete;
+	keyset_holder &operator=(const keyset_holder &) = delete;
+
+	/**
+	 * \brief Pin current snapshot
+	 *
+	 * \return
+	 */
+	__NODISCARD
+	snapshot read() const noexcept;
+
+	/**
+	 * \brief Find key in current snapshot
+	 *
+	 * \param kid
+	 *
+	 * \return nullptr if key does not exist
+	 */
+	__NODISCARD
+	sp_crypto find(const std::string &kid) const;
+
+	/**
+	 * \brief Replace current snapshot
+	 *
+	 * \param ks
+	 */
+	void publish(keyset ks);
+
+private:
+	void reclaim();
+
+private:
+	std::atomic<keyset *>                    _current;
+	std::mutex                               _lock;
+	std::vector<std::pair<keyset *, uint64_t>> _retired;
+};
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::shared_ptr<keyset_holder> sp_keyset_holder;
+#else
+	using sp_keyset_holder = typename std::shared_ptr<keyset_holder>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+} // namespace jwtpp
@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Staged parse -> verify -> validate pipeline for bulk token processing
+ *
+ * Tokens are submitted into a bounded input ring. Stage 1 splits, decodes and
+ * parses them with jws::parse and resolves the key. Stage 2 takes whatever
+ * is ready up to batch_size, groups it by (alg, key) and verifies group by
+ * group with the same crypto. Stage 3 applies the claims policy and hands
+ * result to the sink. Each stage runs on its own thread, stages are linked
+ * with SPSC rings; a full ring stalls the stage before it, down to submit().
+ *
+ * submit() must be called from a single thread. The sink runs on stage 3
+ * thread, results arrive in submission order.
+ */
+class pipeline final {
+public:
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	enum status {
+#else
+	enum class status {
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+		OK,
+		MALFORMED,
+		UNKNOWN_KEY,
+		ALG_MISMATCH,
+		BAD_SIGNATURE,
+		POLICY
+	};
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::function<sp_crypto (const jws &j)>                      key_resolver;
+	typedef std::function<void (uint64_t tag, status s, sp_claims cl)>  sink;
+#else
+	using key_resolver = typename std::function<sp_crypto (const jws &j)>;
+	using sink         = typename std::function<void (uint64_t tag, status s, sp_claims cl)>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+	struct options {
+		options() : queue_size(1024), batch_size(64) {}
+
+		size_t queue_size;
+		size_t batch_size;
+	};
+
+public:
+	/**
+	 * \brief Start stage threads
+	 *
+	 * \param resolve: picks key for parsed token, e.g. by kid. nullptr result means unknown key
+	 * \param out: receives every submitted token exactly once. Claims are set for status::OK only
+	 * \param policy: optional claims check, failure yields status::POLICY
+	 * \param opts
+	 */
+	pipeline(key_resolver resolve, sink out, jws::verify_cb policy = nullptr, options opts = options());
+
+	/**
+	 * \brief Calls close()
+	 */
+	~pipeline();
+
+	pipeline(const pipeline &) = delete;
+	pipeline &operator=(const pipeline &) = delete;
+
+	/**
+	 * \brief Queue token, waits while input ring is full
+	 *
+	 * \param tag: opaque value passed to the sink
+	 * \param bearer: token in the form accepted by jws::parse
+	 *
+	 * \throw std::logic_error if pipeline is closed
+	 */
+	void submit(uint64_t tag, std::string bearer);
+
+	/**
+	 * \brief Queue token unless input ring is full
+	 *
+	 * \return false if ring is full, bearer is left untouched
+	 */
+	bool try_submit(uint64_t tag, std::string &bearer);
+
+	/**
+	 * \brief Process everything submitted so far and stop stage threads
+	 */
+	void close();
+
+	static const char *status2str(status s);
+
+private:
+	struct item;
+	struct state;
+
+private:
+	void parse_stage();
+	void verify_stage();
+	void validate_stage();
+
+private:
+	std::unique_ptr<state> _s;
+	std::thread            _parse;
+	std::thread            _verify;
+	std::thread            _validate;
+	bool                   _closed;
+};
+
+} // namespace jwtpp
@@ -0,0 +1,154 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jwtpp/keyset.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Keyset published once into shared memory and attached by many processes
+ *
+ * Publisher serializes key blobs together with a "kid" hash index into a
+ * POSIX shm segment. Workers map it read-only and turn blob into crypto on
+ * first lookup of its kid, so every key is parsed only by processes that
+ * actually use it and raw key material is stored once per host.
+ *
+ * Segments are named "<name>.<generation>", a small control segment "<name>"
+ * holds the atomic generation counter. publish() writes a complete new
+ * generation, then bumps the counter and unlinks the previous one. Workers
+ * compare counter on every lookup (single atomic load) and remap when it
+ * moved, crypto of the previous generation is dropped once no thread uses it.
+ *
+ * Segments hold raw key material and are created with mode 0600 (subject to
+ * umask), so publisher and workers must run as the same user.
+ */
+class shm_keyset final {
+public:
+	/**
+	 * \brief Publish new generation of keyset
+	 *
+	 * Every blob is loaded once to validate it, keys that failed to load are
+	 * reported in errors and left out. Later blob wins if kid repeats.
+	 * Concurrent publishers are serialized with flock() on control segment
+	 *
+	 * \param name: shm_open() name, e.g. "/myapp-keys"
+	 * \param blobs
+	 * \param errors: receives failed keys, cleared on entry
+	 *
+	 * \return published generation
+	 *
+	 * \throw std::runtime_error if segments cannot be created
+	 */
+	static uint64_t publish(const std::string &name, const std::vector<key_blob> &blobs, std::vector<key_error> &errors);
+
+	/**
+	 * \brief Remove control and current generation segments. Attached workers keep their mappings
+	 */
+	static void unlink(const std::string &name);
+
+public:
+	/**
+	 * \brief Attach read-only to keyset published under name
+	 *
+	 * Attaching before first publish() is allowed, such keyset is empty
+	 * until publisher catches up
+	 *
+	 * \throw std::runtime_error if control segment does not exist
+	 */
+	explicit shm_keyset(const std::string &name);
+
+	~shm_keyset();
+
+	shm_keyset(const shm_keyset &) = delete;
+	shm_keyset &operator=(const shm_keyset &) = delete;
+
+	/**
+	 * \brief Find key by "kid" in latest generation, loading it on first use
+	 *
+	 * \param kid
+	 *
+	 * \return nullptr if key does not exist
+	 */
+	__NODISCARD
+	sp_crypto find(const std::string &kid);
+
+	/**
+	 * \brief Switch to latest generation if publisher moved on. find() does it implicitly
+	 *
+	 * \return true if generation changed
+	 */
+	bool refresh();
+
+	/**
+	 * \brief Generation currently mapped, 0 if nothing was published yet
+	 */
+	__NODISCARD
+	uint64_t generation() const noexcept;
+
+	/**
+	 * \brief Number of keys in mapped generation
+	 */
+	__NODISCARD
+	size_t size() const noexcept;
+
+	/**
+	 * \brief Keys of mapped generation this process has already loaded
+	 */
+	__NODISCARD
+	std::vector<sp_crypto> loaded() const;
+
+	/**
+	 * \brief Every key of mapped generation, loading the ones not used yet
+	 */
+	__NODISCARD
+	std::vector<sp_crypto> all();
+
+private:
+	struct control;
+	class control_lock;
+	struct view;
+
+	void reclaim();
+
+private:
+	std::string                              _name;
+	int                                      _fd;
+	const control                           *_ctl;
+	std::atomic<view *>                      _current;
+	std::mutex                               _lock;
+	std::vector<std::pair<view *, uint64_t>> _retired;
+};
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jwtpp/keyset.hh>
+#include <jwtpp/shm_keyset.hh>
+#include <jwtpp/token_cache.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Warm restart snapshot of verified token cache and keyset index
+ *
+ * save() on shutdown writes live cache entries (token hash, expiry, claims
+ * blob) together with kid, alg and RFC 7638 thumbprint of every materialized
+ * key. File is written aside and renamed into place, so a crash never leaves
+ * a torn snapshot.
+ *
+ * load() on startup maps the file, looks up every recorded kid in the current
+ * keyset, compares thumbprints and warms keys that were in use. Cached tokens
+ * were verified by some recorded key, so if any of them is gone or changed,
+ * or no key was recorded at all, all tokens are dropped. Otherwise entries
+ * not yet expired are inserted back into the cache.
+ */
+class warm_snapshot final {
+public:
+	/**
+	 * \brief Outcome of load()
+	 */
+	struct report {
+		size_t tokens;      // entries restored into cache
+		size_t expired;     // entries dropped as expired
+		size_t dropped;     // entries dropped because keys changed or cache is smaller
+		size_t keys;        // recorded keys found with the same thumbprint
+		size_t stale_keys;  // recorded keys missing or with different thumbprint
+	};
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::function<sp_crypto (const std::string &kid)> lookup_cb;
+#else
+	using lookup_cb = typename std::function<sp_crypto (const std::string &kid)>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+public:
+	/**
+	 * \brief Write snapshot
+	 *
+	 * \param path
+	 * \param cache
+	 * \param keys: keys tokens in cache were verified with, indexed by kid()
+	 *
+	 * \throw std::runtime_error on I/O error
+	 */
+	static void save(const std::string &path, const shm_token_cache &cache, const std::vector<sp_crypto> &keys);
+
+	static void save(const std::string &path, const shm_token_cache &cache, const keyset &keys);
+
+	/**
+	 * \brief Every key of mapped shm keyset generation is recorded, only ones this process loaded are warmed on load()
+	 */
+	static void save(const std::string &path, const shm_token_cache &cache, shm_keyset &keys);
+
+	/**
+	 * \brief Restore snapshot into cache
+	 *
+	 * \param path
+	 * \param cache: entries larger than its blob_size() are dropped
+	 * \param lookup: resolves recorded kid in current keyset, nullptr if absent
+	 * \param now: unix time entries are checked for expiry against, 0 for current time
+	 *
+	 * \return
+	 *
+	 * \throw std::runtime_error if file cannot be read or is not a valid snapshot
+	 */
+	static report load(const std::string &path, shm_token_cache &cache, const lookup_cb &lookup, uint64_t now = 0);
+
+	static report load(const std::string &path, shm_token_cache &cache, const keyset &keys, uint64_t now = 0);
+
+	/**
+	 * \brief Recorded keys are loaded from shm keyset, so they are ready before first request
+	 */
+	static report load(const std::string &path, shm_token_cache &cache, shm_keyset &keys, uint64_t now = 0);
+
+private:
+	struct indexed_key {
+		std::string kid;
+		sp_crypto   key;
+		bool        warm;
+	};
+
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	typedef std::vector<indexed_key> indexed_keys;
+#else
+	using indexed_keys = typename std::vector<indexed_key>;
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+
+	static void save_indexed(const std::string &path, const shm_token_cache &cache, const indexed_keys &keys);
+};
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
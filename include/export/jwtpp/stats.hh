@@ -0,0 +1,200 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Latency histograms and outcome counters of jws parse/verify/sign
+ *
+ * Collected only when library is built with JWTPP_WITH_STATS, otherwise
+ * instrumentation compiles out and snapshots are empty.
+ *
+ * Every thread records into its own block with plain relaxed stores, there
+ * is no contention between threads on the hot path. collect() sums blocks of
+ * all threads, including threads that have already exited. Counters never
+ * reset, compare two snapshots to get rate over an interval.
+ */
+class stats final {
+public:
+	enum class stage {
+		PARSE = 0,     //!< whole jws::parse
+		DECODE,        //!< base64url decoding of header and claims
+		JSON,          //!< JSON parsing (parse) or serialization (sign)
+		VERIFY,        //!< whole jws::verify
+		CRYPTO_VERIFY, //!< crypto::verify of any caller
+		POLICY,        //!< user verify callback
+		SIGN,          //!< whole jws::sign_claims
+		CRYPTO_SIGN,   //!< crypto::sign of any caller
+		MAX
+	};
+
+	enum class result {
+		OK = 0,
+		MALFORMED,     //!< not a bearer, wrong number of segments, undecodable header
+		BAD_HEADER,    //!< typ is not JWT, missing or unknown alg, invalid kid
+		BAD_CLAIMS,    //!< claims are not valid JSON
+		ALG_MISMATCH,  //!< crypto alg differs from token alg
+		BAD_SIGNATURE,
+		REJECTED,      //!< user verify callback returned false
+		EXCEPTION,     //!< exception not classified above
+		MAX
+	};
+
+	static const size_t stages = static_cast<size_t>(stage::MAX);
+	static const size_t results = static_cast<size_t>(result::MAX);
+	static const size_t algs = static_cast<size_t>(alg_t::UNKNOWN) + 1;
+
+	/**
+	 * \brief Log-linear histogram of nanoseconds, HDR style
+	 *
+	 * Values below 2^sub_bits have own bucket, above that every power of two
+	 * is split into 2^sub_bits buckets, so relative error stays under 3.2%.
+	 * Values beyond 2^36 ns (~68 s) land in the last bucket
+	 */
+	class histogram final {
+	public:
+		static const size_t   sub_bits = 5;
+		static const size_t   sub_buckets = size_t(1) << sub_bits;
+		static const size_t   max_bits = 36;
+		static const size_t   buckets = (max_bits - sub_bits + 1) * sub_buckets;
+
+	public:
+		histogram() = default;
+
+		void record(uint64_t ns, uint64_t n = 1);
+
+		void merge(const histogram &h);
+
+		__NODISCARD
+		uint64_t count() const noexcept { return _count; }
+
+		__NODISCARD
+		uint64_t sum() const noexcept { return _sum; }
+
+		__NODISCARD
+		uint64_t min() const noexcept { return _count ? _min : 0; }
+
+		__NODISCARD
+		uint64_t max() const noexcept { return _max; }
+
+		__NODISCARD
+		double mean() const noexcept { return _count ? static_cast<double>(_sum) / static_cast<double>(_count) : 0.0; }
+
+		/**
+		 * \brief Value at percentile
+		 *
+		 * \param p: 0..100
+		 *
+		 * \return upper bound of bucket holding the value, clamped to max()
+		 */
+		__NODISCARD
+		uint64_t percentile(double p) const noexcept;
+
+		/**
+		 * \brief Non empty buckets as pairs of (bucket upper bound, count)
+		 */
+		__NODISCARD
+		std::vector<std::pair<uint64_t, uint64_t>> buckets_view() const;
+
+	public:
+		static size_t bucket(uint64_t ns) noexcept;
+
+		static uint64_t bucket_upper(size_t b) noexcept;
+
+	private:
+		friend class stats;
+
+		std::vector<uint64_t> _counts;
+		uint64_t              _count{0};
+		uint64_t              _sum{0};
+		uint64_t              _min{0};
+		uint64_t              _max{0};
+	};
+
+	class snapshot final {
+	public:
+		snapshot();
+
+		/**
+		 * \brief Latency of stage for alg
+		 */
+		__NODISCARD
+		const histogram &latency(stage s, alg_t a) const;
+
+		/**
+		 * \brief Latency of stage for all algs together
+		 */
+		__NODISCARD
+		histogram latency(stage s) const;
+
+		/**
+		 * \brief Outcomes of PARSE, VERIFY or SIGN for alg
+		 *
+		 * Parse failures that happen before alg is known are counted under alg_t::UNKNOWN
+		 */
+		__NODISCARD
+		uint64_t count(stage s, alg_t a, result r) const;
+
+		/**
+		 * \brief Outcomes for all algs together
+		 */
+		__NODISCARD
+		uint64_t count(stage s, result r) const;
+
+	private:
+		friend class stats;
+
+		std::vector<histogram> _latency;
+		std::vector<uint64_t>  _counts;
+	};
+
+public:
+	static constexpr bool enabled() {
+#if defined(JWTPP_WITH_STATS)
+		return true;
+#else
+		return false;
+#endif // defined(JWTPP_WITH_STATS)
+	}
+
+	/**
+	 * \brief Aggregate all threads
+	 *
+	 * Safe to call concurrently with recording, values of a running thread
+	 * may be a few samples behind
+	 */
+	static snapshot collect();
+
+	static const char *stage2str(stage s);
+
+	static const char *result2str(result r);
+};
+
+} // namespace jwtpp
@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Verified token cache in shared memory, shared by processes
+ *
+ * Meant for prefork servers: create the cache before forking and every
+ * worker sees entries inserted by any other worker. Unrelated processes
+ * share it through a named POSIX shm segment or by passing fd().
+ *
+ * Segment is a fixed size open addressing table. Token is identified by
+ * SHA-256 of its compact form ("Bearer " prefix is ignored), so crafted
+ * tokens cannot collide with cached ones. Lookup probes a window of
+ * probe_window slots starting at the hash position, insert takes a slot with
+ * the same hash, a free or expired one, or evicts entry expiring first.
+ *
+ * Every slot is guarded by a seqlock: readers never write shared memory
+ * and retry if slot changed while copying it, writers take the slot with
+ * CAS and skip insert if another writer holds it. There are no syscalls
+ * and no locks on any path after segment is mapped.
+ *
+ * Slot holds token hash, expiry (unix seconds), cache generation and a
+ * compact claims blob of up to blob_size bytes: decoded claims JSON of the
+ * token. Only insert tokens after full verification, lookup hit stands in
+ * for signature check, not for claim validation.
+ *
+ * clear() bumps generation shared by all processes, dropping every entry at
+ * once, e.g. after a signing key was revoked. Take generation() before
+ * verifying a token and pass it to insert(), so a verdict reached with keys
+ * revoked in the meantime is refused instead of cached.
+ */
+class shm_token_cache final {
+public:
+	static const size_t probe_window = 8;
+	static const size_t default_blob_size = 256;
+
+	// token hash, in 64-bit words
+	static const size_t hash_words = 4;
+
+public:
+	/**
+	 * \brief Create anonymous segment (memfd). Shared with children forked afterwards
+	 *
+	 * \param slots: rounded up to power of two
+	 * \param blob_size: max claims size, rounded up to multiple of 8
+	 */
+	explicit shm_token_cache(size_t slots, size_t blob_size = default_blob_size);
+
+	/**
+	 * \brief Create or attach named POSIX shared memory segment
+	 *
+	 * \param name: shm_open() name, e.g. "/myapp-tokens"
+	 * \param slots, blob_size: used when segment is created, attach
+	 *        requires segment layout to match
+	 *
+	 * \throw std::runtime_error if segment cannot be created, or exists with different layout
+	 */
+	shm_token_cache(const std::string &name, size_t slots, size_t blob_size = default_blob_size);
+
+	~shm_token_cache();
+
+	shm_token_cache(const shm_token_cache &) = delete;
+	shm_token_cache &operator=(const shm_token_cache &) = delete;
+
+	/**
+	 * \brief Insert verified token
+	 *
+	 * \param token: compact JWS, optionally prefixed with "Bearer "
+	 * \param exp: expiry, unix seconds
+	 * \param blob
+	 * \param size
+	 * \param gen: generation() taken before the token was verified
+	 *
+	 * \return false if blob does not fit, token already expired, cache was
+	 *         cleared since gen, or slot is being written by another thread or process
+	 */
+	bool insert(string_view token, uint64_t exp, const char *blob, size_t size, uint64_t gen) noexcept;
+
+	/**
+	 * \brief Insert against current generation, for callers that never race clear()
+	 */
+	bool insert(string_view token, uint64_t exp, const char *blob, size_t size) noexcept;
+
+	/**
+	 * \brief Insert verified token with its claims. Expiry is taken from "exp",
+	 *        blob is decoded claims segment of the token
+	 *
+	 * \return false if claims have no "exp" or see insert() above
+	 */
+	bool insert(string_view token, class claims &cl, uint64_t gen);
+
+	bool insert(string_view token, class claims &cl);
+
+	/**
+	 * \brief Lookup
+	 *
+	 * \param token
+	 * \param now: unix seconds, entries with exp <= now are misses
+	 * \param[out] blob: at least blob_size() bytes
+	 * \param[out] size
+	 *
+	 * \return true on hit
+	 */
+	bool find(string_view token, uint64_t now, char *blob, size_t &size) const noexcept;
+
+	/**
+	 * \brief Lookup against current time, claims are parsed from blob
+	 *
+	 * \return nullptr on miss
+	 */
+	sp_claims find(string_view token) const;
+
+	/**
+	 * \brief Invalidate all entries in every attached process
+	 */
+	void clear() noexcept;
+
+	/**
+	 * \brief Current generation, bumped by clear()
+	 */
+	__NODISCARD
+	uint64_t generation() const noexcept;
+
+	__NODISCARD
+	int fd() const noexcept { return _fd; }
+
+	__NODISCARD
+	size_t slots() const noexcept { return _slots; }
+
+	__NODISCARD
+	size_t blob_size() const noexcept { return _blob_size; }
+
+	/**
+	 * \brief Attach segment by descriptor, e.g. received over unix socket. fd is duplicated
+	 */
+	static std::unique_ptr<shm_token_cache> attach(int fd);
+
+	/**
+	 * \brief Remove named segment. Attached processes keep their mappings
+	 */
+	static void unlink(const std::string &name);
+
+private:
+	friend class warm_snapshot;
+
+	struct segment;
+	struct slot;
+	struct by_fd {};
+
+	shm_token_cache(by_fd, int fd);
+
+	bool insert_hash(const uint64_t *hash, uint64_t exp, const char *blob, size_t size, uint64_t gen) noexcept;
+
+	// copy out live entry (not expired at now, current generation), false for empty slot
+	bool read_slot(size_t index, uint64_t now, uint64_t *hash, uint64_t &exp, char *blob, size_t &size) const noexcept;
+
+	void map(bool create, size_t slots, size_t blob_size);
+
+	slot *at(size_t index) const noexcept;
+
+private:
+	int      _fd;
+	void    *_base;
+	size_t   _size;
+	size_t   _slots;
+	size_t   _blob_size;
+	size_t   _slot_size;
+	segment *_seg;
+};
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(JWTPP_TRACE_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#   include <x86intrin.h>
+#   define JWTPP_TRACE_HAS_RDTSC
+#elif defined(JWTPP_TRACE_RDTSC) && defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#   define JWTPP_TRACE_HAS_RDTSC
+#else
+#   include <chrono>
+#endif
+
+#include <jwtpp/stats.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Span hooks at stage boundaries, for tracing systems
+ *
+ * With library built with JWTPP_WITH_TRACE, jws::parse, jws::verify,
+ * jws::sign_claims and crypto sign/verify implementations call begin() and
+ * end() around every stats::stage. The application provides both functions
+ * at link time, e.g.
+ *
+ * \code
+ * void jwtpp::trace::begin(jwtpp::stats::stage s, jwtpp::alg_t a, uint64_t ts) noexcept { ... }
+ * void jwtpp::trace::end(jwtpp::stats::stage s, jwtpp::alg_t a, jwtpp::stats::result r, uint64_t ts) noexcept { ... }
+ * \endcode
+ *
+ * Without JWTPP_WITH_TRACE no call is emitted at all.
+ *
+ * Spans nest on the calling thread: PARSE contains DECODE and JSON (each may
+ * open and close more than once, once per segment), VERIFY contains
+ * CRYPTO_VERIFY and POLICY, SIGN contains JSON and CRYPTO_SIGN. PARSE begins
+ * with alg_t::UNKNOWN as header is not decoded yet. Outcome is reported on
+ * PARSE, VERIFY and SIGN, inner spans end with result::OK, or with
+ * result::EXCEPTION when left by exception.
+ *
+ * Timestamps come from now(): TSC ticks when built with JWTPP_TRACE_RDTSC
+ * on x86, steady_clock nanoseconds otherwise.
+ */
+namespace trace {
+
+constexpr bool enabled() {
+#if defined(JWTPP_WITH_TRACE)
+	return true;
+#else
+	return false;
+#endif // defined(JWTPP_WITH_TRACE)
+}
+
+/**
+ * \brief Whether now() returns TSC ticks rather than nanoseconds
+ */
+constexpr bool tsc() {
+#if defined(JWTPP_TRACE_HAS_RDTSC)
+	return true;
+#else
+	return false;
+#endif // defined(JWTPP_TRACE_HAS_RDTSC)
+}
+
+inline uint64_t now() noexcept {
+#if defined(JWTPP_TRACE_HAS_RDTSC)
+	return static_cast<uint64_t>(__rdtsc());
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif // defined(JWTPP_TRACE_HAS_RDTSC)
+}
+
+#if defined(JWTPP_WITH_TRACE)
+/**
+ * \brief Span start, defined by application
+ */
+void begin(stats::stage s, alg_t a, uint64_t ts) noexcept;
+
+/**
+ * \brief Span end, defined by application
+ */
+void end(stats::stage s, alg_t a, stats::result r, uint64_t ts) noexcept;
+#endif // defined(JWTPP_WITH_TRACE)
+
+} // namespace trace
+
+} // namespace jwtpp
@@ -0,0 +1,133 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/keyset.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Verifies tokens of many issuers, each with own keyset and claims policy
+ *
+ * Issuer is read from the unverified payload and looked up in a hash index,
+ * key is selected by "kid" in the issuer keyset, signature is checked once and
+ * only then claims are parsed and handed to the issuer policy. Cost of a call
+ * does not depend on the number of configured issuers.
+ *
+ * Issuers are configured with add()/remove() before verifying; these must not
+ * run concurrently with verify(). Key rotation goes through the issuer
+ * keyset_holder and is safe at any time. verify() is safe to call from any
+ * number of threads.
+ */
+class issuer_verifier final {
+public:
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+	enum status {
+#else
+	enum class status {
+#endif // defined(_MSC_VER) && (_MSC_VER < 1700)
+		OK,
+		MALFORMED,
+		UNKNOWN_ISSUER,
+		UNKNOWN_KEY,
+		ALG_MISMATCH,
+		BAD_SIGNATURE,
+		POLICY
+	};
+
+public:
+	issuer_verifier();
+
+	issuer_verifier(const issuer_verifier &) = delete;
+	issuer_verifier &operator=(const issuer_verifier &) = delete;
+
+	/**
+	 * \brief Add or replace issuer
+	 *
+	 * \param iss: value of "iss" claim
+	 * \param keys: issuer keys
+	 * \param policy: optional claims check run after signature is verified
+	 */
+	void add(const std::string &iss, sp_keyset_holder keys, jws::verify_cb policy = nullptr);
+
+	/**
+	 * \brief Remove issuer
+	 *
+	 * \param iss
+	 *
+	 * \return false if issuer does not exist
+	 */
+	bool remove(const std::string &iss);
+
+	__NODISCARD
+	size_t size() const { return _issuers.size(); }
+
+	/**
+	 * \brief Verify token
+	 *
+	 * Token without "kid" is accepted only when issuer keyset holds exactly one key
+	 *
+	 * \param[in]  token: compact JWS, optionally prefixed with "Bearer "
+	 * \param[out] cl: verified claims, set only when status::OK is returned
+	 *
+	 * \return
+	 */
+	status verify(const std::string &token, sp_claims &cl) const;
+
+	/**
+	 * \brief Verify token, discarding claims
+	 *
+	 * \param token
+	 *
+	 * \return
+	 */
+	status verify(const std::string &token) const;
+
+	static const char *status2str(status s);
+
+private:
+	struct issuer {
+		uint64_t         h;
+		std::string      iss;
+		sp_keyset_holder keys;
+		jws::verify_cb   policy;
+	};
+
+private:
+	static uint64_t hash(const char *data, size_t size) noexcept;
+
+	const issuer *find(string_view iss) const noexcept;
+
+	void rehash();
+
+private:
+	std::vector<issuer>   _issuers;
+	std::vector<uint32_t> _index;
+};
+
+} // namespace jwtpp
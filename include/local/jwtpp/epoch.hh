@@ -0,0 +1,70 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace jwtpp {
+namespace epoch {
+
+/**
+ * \brief Epoch based reclamation for read-mostly snapshots
+ *
+ * Readers announce the global epoch they observed before dereferencing
+ * a shared pointer. Writers publish a replacement, advance the epoch and
+ * free the retired object only once no reader is pinned at an epoch
+ * older than the one the object was retired in.
+ *
+ * Pinning is a pair of atomic stores into a per-thread record, readers
+ * never block and never wait for writers.
+ */
+
+/**
+ * \brief Announce current thread as reader. Calls nest
+ */
+void pin() noexcept;
+
+/**
+ * \brief Leave read-side critical section entered by pin()
+ */
+void unpin() noexcept;
+
+/**
+ * \brief Advance global epoch
+ *
+ * \return new epoch value. Objects unlinked before the call are retired at this epoch
+ */
+uint64_t advance() noexcept;
+
+/**
+ * \brief Check whether object retired at given epoch may be reclaimed
+ *
+ * \param retired: value returned by advance()
+ *
+ * \return true if no reader is pinned at an older epoch
+ */
+bool safe(uint64_t retired) noexcept;
+
+} // namespace epoch
+} // namespace jwtpp
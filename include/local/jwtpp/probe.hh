@@ -0,0 +1,235 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <exception>
+
+#if defined(JWTPP_WITH_STATS)
+#   include <chrono>
+#endif // defined(JWTPP_WITH_STATS)
+
+#include <jwtpp/stats.hh>
+#include <jwtpp/trace.hh>
+
+#if defined(JWTPP_WITH_STATS) || defined(JWTPP_WITH_TRACE)
+#   define JWTPP_WITH_PROBES
+#endif
+
+namespace jwtpp {
+
+/**
+ * \brief Instrumentation points of jws stages, feeding stats and trace hooks
+ *
+ * With neither JWTPP_WITH_STATS nor JWTPP_WITH_TRACE defined every class
+ * here is empty and every call inlines to nothing.
+ */
+namespace probe {
+
+#if defined(JWTPP_WITH_STATS)
+void record(stats::stage s, alg_t a, uint64_t ns) noexcept;
+
+void count(stats::stage s, alg_t a, stats::result r) noexcept;
+
+inline uint64_t now() noexcept {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif // defined(JWTPP_WITH_STATS)
+
+#if defined(JWTPP_WITH_PROBES)
+/**
+ * \brief Tells destructor run by stack unwinding from normal scope exit
+ */
+class unwind_check final {
+public:
+	unwind_check() noexcept
+#if defined(__cpp_lib_uncaught_exceptions)
+		: _exceptions(std::uncaught_exceptions())
+#endif // defined(__cpp_lib_uncaught_exceptions)
+	{}
+
+	bool unwinding() const noexcept {
+#if defined(__cpp_lib_uncaught_exceptions)
+		return std::uncaught_exceptions() > _exceptions;
+#else
+		return std::uncaught_exception();
+#endif // defined(__cpp_lib_uncaught_exceptions)
+	}
+
+private:
+#if defined(__cpp_lib_uncaught_exceptions)
+	int _exceptions;
+#endif // defined(__cpp_lib_uncaught_exceptions)
+};
+
+/**
+ * \brief Inner stage. Accumulates time, possibly over several start/stop
+ *        intervals, and records it once on destruction if it ever ran.
+ *        Every interval is a separate trace span
+ */
+class timer final {
+public:
+	explicit timer(stats::stage s, alg_t a = alg_t::UNKNOWN, bool running = true) noexcept
+		: _stage(s)
+		, _alg(a)
+#if defined(JWTPP_WITH_STATS)
+		, _start(0)
+		, _elapsed(0)
+		, _used(false)
+#endif // defined(JWTPP_WITH_STATS)
+		, _running(false)
+	{
+		if (running) {
+			start();
+		}
+	}
+
+	~timer() {
+		finish(_unwind.unwinding() ? stats::result::EXCEPTION : stats::result::OK);
+
+#if defined(JWTPP_WITH_STATS)
+		if (_used) {
+			record(_stage, _alg, _elapsed);
+		}
+#endif // defined(JWTPP_WITH_STATS)
+	}
+
+	timer(const timer &) = delete;
+	timer &operator=(const timer &) = delete;
+
+	void start() noexcept {
+#if defined(JWTPP_WITH_STATS)
+		_start = now();
+		_used = true;
+#endif // defined(JWTPP_WITH_STATS)
+#if defined(JWTPP_WITH_TRACE)
+		trace::begin(_stage, _alg, trace::now());
+#endif // defined(JWTPP_WITH_TRACE)
+		_running = true;
+	}
+
+	void stop() noexcept {
+		finish(stats::result::OK);
+	}
+
+	void alg(alg_t a) noexcept { _alg = a; }
+
+private:
+	void finish(stats::result r) noexcept {
+		if (!_running) {
+			return;
+		}
+
+		_running = false;
+
+#if defined(JWTPP_WITH_STATS)
+		_elapsed += now() - _start;
+#endif // defined(JWTPP_WITH_STATS)
+#if defined(JWTPP_WITH_TRACE)
+		trace::end(_stage, _alg, r, trace::now());
+#else
+		(void)r;
+#endif // defined(JWTPP_WITH_TRACE)
+	}
+
+private:
+	stats::stage _stage;
+	alg_t        _alg;
+#if defined(JWTPP_WITH_STATS)
+	uint64_t     _start;
+	uint64_t     _elapsed;
+	bool         _used;
+#endif // defined(JWTPP_WITH_STATS)
+	bool         _running;
+	unwind_check _unwind;
+};
+
+/**
+ * \brief Top level operation, timed and with outcome
+ *
+ * Outcome stays EXCEPTION unless set, so exceptions thrown from nested calls
+ * are counted without try/catch at every call site
+ */
+class op final {
+public:
+	explicit op(stats::stage s, alg_t a = alg_t::UNKNOWN) noexcept
+		: _stage(s)
+		, _alg(a)
+		, _result(stats::result::EXCEPTION)
+#if defined(JWTPP_WITH_STATS)
+		, _start(now())
+#endif // defined(JWTPP_WITH_STATS)
+	{
+#if defined(JWTPP_WITH_TRACE)
+		trace::begin(_stage, _alg, trace::now());
+#endif // defined(JWTPP_WITH_TRACE)
+	}
+
+	~op() {
+#if defined(JWTPP_WITH_STATS)
+		record(_stage, _alg, now() - _start);
+		count(_stage, _alg, _result);
+#endif // defined(JWTPP_WITH_STATS)
+#if defined(JWTPP_WITH_TRACE)
+		trace::end(_stage, _alg, _result, trace::now());
+#endif // defined(JWTPP_WITH_TRACE)
+	}
+
+	op(const op &) = delete;
+	op &operator=(const op &) = delete;
+
+	void alg(alg_t a) noexcept { _alg = a; }
+
+	void result(stats::result r) noexcept { _result = r; }
+
+private:
+	stats::stage  _stage;
+	alg_t         _alg;
+	stats::result _result;
+#if defined(JWTPP_WITH_STATS)
+	uint64_t      _start;
+#endif // defined(JWTPP_WITH_STATS)
+};
+#else
+class timer final {
+public:
+	explicit timer(stats::stage, alg_t = alg_t::UNKNOWN, bool = true) noexcept {}
+
+	void start() noexcept {}
+	void stop() noexcept {}
+	void alg(alg_t) noexcept {}
+};
+
+class op final {
+public:
+	explicit op(stats::stage, alg_t = alg_t::UNKNOWN) noexcept {}
+
+	void alg(alg_t) noexcept {}
+	void result(stats::result) noexcept {}
+};
+#endif // defined(JWTPP_WITH_PROBES)
+
+} // namespace probe
+
+} // namespace jwtpp
@@ -0,0 +1,159 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace jwtpp {
+
+/**
+ * \brief Bounded single-producer single-consumer ring
+ *
+ * Head is written only by consumer, tail only by producer. Each side keeps
+ * a cached copy of the other index and reloads it only when the ring looks
+ * full or empty, so steady state push/pop touch one shared cache line.
+ */
+template <typename T>
+class spsc_queue final {
+public:
+	explicit spsc_queue(size_t capacity)
+		: _mask(0)
+		, _slots()
+		, _head(0)
+		, _tail(0)
+		, _cached_head(0)
+		, _cached_tail(0)
+	{
+		size_t cap = 2;
+
+		while (cap < capacity) {
+			cap <<= 1;
+		}
+
+		_mask = cap - 1;
+		_slots.reset(new T[cap]);
+	}
+
+	spsc_queue(const spsc_queue &) = delete;
+	spsc_queue &operator=(const spsc_queue &) = delete;
+
+	size_t capacity() const { return _mask + 1; }
+
+	/**
+	 * \brief Producer side
+	 *
+	 * \return false if ring is full, v is left untouched
+	 */
+	bool try_push(T &v) {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+
+		if (tail - _cached_head > _mask) {
+			_cached_head = _head.load(std::memory_order_acquire);
+
+			if (tail - _cached_head > _mask) {
+				return false;
+			}
+		}
+
+		_slots[tail & _mask] = std::move(v);
+		_tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * \brief Consumer side
+	 *
+	 * \return false if ring is empty
+	 */
+	bool try_pop(T &v) {
+		size_t head = _head.load(std::memory_order_relaxed);
+
+		if (head == _cached_tail) {
+			_cached_tail = _tail.load(std::memory_order_acquire);
+
+			if (head == _cached_tail) {
+				return false;
+			}
+		}
+
+		v = std::move(_slots[head & _mask]);
+		_slots[head & _mask] = T();
+		_head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * \brief Consumer side, may be stale
+	 */
+	bool empty() const {
+		return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+	}
+
+private:
+	static const size_t line = 64;
+
+	// padded rather than alignas, so holders need no over-aligned new
+	size_t               _mask;
+	std::unique_ptr<T[]> _slots;
+	char                 _pad0[line];
+	std::atomic<size_t>  _head;
+	char                 _pad1[line - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t>  _tail;
+	char                 _pad2[line - sizeof(std::atomic<size_t>)];
+	size_t               _cached_head; // producer
+	char                 _pad3[line - sizeof(size_t)];
+	size_t               _cached_tail; // consumer
+};
+
+/**
+ * \brief Backoff for threads waiting on queues: spin, then yield, then sleep
+ */
+class backoff final {
+public:
+	backoff() : _n(0) {}
+
+	void reset() { _n = 0; }
+
+	void wait() {
+		if (_n < 16) {
+			++_n;
+		} else if (_n < 64) {
+			++_n;
+			std::this_thread::yield();
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+
+private:
+	unsigned _n;
+};
+
+} // namespace jwtpp
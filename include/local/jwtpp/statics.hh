@@ -8,7 +8,7 @@
 #include <utility>
 #include <cstdint>
 
-#include <openssl/ssl.h>
+#include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
 
@@ -20,28 +20,34 @@ T *instantiate(Args && ...args) noexcept {
 	return new(buf) T(std::forward<T>(args)...);
 }
 
+/**
+ * \brief One time OpenSSL setup, performed on first use rather than at load time
+ *
+ * Only libcrypto is initialized. Digests and signatures are used through
+ * direct EVP_sha*()/NID references and need no registration; cipher and
+ * digest name tables are needed only to decrypt password protected PEM.
+ */
 class static_init {
 public:
 	static_init() noexcept {
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
-		SSL_library_init();
+		OpenSSL_add_all_algorithms();
 #else
-		OPENSSL_init_ssl(OPENSSL_INIT_SSL_DEFAULT, nullptr);
+		OPENSSL_init_crypto(OPENSSL_INIT_ADD_ALL_CIPHERS | OPENSSL_INIT_ADD_ALL_DIGESTS, nullptr);
 #endif
-
-		OpenSSL_add_all_algorithms();
-		OpenSSL_add_all_ciphers();
-		ERR_load_crypto_strings();
 	}
 
-	void operator()() {}
-
 	static static_init &inst() noexcept {
 		static static_init __inst;
 		return __inst;
 	}
 };
 
-extern static_init &static_instance;
+/**
+ * \brief Make sure OpenSSL is set up. Call before reading PEM
+ */
+inline void openssl_init() noexcept {
+	static_init::inst();
+}
 
 } // namespace jwtpp
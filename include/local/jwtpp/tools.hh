@@ -0,0 +1,88 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+#include <openssl/rsa.h>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+/**
+ * \brief Tag of element at given position within top level DER SEQUENCE
+ *
+ * Used to tell PKCS#1, SEC1, PKCS#8 and SPKI structures apart without trial decoding
+ *
+ * \param der
+ * \param size
+ * \param index
+ *
+ * \return tag or -1 if structure is malformed or has less elements
+ */
+int der_seq_tag(const uint8_t *der, size_t size, size_t index);
+
+/**
+ * \brief Create RSxxx or PSxxx crypto for key
+ *
+ * \param r
+ * \param a
+ *
+ * \return
+ */
+sp_crypto make_rsa_crypto(sp_rsa_key r, alg_t a);
+
+/**
+ * \brief Run single public key operation to get Montgomery context of the modulus cached within the key
+ *
+ * \param r
+ */
+void rsa_warm(RSA *r);
+
+/**
+ * \brief Serialize JWK members without whitespace as required by RFC 7638
+ *
+ * Values are emitted as JSON strings without escaping, thus must be base64url or
+ * plain ASCII identifiers. Members must be given in lexicographic order
+ *
+ * \param members
+ *
+ * \return
+ */
+std::string canonical_jwk(std::initializer_list<std::pair<const char *, std::string>> members);
+
+/**
+ * \brief Canonical public JWK of RSA key
+ *
+ * \param r
+ *
+ * \return
+ */
+std::string rsa_canonical_jwk(const RSA *r);
+
+} // namespace jwtpp
@@ -213,4 +213,97 @@ std::vector<uint8_t> b64::decode_uri(const char *in, size_t in_size) {
 	return decode(tmp.data(), tmp.length());
 }
 
+bool b64::decode_uri(const char *in, size_t in_size, uint8_t *out, size_t &out_size) noexcept {
+	// 0xff - not in alphabet
+	static const uint8_t table[256] = {
+#define XX 0xff
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX,
+		52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+		XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+		15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, 63,
+		XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+		41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+		XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+#undef XX
+	};
+
+	while (in_size > 0 && in[in_size - 1] == '=') {
+		in_size--;
+	}
+
+	if ((in_size % 4) == 1) {
+		return false;
+	}
+
+	size_t need = (in_size / 4) * 3 + ((in_size % 4) ? (in_size % 4) - 1 : 0);
+	if (need > out_size) {
+		return false;
+	}
+
+	size_t   o = 0;
+	uint32_t acc = 0;
+	size_t   bits = 0;
+
+	for (size_t i = 0; i < in_size; ++i) {
+		uint8_t v = table[static_cast<uint8_t>(in[i])];
+		if (v == 0xff) {
+			return false;
+		}
+
+		acc = (acc << 6) | v;
+		bits += 6;
+
+		if (bits >= 8) {
+			bits -= 8;
+			out[o++] = static_cast<uint8_t>(acc >> bits);
+		}
+	}
+
+	out_size = o;
+
+	return true;
+}
+
+size_t b64::encode_uri(const uint8_t *in, size_t in_size, char *out) noexcept {
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+	size_t o = 0;
+	size_t i = 0;
+
+	for (; i + 3 <= in_size; i += 3) {
+		uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+
+		out[o++] = alphabet[(v >> 18) & 0x3f];
+		out[o++] = alphabet[(v >> 12) & 0x3f];
+		out[o++] = alphabet[(v >> 6) & 0x3f];
+		out[o++] = alphabet[v & 0x3f];
+	}
+
+	if (i < in_size) {
+		uint32_t v = uint32_t(in[i]) << 16;
+
+		if (i + 1 < in_size) {
+			v |= uint32_t(in[i + 1]) << 8;
+		}
+
+		out[o++] = alphabet[(v >> 18) & 0x3f];
+		out[o++] = alphabet[(v >> 12) & 0x3f];
+
+		if (i + 1 < in_size) {
+			out[o++] = alphabet[(v >> 6) & 0x3f];
+		}
+	}
+
+	return o;
+}
+
 } // namespace jwtpp
@@ -0,0 +1,356 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <type_traits>
+
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include <jwtpp/basic.hh>
+#include <jwtpp/tools.hh>
+
+namespace jwtpp {
+
+namespace {
+
+template <alg_family F>
+using family_tag = std::integral_constant<alg_family, F>;
+
+template <digest::type H>
+struct sha;
+
+template <>
+struct sha<digest::type::SHA256> {
+	static const EVP_MD *md() { return EVP_sha256(); }
+	static void run(const uint8_t *d, size_t n, uint8_t *out) { SHA256(d, n, out); }
+};
+
+template <>
+struct sha<digest::type::SHA384> {
+	static const EVP_MD *md() { return EVP_sha384(); }
+	static void run(const uint8_t *d, size_t n, uint8_t *out) { SHA384(d, n, out); }
+};
+
+template <>
+struct sha<digest::type::SHA512> {
+	static const EVP_MD *md() { return EVP_sha512(); }
+	static void run(const uint8_t *d, size_t n, uint8_t *out) { SHA512(d, n, out); }
+};
+
+template <alg_t A>
+using hash_of = sha<alg_traits<A>::hash>;
+
+template <alg_t A>
+void check_size(size_t size) {
+	if (size > alg_traits<A>::max_signature_size) {
+		throw std::invalid_argument("key is too large");
+	}
+}
+
+// HMAC
+
+template <alg_t A>
+void check_key(const secure_string &k, family_tag<alg_family::HMAC>) {
+	if (k.empty()) {
+		throw std::invalid_argument("Invalid secret");
+	}
+}
+
+template <alg_t A>
+size_t sign_raw(const secure_string &k, const uint8_t *d, size_t n, uint8_t *sig, family_tag<alg_family::HMAC>) {
+	unsigned int len = 0;
+
+	if (HMAC(hash_of<A>::md(), k.data(), static_cast<int>(k.size()), d, n, sig, &len) == nullptr) {
+		throw std::runtime_error("Couldn't sign HMAC");
+	}
+
+	return len;
+}
+
+template <alg_t A>
+bool verify_raw(const secure_string &k, const uint8_t *d, size_t n, const uint8_t *sig, size_t sig_size, family_tag<alg_family::HMAC> tag) {
+	uint8_t mac[alg_traits<A>::max_signature_size];
+
+	size_t len = sign_raw<A>(k, d, n, mac, tag);
+
+	return sig_size == len && CRYPTO_memcmp(mac, sig, len) == 0;
+}
+
+// RSASSA-PKCS1-v1_5
+
+template <alg_t A>
+void check_key(const sp_rsa_key &k, family_tag<alg_family::RSA>) {
+	if (!k) {
+		throw std::invalid_argument("Invalid key");
+	}
+
+	check_size<A>(static_cast<size_t>(RSA_size(k.get())));
+}
+
+template <alg_t A>
+size_t sign_raw(const sp_rsa_key &k, const uint8_t *d, size_t n, uint8_t *sig, family_tag<alg_family::RSA>) {
+	check_size<A>(static_cast<size_t>(RSA_size(k.get())));
+
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	unsigned int len = 0;
+
+	if (RSA_sign(alg_traits<A>::hash_nid, h, sizeof(h), sig, &len, k.get()) != 1) {
+		throw std::runtime_error("Couldn't sign RSA");
+	}
+
+	return len;
+}
+
+template <alg_t A>
+bool verify_raw(const sp_rsa_key &k, const uint8_t *d, size_t n, const uint8_t *sig, size_t sig_size, family_tag<alg_family::RSA>) {
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	return RSA_verify(alg_traits<A>::hash_nid, h, sizeof(h), sig, static_cast<unsigned int>(sig_size), k.get()) == 1;
+}
+
+// RSASSA-PSS
+
+template <alg_t A>
+void check_key(const sp_rsa_key &k, family_tag<alg_family::PSS>) {
+	check_key<A>(k, family_tag<alg_family::RSA>());
+}
+
+template <alg_t A>
+size_t sign_raw(const sp_rsa_key &k, const uint8_t *d, size_t n, uint8_t *sig, family_tag<alg_family::PSS>) {
+	auto key_size = static_cast<size_t>(RSA_size(k.get()));
+
+	check_size<A>(key_size);
+
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	uint8_t padded[alg_traits<A>::max_signature_size];
+
+	if (RSA_padding_add_PKCS1_PSS(k.get(), padded, h, hash_of<A>::md(), -1) != 1) {
+		throw std::runtime_error("failed to create signature");
+	}
+
+	if (RSA_private_encrypt(static_cast<int>(key_size), padded, sig, k.get(), RSA_NO_PADDING) < 0) {
+		throw std::runtime_error("couldn't sign RSA");
+	}
+
+	return key_size;
+}
+
+template <alg_t A>
+bool verify_raw(const sp_rsa_key &k, const uint8_t *d, size_t n, const uint8_t *sig, size_t sig_size, family_tag<alg_family::PSS>) {
+	check_size<A>(static_cast<size_t>(RSA_size(k.get())));
+
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	uint8_t decrypted[alg_traits<A>::max_signature_size];
+
+	if (RSA_public_decrypt(static_cast<int>(sig_size), sig, decrypted, k.get(), RSA_NO_PADDING) < 0) {
+		throw std::runtime_error("invalid signature");
+	}
+
+	return RSA_verify_PKCS1_PSS(k.get(), h, hash_of<A>::md(), decrypted, -1) == 1;
+}
+
+// ECDSA
+
+template <alg_t A>
+void check_key(const sp_ecdsa_key &k, family_tag<alg_family::ECDSA>) {
+	if (!k) {
+		throw std::invalid_argument("Invalid key");
+	}
+
+	check_size<A>(static_cast<size_t>(ECDSA_size(k.get())));
+}
+
+template <alg_t A>
+size_t sign_raw(const sp_ecdsa_key &k, const uint8_t *d, size_t n, uint8_t *sig, family_tag<alg_family::ECDSA>) {
+	check_size<A>(static_cast<size_t>(ECDSA_size(k.get())));
+
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	unsigned int len = 0;
+
+	if (ECDSA_sign(0, h, sizeof(h), sig, &len, k.get()) != 1) {
+		throw std::runtime_error("Couldn't sign ECDSA");
+	}
+
+	return len;
+}
+
+template <alg_t A>
+bool verify_raw(const sp_ecdsa_key &k, const uint8_t *d, size_t n, const uint8_t *sig, size_t sig_size, family_tag<alg_family::ECDSA>) {
+	uint8_t h[alg_traits<A>::hash_size];
+	hash_of<A>::run(d, n, h);
+
+	return ECDSA_verify(0, h, sizeof(h), sig, static_cast<int>(sig_size), k.get()) == 1;
+}
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+// EdDSA
+
+template <alg_t A>
+void check_key(const sp_evp_key &k, family_tag<alg_family::EDDSA>) {
+	if (!k) {
+		throw std::invalid_argument("Invalid key");
+	}
+
+	check_size<A>(static_cast<size_t>(EVP_PKEY_size(k.get())));
+}
+
+template <alg_t A>
+size_t sign_raw(const sp_evp_key &k, const uint8_t *d, size_t n, uint8_t *sig, family_tag<alg_family::EDDSA>) {
+	auto md = sp_evp_md_ctx(EVP_MD_CTX_new(), ::EVP_MD_CTX_free);
+
+	if (EVP_DigestSignInit(md.get(), nullptr, nullptr, nullptr, k.get()) != 1) {
+		throw std::runtime_error("eddsa: digest sign init");
+	}
+
+	size_t len = alg_traits<A>::max_signature_size;
+
+	if (EVP_DigestSign(md.get(), sig, &len, d, n) != 1) {
+		throw std::runtime_error("eddsa: digest sign");
+	}
+
+	return len;
+}
+
+template <alg_t A>
+bool verify_raw(const sp_evp_key &k, const uint8_t *d, size_t n, const uint8_t *sig, size_t sig_size, family_tag<alg_family::EDDSA>) {
+	auto md = sp_evp_md_ctx(EVP_MD_CTX_new(), ::EVP_MD_CTX_free);
+
+	if (EVP_DigestVerifyInit(md.get(), nullptr, nullptr, nullptr, k.get()) != 1) {
+		throw std::runtime_error("eddsa: digest verify init");
+	}
+
+	return EVP_DigestVerify(md.get(), sig, sig_size, d, n) == 1;
+}
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+
+// HMAC is checked on the encoded form so non canonical encodings of
+// the same MAC are rejected as before; comparison is constant time
+template <alg_t A>
+bool verify_encoded(const typename alg_traits<A>::key_type &k, const std::string &data, const std::string &sig, std::true_type) {
+	uint8_t mac[alg_traits<A>::max_signature_size];
+	char    enc[b64::encoded_uri_size(alg_traits<A>::max_signature_size)];
+
+	size_t len = sign_raw<A>(k, reinterpret_cast<const uint8_t *>(data.data()), data.size(), mac, family_tag<alg_traits<A>::family>());
+	size_t enc_len = b64::encode_uri(mac, len, enc);
+
+	return sig.size() == enc_len && CRYPTO_memcmp(enc, sig.data(), enc_len) == 0;
+}
+
+template <alg_t A>
+bool verify_encoded(const typename alg_traits<A>::key_type &k, const std::string &data, const std::string &sig, std::false_type) {
+	uint8_t raw[alg_traits<A>::max_signature_size];
+	size_t  raw_size = sizeof(raw);
+
+	if (!b64::decode_uri(sig.data(), sig.size(), raw, raw_size)) {
+		return false;
+	}
+
+	return verify_raw<A>(k, reinterpret_cast<const uint8_t *>(data.data()), data.size(), raw, raw_size, family_tag<alg_traits<A>::family>());
+}
+
+} // namespace
+
+template <alg_t A>
+basic_signer<A>::basic_signer(key_type key)
+	: _key(std::move(key))
+{
+	check_key<A>(_key, family_tag<traits::family>());
+}
+
+template <alg_t A>
+size_t basic_signer<A>::sign(const key_type &key, const uint8_t *data, size_t size, uint8_t *sig) {
+	return sign_raw<A>(key, data, size, sig, family_tag<traits::family>());
+}
+
+template <alg_t A>
+std::string basic_signer<A>::sign(const key_type &key, const std::string &data) {
+	if (data.empty()) {
+		throw std::invalid_argument("data is empty");
+	}
+
+	uint8_t sig[max_signature_size];
+	char    enc[max_encoded_size];
+
+	size_t len = sign(key, reinterpret_cast<const uint8_t *>(data.data()), data.size(), sig);
+
+	return std::string(enc, b64::encode_uri(sig, len, enc));
+}
+
+template <alg_t A>
+basic_verifier<A>::basic_verifier(key_type key)
+	: _key(std::move(key))
+{
+	check_key<A>(_key, family_tag<traits::family>());
+}
+
+template <alg_t A>
+bool basic_verifier<A>::verify(const key_type &key, const uint8_t *data, size_t size, const uint8_t *sig, size_t sig_size) {
+	return verify_raw<A>(key, data, size, sig, sig_size, family_tag<traits::family>());
+}
+
+template <alg_t A>
+bool basic_verifier<A>::verify(const key_type &key, const std::string &data, const std::string &sig) {
+	return verify_encoded<A>(key, data, sig, std::integral_constant<bool, traits::family == alg_family::HMAC>());
+}
+
+template class basic_signer<alg_t::HS256>;
+template class basic_signer<alg_t::HS384>;
+template class basic_signer<alg_t::HS512>;
+template class basic_signer<alg_t::RS256>;
+template class basic_signer<alg_t::RS384>;
+template class basic_signer<alg_t::RS512>;
+template class basic_signer<alg_t::PS256>;
+template class basic_signer<alg_t::PS384>;
+template class basic_signer<alg_t::PS512>;
+template class basic_signer<alg_t::ES256>;
+template class basic_signer<alg_t::ES384>;
+template class basic_signer<alg_t::ES512>;
+
+template class basic_verifier<alg_t::HS256>;
+template class basic_verifier<alg_t::HS384>;
+template class basic_verifier<alg_t::HS512>;
+template class basic_verifier<alg_t::RS256>;
+template class basic_verifier<alg_t::RS384>;
+template class basic_verifier<alg_t::RS512>;
+template class basic_verifier<alg_t::PS256>;
+template class basic_verifier<alg_t::PS384>;
+template class basic_verifier<alg_t::PS512>;
+template class basic_verifier<alg_t::ES256>;
+template class basic_verifier<alg_t::ES384>;
+template class basic_verifier<alg_t::ES512>;
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+template class basic_signer<alg_t::EdDSA>;
+template class basic_verifier<alg_t::EdDSA>;
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+
+} // namespace jwtpp
@@ -21,8 +21,10 @@
 // SOFTWARE.
 
 #include <sstream>
+#include <utility>
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/csprng.hh>
 
 namespace jwtpp {
 
@@ -33,6 +35,17 @@ void claims::set::any(const std::string &key, const std::string &value) {
 	_claims->operator[](key) = value;
 }
 
+void claims::set::jti() {
+	uint8_t raw[16];
+	char    id[24];
+
+	csprng::fill(raw, sizeof(raw));
+
+	auto size = b64::encode_uri(raw, sizeof(raw), id);
+
+	_claims->operator[]("jti") = Json::Value(id, id + size);
+}
+
 claims::claims()
 	: _claims()
 	, _set(&_claims)
@@ -63,6 +76,34 @@ claims::claims(const std::string &d, bool b64) :
 	}
 }
 
+claims::claims(const claims &other)
+	: _claims(other._claims)
+	, _set(&_claims)
+	, _get(&_claims)
+	, _has(&_claims)
+	, _del(&_claims)
+	, _check(&_claims)
+{}
+
+claims::claims(claims &&other) noexcept
+	: _claims(std::move(other._claims))
+	, _set(&_claims)
+	, _get(&_claims)
+	, _has(&_claims)
+	, _del(&_claims)
+	, _check(&_claims)
+{}
+
+claims &claims::operator=(const claims &other) {
+	_claims = other._claims;
+	return *this;
+}
+
+claims &claims::operator=(claims &&other) noexcept {
+	_claims = std::move(other._claims);
+	return *this;
+}
+
 std::string claims::b64() {
 	return marshal_b64(_claims);
 }
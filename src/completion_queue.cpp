@@ -0,0 +1,172 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <jwtpp/completion_queue.hh>
+
+namespace jwtpp {
+
+completion_queue::completion_queue(size_t capacity)
+	: _ring()
+	, _mask(0)
+	, _tail(0)
+	, _head(0)
+	, _signalled(false)
+	, _fd(-1)
+{
+	size_t cap = 2;
+
+	while (cap < capacity) {
+		cap <<= 1;
+	}
+
+	_ring.reset(new slot[cap]);
+	_mask = cap - 1;
+
+	for (size_t i = 0; i < cap; ++i) {
+		_ring[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_fd < 0) {
+		throw std::system_error(errno, std::system_category(), "eventfd");
+	}
+}
+
+completion_queue::~completion_queue() {
+	::close(_fd);
+}
+
+void completion_queue::sign_claims(executor &ex, uint64_t tag, sp_claims cl, sp_crypto c) {
+	ex.sign_claims(std::move(cl), std::move(c), [this, tag](std::exception_ptr e, std::string token) {
+		completion r;
+		r.tag   = tag;
+		r.kind  = op::SIGN;
+		r.ok    = !e;
+		r.token = std::move(token);
+		r.error = e;
+
+		push(std::move(r));
+	});
+}
+
+void completion_queue::verify(executor &ex, uint64_t tag, std::string bearer, sp_crypto c, jws::verify_cb v) {
+	ex.verify(std::move(bearer), std::move(c), std::move(v), [this, tag](std::exception_ptr e, bool ok) {
+		completion r;
+		r.tag   = tag;
+		r.kind  = op::VERIFY;
+		r.ok    = !e && ok;
+		r.error = e;
+
+		push(std::move(r));
+	});
+}
+
+// bounded MPSC ring: slot sequence equals position when free for producer
+// at that position, position + 1 when filled for consumer
+void completion_queue::push(completion &&c) {
+	size_t pos = _tail.load(std::memory_order_relaxed);
+	slot  *s;
+
+	for (;;) {
+		s = &_ring[pos & _mask];
+
+		size_t seq  = s->seq.load(std::memory_order_acquire);
+		auto   diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+		if (diff == 0) {
+			if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// full, wait for the loop to drain
+			std::this_thread::yield();
+			pos = _tail.load(std::memory_order_relaxed);
+		} else {
+			pos = _tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	s->value = std::move(c);
+	s->seq.store(pos + 1, std::memory_order_release);
+
+	signal();
+}
+
+size_t completion_queue::drain(std::vector<completion> &out, size_t max) {
+	uint64_t v;
+
+	// consume signal before looking at ring, anything pushed after this
+	// point is either seen below or signals again
+	if (::read(_fd, &v, sizeof(v)) < 0 && errno != EAGAIN) {
+		throw std::system_error(errno, std::system_category(), "eventfd read");
+	}
+
+	_signalled.store(false);
+
+	size_t n = 0;
+
+	while (n < max) {
+		slot &s = _ring[_head & _mask];
+
+		if (s.seq.load(std::memory_order_acquire) != _head + 1) {
+			break;
+		}
+
+		out.push_back(std::move(s.value));
+		s.value = completion();
+		s.seq.store(_head + _mask + 1, std::memory_order_release);
+
+		++_head;
+		++n;
+	}
+
+	// stopped by max with completions left: keep fd readable
+	if (n == max && _ring[_head & _mask].seq.load(std::memory_order_acquire) == _head + 1) {
+		signal();
+	}
+
+	return n;
+}
+
+void completion_queue::signal() {
+	if (_signalled.exchange(true)) {
+		return;
+	}
+
+	uint64_t one = 1;
+
+	while (::write(_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+	}
+}
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
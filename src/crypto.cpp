@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -28,6 +29,9 @@ crypto::crypto(alg_t a)
 	: _alg(a)
 	, _hdr()
 	, _hash_type(digest::type::SHA256)
+	, _kid()
+	, _thumbprint_once()
+	, _thumbprint()
 {
 	if (a == alg_t::HS256 || a == alg_t::RS256 || a == alg_t::ES256 || a == alg_t::PS256) {
 		_hash_type = digest::type::SHA256;
@@ -46,77 +50,77 @@ crypto::crypto(alg_t a)
 
 crypto::~crypto() {}
 
-const char *crypto::alg2str(alg_t a) {
-	switch (a) {
-	case alg_t::NONE:
-		return "none";
-	case alg_t::HS256:
-		return "HS256";
-	case alg_t::HS384:
-		return "HS384";
-	case alg_t::HS512:
-		return "HS512";
-	case alg_t::RS256:
-		return "RS256";
-	case alg_t::RS384:
-		return "RS384";
-	case alg_t::RS512:
-		return "RS512";
-	case alg_t::ES256:
-		return "ES256";
-	case alg_t::ES384:
-		return "ES384";
-	case alg_t::ES512:
-		return "ES512";
-	case alg_t::PS256:
-		return "PS256";
-	case alg_t::PS384:
-		return "PS384";
-	case alg_t::PS512:
-		return "PS512";
-#if defined(JWTPP_SUPPORTED_EDDSA)
-	case alg_t::EdDSA:
-		return "EdDSA";
-#endif // defined(JWTPP_SUPPORTED_EDDSA)
-	default:
-		return nullptr;
+void crypto::sign_many(const string_view *data, size_t count, std::string *sigs) {
+	for (size_t i = 0; i < count; i++) {
+		sigs[i] = sign(std::string(data[i]));
 	}
 }
 
-alg_t crypto::str2alg(const std::string &a) {
-	if (a == "none") {
-		return alg_t::NONE;
-	} else if (a == "HS256") {
-		return alg_t::HS256;
-	} else if (a == "HS384") {
-		return alg_t::HS384;
-	} else if (a == "HS512") {
-		return alg_t::HS512;
-	} else if (a == "RS256") {
-		return alg_t::RS256;
-	} else if (a == "RS384") {
-		return alg_t::RS384;
-	} else if (a == "RS512") {
-		return alg_t::RS512;
-	} else if (a == "ES256") {
-		return alg_t::ES256;
-	} else if (a == "ES384") {
-		return alg_t::ES384;
-	} else if (a == "ES512") {
-		return alg_t::ES512;
-	} else if (a == "PS256") {
-		return alg_t::PS256;
-	} else if (a == "PS384") {
-		return alg_t::PS384;
-	} else if (a == "PS512") {
-		return alg_t::PS512;
-	} else if (a == "EdDSA") {
+const std::string &crypto::thumbprint() const {
+	std::call_once(_thumbprint_once, [this]() {
+		auto jwk = canonical_jwk();
+
+		digest d(digest::type::SHA256, reinterpret_cast<const uint8_t *>(jwk.data()), jwk.size());
+
+		_thumbprint = b64::encode_uri(d.data(), d.size());
+	});
+
+	return _thumbprint;
+}
+
+std::string crypto::canonical_jwk() const {
+	throw std::runtime_error("thumbprint is not supported by key type");
+}
+
+#if __cplusplus < 201703L
+constexpr const char *crypto::alg_names[];
+#endif // __cplusplus < 201703L
+
+namespace {
+
+// all five char names differ in (name[0] * 2 + name[2]) mod 32
+constexpr unsigned alg_slot(char c0, char c2) {
+	return ((static_cast<unsigned>(static_cast<unsigned char>(c0)) << 1) + static_cast<unsigned char>(c2)) & 31;
+}
+
+static_assert(alg_slot('H', '2') ==  2 && alg_slot('H', '3') ==  3 && alg_slot('H', '5') ==  5, "HS slots");
+static_assert(alg_slot('R', '2') == 22 && alg_slot('R', '3') == 23 && alg_slot('R', '5') == 25, "RS slots");
+static_assert(alg_slot('E', '2') == 28 && alg_slot('E', '3') == 29 && alg_slot('E', '5') == 31, "ES slots");
+static_assert(alg_slot('P', '2') == 18 && alg_slot('P', '3') == 19 && alg_slot('P', '5') == 21, "PS slots");
+static_assert(alg_slot('E', 'D') == 14, "EdDSA slot");
+
 #if defined(JWTPP_SUPPORTED_EDDSA)
-		return alg_t::EdDSA;
+constexpr alg_t eddsa_slot = alg_t::EdDSA;
+#else
+constexpr alg_t eddsa_slot = alg_t::UNKNOWN;
 #endif // defined(JWTPP_SUPPORTED_EDDSA)
-	} else {
-		return alg_t::UNKNOWN;
+
+constexpr alg_t alg_by_slot[32] = {
+	alg_t::UNKNOWN, alg_t::UNKNOWN, alg_t::HS256,   alg_t::HS384,   // 0
+	alg_t::UNKNOWN, alg_t::HS512,   alg_t::UNKNOWN, alg_t::UNKNOWN, // 4
+	alg_t::UNKNOWN, alg_t::UNKNOWN, alg_t::UNKNOWN, alg_t::UNKNOWN, // 8
+	alg_t::UNKNOWN, alg_t::UNKNOWN, eddsa_slot,     alg_t::UNKNOWN, // 12
+	alg_t::UNKNOWN, alg_t::UNKNOWN, alg_t::PS256,   alg_t::PS384,   // 16
+	alg_t::UNKNOWN, alg_t::PS512,   alg_t::RS256,   alg_t::RS384,   // 20
+	alg_t::UNKNOWN, alg_t::RS512,   alg_t::UNKNOWN, alg_t::UNKNOWN, // 24
+	alg_t::ES256,   alg_t::ES384,   alg_t::UNKNOWN, alg_t::ES512,   // 28
+};
+
+} // namespace
+
+alg_t crypto::str2alg(string_view a) noexcept {
+	if (a.size() == 5) {
+		alg_t       candidate = alg_by_slot[alg_slot(a[0], a[2])];
+		const char *name = alg2str(candidate);
+
+		if (name != nullptr && std::memcmp(name, a.data(), 5) == 0) {
+			return candidate;
+		}
+	} else if (a.size() == 4 && std::memcmp(a.data(), "none", 4) == 0) {
+		return alg_t::NONE;
 	}
+
+	return alg_t::UNKNOWN;
 }
 
 int crypto::hash2nid(digest::type type) {
@@ -137,4 +141,25 @@ int crypto::hash2nid(digest::type type) {
 	return ret;
 }
 
+int crypto::password_loader(char *buf, int size, int rwflag, void *u) {
+	auto wrap = reinterpret_cast<on_password_wrap *>(u);
+
+	if (wrap->cb == nullptr) {
+		wrap->required = true;
+		return 0;
+	}
+
+	secure_string pass;
+	int pass_size = 0;
+
+	try {
+		wrap->cb(pass, rwflag);
+		pass_size = pass.copy(buf, secure_string::size_type(size), 0);
+	} catch (...) {
+		pass_size = 0;
+	}
+
+	return pass_size;
+}
+
 } // namespace jwtpp
@@ -0,0 +1,218 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/csprng.hh>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#if defined(__linux__)
+#include <sys/random.h>
+#endif // defined(__linux__)
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif // !defined(_WIN32)
+
+namespace jwtpp {
+namespace csprng {
+
+namespace {
+
+void os_entropy(uint8_t *out, size_t size) {
+#if defined(__linux__)
+	while (size > 0) {
+		auto n = ::getrandom(out, size, 0);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			break;
+		}
+
+		out  += n;
+		size -= static_cast<size_t>(n);
+	}
+
+	if (size == 0) {
+		return;
+	}
+#endif // defined(__linux__)
+
+	// OpenSSL DRBG is seeded from the OS as well
+	if (RAND_bytes(out, static_cast<int>(size)) != 1) {
+		throw std::runtime_error("csprng: no entropy");
+	}
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+
+// bumped in child after fork(), generators created earlier reseed
+std::atomic<uint64_t> fork_generation(0);
+
+#if !defined(_WIN32)
+void on_fork_child() {
+	fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+#endif // !defined(_WIN32)
+
+void register_fork_handler() {
+#if !defined(_WIN32)
+	static std::once_flag once;
+	std::call_once(once, []() {
+		pthread_atfork(nullptr, nullptr, on_fork_child);
+	});
+#endif // !defined(_WIN32)
+}
+
+class generator final {
+public:
+	static const size_t key_size = 32;
+	static const size_t iv_size = 16;
+	static const size_t buf_size = 512;
+	static const size_t reseed_bytes = 1 << 20;
+
+public:
+	generator()
+		: _ctx(EVP_CIPHER_CTX_new())
+		, _avail(0)
+		, _since_seed(0)
+		, _fork_generation(0)
+		, _seeded(false)
+	{
+		if (_ctx == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		register_fork_handler();
+	}
+
+	~generator() {
+		EVP_CIPHER_CTX_free(_ctx);
+		OPENSSL_cleanse(_buf, sizeof(_buf));
+	}
+
+	generator(const generator &) = delete;
+	generator &operator=(const generator &) = delete;
+
+	void fill(uint8_t *out, size_t size) {
+		auto fg = fork_generation.load(std::memory_order_relaxed);
+
+		if (!_seeded || fg != _fork_generation || _since_seed >= reseed_bytes) {
+			seed(fg);
+		}
+
+		_since_seed += size;
+
+		while (size > 0) {
+			if (_avail == 0) {
+				refill();
+			}
+
+			size_t n = size < _avail ? size : _avail;
+			uint8_t *src = _buf + buf_size - _avail;
+
+			std::memcpy(out, src, n);
+
+			// served bytes are never kept
+			std::memset(src, 0, n);
+
+			out    += n;
+			size   -= n;
+			_avail -= n;
+		}
+	}
+
+private:
+	void seed(uint64_t fg) {
+		uint8_t kiv[key_size + iv_size];
+		os_entropy(kiv, sizeof(kiv));
+
+		rekey(kiv);
+
+		_avail = 0;
+		_since_seed = 0;
+		_fork_generation = fg;
+		_seeded = true;
+	}
+
+	void rekey(uint8_t *kiv) {
+		bool ok = EVP_EncryptInit_ex(_ctx, EVP_chacha20(), nullptr, kiv, kiv + key_size) == 1;
+
+		OPENSSL_cleanse(kiv, key_size + iv_size);
+
+		if (!ok) {
+			throw std::runtime_error("csprng: chacha20 init failed");
+		}
+	}
+
+	// keystream block; its head becomes next key, so state captured later cannot recover output already served
+	void refill() {
+		int n = 0;
+
+		std::memset(_buf, 0, sizeof(_buf));
+
+		if (EVP_EncryptUpdate(_ctx, _buf, &n, _buf, static_cast<int>(sizeof(_buf))) != 1 ||
+		    static_cast<size_t>(n) != sizeof(_buf)) {
+			throw std::runtime_error("csprng: chacha20 failed");
+		}
+
+		rekey(_buf);
+
+		_avail = buf_size - key_size - iv_size;
+	}
+
+private:
+	EVP_CIPHER_CTX *_ctx;
+	uint8_t         _buf[buf_size];
+	size_t          _avail;
+	size_t          _since_seed;
+	uint64_t        _fork_generation;
+	bool            _seeded;
+};
+
+#endif // OPENSSL_VERSION_NUMBER >= 0x10100000L
+
+} // namespace
+
+void fill(uint8_t *out, size_t size) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	static thread_local generator g;
+
+	g.fill(out, size);
+#else
+	// no ChaCha20 in EVP, OpenSSL DRBG is used as is
+	os_entropy(out, size);
+#endif // OPENSSL_VERSION_NUMBER >= 0x10100000L
+}
+
+} // namespace csprng
+} // namespace jwtpp
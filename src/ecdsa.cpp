@@ -21,8 +21,13 @@
 // SOFTWARE.
 
 #include <openssl/err.h>
+#include <openssl/x509.h>
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
+#include <jwtpp/statics.hh>
+#include <jwtpp/basic.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -36,35 +41,73 @@ ecdsa::ecdsa(sp_ecdsa_key key, alg_t a)
 }
 
 std::string ecdsa::sign(const std::string &data) {
-	if (data.empty()) {
-		throw std::invalid_argument("data is empty");
+	probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
+
+	switch (_alg) {
+	case alg_t::ES256: return basic_signer<alg_t::ES256>::sign(_e, data);
+	case alg_t::ES384: return basic_signer<alg_t::ES384>::sign(_e, data);
+	case alg_t::ES512: return basic_signer<alg_t::ES512>::sign(_e, data);
+	default:
+		throw std::runtime_error("Invalid alg");
 	}
+}
+
+bool ecdsa::verify(const std::string &data, const std::string &sig) {
+	probe::timer t(stats::stage::CRYPTO_VERIFY, _alg);
 
-	auto sig = std::shared_ptr<uint8_t>(new uint8_t[ECDSA_size(_e.get())], std::default_delete<uint8_t[]>());
+	switch (_alg) {
+	case alg_t::ES256: return basic_verifier<alg_t::ES256>::verify(_e, data, sig);
+	case alg_t::ES384: return basic_verifier<alg_t::ES384>::verify(_e, data, sig);
+	case alg_t::ES512: return basic_verifier<alg_t::ES512>::verify(_e, data, sig);
+	default:
+		throw std::runtime_error("Invalid alg");
+	}
+}
 
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
+std::string ecdsa::canonical_jwk() const {
+	const EC_GROUP *group = EC_KEY_get0_group(_e.get());
 
-	uint32_t sig_len;
+	const char *crv;
 
-	if (ECDSA_sign(0, d.data(), static_cast<int>(d.size()), sig.get(), &sig_len, _e.get()) != 1) {
-		throw std::runtime_error("Couldn't sign ECDSA");
+	switch (EC_GROUP_get_curve_name(group)) {
+	case NID_X9_62_prime256v1:
+		crv = "P-256";
+		break;
+	case NID_secp384r1:
+		crv = "P-384";
+		break;
+	case NID_secp521r1:
+		crv = "P-521";
+		break;
+	case NID_secp256k1:
+		crv = "secp256k1";
+		break;
+	default:
+		throw std::runtime_error("thumbprint is not supported for curve");
 	}
 
-	return b64::encode_uri(sig.get(), sig_len);
-}
+	auto x = std::shared_ptr<BIGNUM>(BN_new(), ::BN_free);
+	auto y = std::shared_ptr<BIGNUM>(BN_new(), ::BN_free);
 
-bool ecdsa::verify(const std::string &data, const std::string &sig) {
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
+	if (EC_POINT_get_affine_coordinates_GFp(group, EC_KEY_get0_public_key(_e.get()), x.get(), y.get(), nullptr) != 1) {
+		throw std::runtime_error("Couldn't get EC PUB KEY coordinates");
+	}
+
+	// coordinates are padded to the size of the field
+	auto size = static_cast<size_t>((EC_GROUP_get_degree(group) + 7) / 8);
 
-	auto s = b64::decode_uri(sig.data(), sig.length());
+	std::vector<uint8_t> x_raw(size);
+	std::vector<uint8_t> y_raw(size);
 
-	return ECDSA_verify(
-		0
-		, d.data()
-		, static_cast<int>(d.size())
-		, reinterpret_cast<const uint8_t *>(s.data())
-		, static_cast<int>(s.size())
-		, _e.get()) == 1;
+	BN_bn2binpad(x.get(), x_raw.data(), static_cast<int>(size));
+	BN_bn2binpad(y.get(), y_raw.data(), static_cast<int>(size));
+
+	return jwtpp::canonical_jwk({
+		{"crv", crv},
+		{"kty", "EC"},
+		{"x",   b64::encode_uri(x_raw)},
+		{"y",   b64::encode_uri(y_raw)},
+	});
 }
 
 sp_ecdsa_key ecdsa::gen(int nid) {
@@ -104,4 +147,126 @@ sp_ecdsa_key ecdsa::gen(int nid) {
 	return key;
 }
 
+sp_ecdsa_key ecdsa::load_from_file(const std::string &path, password_cb on_password) {
+	openssl_init();
+
+	auto f = up_file(::std::fopen(path.c_str(), "re"), ::std::fclose);
+	if (!f) {
+		throw std::runtime_error("cannot open file " + path);
+	}
+
+	on_password_wrap wrap(on_password);
+
+	EC_KEY *e = PEM_read_ECPrivateKey(f.get(), nullptr, password_loader, &wrap);
+	if (wrap.required) {
+		throw std::runtime_error("password required");
+	} else if (e == nullptr) {
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return std::shared_ptr<EC_KEY>(e, ::EC_KEY_free);
+}
+
+sp_ecdsa_key ecdsa::load_from_string(const std::string &str, password_cb on_password) {
+	openssl_init();
+
+	auto bio = std::unique_ptr<BIO, BIODeleter>{BIO_new_mem_buf(str.data(), static_cast<int>(str.size()))};
+
+	on_password_wrap wrap(on_password);
+
+	EC_KEY *e = PEM_read_bio_ECPrivateKey(bio.get(), nullptr, password_loader, &wrap);
+	if (wrap.required) {
+		throw std::runtime_error("password required");
+	} else if (e == nullptr) {
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return std::shared_ptr<EC_KEY>(e, ::EC_KEY_free);
+}
+
+sp_ecdsa_key ecdsa::load_private_der(const uint8_t *der, size_t size) {
+	EC_KEY *e = nullptr;
+
+	const uint8_t *p = der;
+
+	switch (der_seq_tag(der, size, 1)) {
+	case V_ASN1_OCTET_STRING:
+		// SEC1 ECPrivateKey
+		e = d2i_ECPrivateKey(nullptr, &p, static_cast<long>(size));
+		break;
+	case V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED: {
+		// PKCS#8 PrivateKeyInfo
+		auto p8 = std::shared_ptr<PKCS8_PRIV_KEY_INFO>(
+			d2i_PKCS8_PRIV_KEY_INFO(nullptr, &p, static_cast<long>(size)), ::PKCS8_PRIV_KEY_INFO_free);
+
+		if (p8) {
+			auto pkey = sp_evp_key(EVP_PKCS82PKEY(p8.get()), ::EVP_PKEY_free);
+			if (pkey) {
+				e = EVP_PKEY_get1_EC_KEY(pkey.get());
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (e == nullptr) {
+		ERR_clear_error();
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return std::shared_ptr<EC_KEY>(e, ::EC_KEY_free);
+}
+
+sp_ecdsa_key ecdsa::load_public_der(const uint8_t *der, size_t size) {
+	const uint8_t *p = der;
+
+	EC_KEY *e = d2i_EC_PUBKEY(nullptr, &p, static_cast<long>(size));
+	if (e == nullptr) {
+		ERR_clear_error();
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return std::shared_ptr<EC_KEY>(e, ::EC_KEY_free);
+}
+
+sp_ecdsa_key ecdsa::load_raw_public(int nid, const uint8_t *point, size_t size) {
+	sp_ecdsa_key key(EC_KEY_new_by_curve_name(nid), ::EC_KEY_free);
+	if (!key) {
+		ERR_clear_error();
+		throw std::invalid_argument("unsupported curve");
+	}
+
+	if (EC_KEY_oct2key(key.get(), point, size, nullptr) != 1) {
+		ERR_clear_error();
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return key;
+}
+
+sp_ecdsa_key ecdsa::load_raw_private(int nid, const uint8_t *d, size_t size) {
+	sp_ecdsa_key key(EC_KEY_new_by_curve_name(nid), ::EC_KEY_free);
+	if (!key) {
+		ERR_clear_error();
+		throw std::invalid_argument("unsupported curve");
+	}
+
+	auto priv = std::shared_ptr<BIGNUM>(BN_bin2bn(d, static_cast<int>(size), nullptr), ::BN_clear_free);
+
+	const EC_GROUP *group = EC_KEY_get0_group(key.get());
+	auto pub = std::shared_ptr<EC_POINT>(EC_POINT_new(group), ::EC_POINT_free);
+
+	if (!priv
+		|| EC_KEY_set_private_key(key.get(), priv.get()) != 1
+		|| EC_POINT_mul(group, pub.get(), priv.get(), nullptr, nullptr, nullptr) != 1
+		|| EC_KEY_set_public_key(key.get(), pub.get()) != 1) {
+		ERR_clear_error();
+		throw std::runtime_error("read ecdsa key");
+	}
+
+	return key;
+}
+
 } // namespace jwtpp
@@ -21,11 +21,17 @@
 // SOFTWARE.
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
+#include <jwtpp/statics.hh>
 
 #if defined(JWTPP_SUPPORTED_EDDSA)
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/crypto.h>
+#include <openssl/x509.h>
+
+#include <jwtpp/basic.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -39,41 +45,30 @@ eddsa::eddsa(sp_evp_key key, alg_t a)
 }
 
 std::string eddsa::sign(const std::string &data) {
-	if (data.empty()) {
-		throw std::invalid_argument("data is empty");
-	}
-
-	auto md = sp_evp_md_ctx(EVP_MD_CTX_new(), ::EVP_MD_CTX_free);
-
-	EVP_MD_CTX_init(md.get());
-
-	if (EVP_DigestSignInit(md.get(), nullptr, nullptr, nullptr, _e.get()) != 1) {
-		throw std::runtime_error("eddsa: digest sign init");
-	}
-
-	size_t sig_len = EVP_PKEY_size(_e.get());
+	probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
 
-	auto sig = std::shared_ptr<uint8_t>(new uint8_t[sig_len], std::default_delete<uint8_t[]>());
-
-	if (EVP_DigestSign(md.get(), sig.get(), &sig_len, (const uint8_t *)data.data(), data.size()) != 1) {
-		throw std::runtime_error("eddsa: digest sign");
-	}
-
-	return b64::encode_uri(sig.get(), sig_len);
+	return basic_signer<alg_t::EdDSA>::sign(_e, data);
 }
 
 bool eddsa::verify(const std::string &data, const std::string &sig) {
-	auto s = b64::decode_uri(sig.data(), sig.length());
+	probe::timer t(stats::stage::CRYPTO_VERIFY, _alg);
 
-	auto md = sp_evp_md_ctx(EVP_MD_CTX_new(), ::EVP_MD_CTX_free);
+	return basic_verifier<alg_t::EdDSA>::verify(_e, data, sig);
+}
 
-	EVP_MD_CTX_init(md.get());
+std::string eddsa::canonical_jwk() const {
+	uint8_t key[32];
+	size_t  key_len = sizeof(key);
 
-	if (EVP_DigestVerifyInit(md.get(), nullptr, nullptr, nullptr, _e.get()) != 1) {
-		throw std::runtime_error("eddsa: digest verify init");
+	if (EVP_PKEY_get_raw_public_key(_e.get(), key, &key_len) != 1) {
+		throw std::runtime_error("eddsa: couldn't extract public key");
 	}
 
-	return EVP_DigestVerify(md.get(), s.data(), s.size(), (const uint8_t *)data.data(), data.size()) == 1;
+	return jwtpp::canonical_jwk({
+		{"crv", "Ed25519"},
+		{"kty", "OKP"},
+		{"x",   b64::encode_uri(key, key_len)},
+	});
 }
 
 sp_evp_key eddsa::gen() {
@@ -107,6 +102,86 @@ sp_evp_key eddsa::get_pub(sp_evp_key priv) {
 	return sp_evp_key(EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, k.get(), key_len), ::EVP_PKEY_free);
 }
 
+namespace {
+
+sp_evp_key check_ed25519(EVP_PKEY *k) {
+	if (k == nullptr) {
+		ERR_clear_error();
+		throw std::runtime_error("eddsa: read key");
+	}
+
+	auto key = sp_evp_key(k, ::EVP_PKEY_free);
+
+	if (EVP_PKEY_id(k) != EVP_PKEY_ED25519) {
+		throw std::runtime_error("eddsa: not an ED25519 key");
+	}
+
+	return key;
+}
+
+} // namespace
+
+sp_evp_key eddsa::load_from_file(const std::string &path, password_cb on_password) {
+	openssl_init();
+
+	auto f = up_file(::std::fopen(path.c_str(), "re"), ::std::fclose);
+	if (!f) {
+		throw std::runtime_error("cannot open file " + path);
+	}
+
+	on_password_wrap wrap(on_password);
+
+	EVP_PKEY *k = PEM_read_PrivateKey(f.get(), nullptr, password_loader, &wrap);
+	if (wrap.required) {
+		throw std::runtime_error("password required");
+	}
+
+	return check_ed25519(k);
+}
+
+sp_evp_key eddsa::load_from_string(const std::string &str, password_cb on_password) {
+	openssl_init();
+
+	auto bio = std::unique_ptr<BIO, BIODeleter>{BIO_new_mem_buf(str.data(), static_cast<int>(str.size()))};
+
+	on_password_wrap wrap(on_password);
+
+	EVP_PKEY *k = PEM_read_bio_PrivateKey(bio.get(), nullptr, password_loader, &wrap);
+	if (wrap.required) {
+		throw std::runtime_error("password required");
+	}
+
+	return check_ed25519(k);
+}
+
+sp_evp_key eddsa::load_private_der(const uint8_t *der, size_t size) {
+	const uint8_t *p = der;
+
+	auto p8 = std::shared_ptr<PKCS8_PRIV_KEY_INFO>(
+		d2i_PKCS8_PRIV_KEY_INFO(nullptr, &p, static_cast<long>(size)), ::PKCS8_PRIV_KEY_INFO_free);
+
+	if (!p8) {
+		ERR_clear_error();
+		throw std::runtime_error("eddsa: read key");
+	}
+
+	return check_ed25519(EVP_PKCS82PKEY(p8.get()));
+}
+
+sp_evp_key eddsa::load_public_der(const uint8_t *der, size_t size) {
+	const uint8_t *p = der;
+
+	return check_ed25519(d2i_PUBKEY(nullptr, &p, static_cast<long>(size)));
+}
+
+sp_evp_key eddsa::load_raw_private(const uint8_t *key, size_t size) {
+	return check_ed25519(EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, key, size));
+}
+
+sp_evp_key eddsa::load_raw_public(const uint8_t *key, size_t size) {
+	return check_ed25519(EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, key, size));
+}
+
 } // namespace jwtpp
 
 #endif // defined(JWTPP_SUPPORTED_EDDSA)
@@ -0,0 +1,123 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/epoch.hh>
+
+namespace jwtpp {
+namespace epoch {
+
+namespace {
+
+// 0 is reserved to mark idle records
+std::atomic<uint64_t> global_epoch(1);
+
+struct record {
+	std::atomic<uint64_t> local;
+	std::atomic<bool>     in_use;
+	record               *next;
+	unsigned              nest;
+
+	record()
+		: local(0)
+		, in_use(true)
+		, next(nullptr)
+		, nest(0)
+	{}
+};
+
+// records are never freed, threads that exit hand them over to new threads
+std::atomic<record *> records(nullptr);
+
+record *acquire() {
+	for (auto r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+		bool expected = false;
+		if (!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true)) {
+			return r;
+		}
+	}
+
+	auto r = new record();
+	r->next = records.load(std::memory_order_relaxed);
+
+	while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {}
+
+	return r;
+}
+
+class thread_record {
+public:
+	thread_record()
+		: _r(acquire())
+	{}
+
+	~thread_record() {
+		_r->local.store(0);
+		_r->nest = 0;
+		_r->in_use.store(false, std::memory_order_release);
+	}
+
+	record *get() { return _r; }
+
+private:
+	record *_r;
+};
+
+record *self() {
+	static thread_local thread_record r;
+	return r.get();
+}
+
+} // namespace
+
+void pin() noexcept {
+	auto r = self();
+
+	if (r->nest++ == 0) {
+		r->local.store(global_epoch.load());
+	}
+}
+
+void unpin() noexcept {
+	auto r = self();
+
+	if (--r->nest == 0) {
+		r->local.store(0, std::memory_order_release);
+	}
+}
+
+uint64_t advance() noexcept {
+	return global_epoch.fetch_add(1) + 1;
+}
+
+bool safe(uint64_t retired) noexcept {
+	for (auto r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+		auto e = r->local.load();
+		if (e != 0 && e < retired) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace epoch
+} // namespace jwtpp
@@ -0,0 +1,262 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+
+#include <jwtpp/executor.hh>
+
+namespace jwtpp {
+
+namespace {
+
+struct worker_tls {
+	const void *owner;
+	unsigned    index;
+};
+
+worker_tls &tls() {
+	static thread_local worker_tls t = { nullptr, 0 };
+	return t;
+}
+
+} // namespace
+
+executor::executor(unsigned threads)
+	: _workers()
+	, _next(0)
+	, _pending(0)
+	, _sleep_lock()
+	, _wake()
+	, _stop(false)
+{
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned i = 0; i < threads; ++i) {
+		_workers.emplace_back(new worker);
+	}
+
+	for (unsigned i = 0; i < threads; ++i) {
+		_workers[i]->thread = std::thread(&executor::run, this, i);
+	}
+}
+
+executor::~executor() {
+	{
+		std::lock_guard<std::mutex> l(_sleep_lock);
+		_stop = true;
+	}
+
+	_wake.notify_all();
+
+	for (auto &w : _workers) {
+		if (w->thread.joinable()) {
+			w->thread.join();
+		}
+	}
+}
+
+void executor::post(task t) {
+	if (!t) {
+		throw std::invalid_argument("empty task");
+	}
+
+	auto &self = tls();
+
+	unsigned index;
+
+	if (self.owner == this) {
+		index = self.index;
+	} else {
+		index = _next.fetch_add(1, std::memory_order_relaxed) % size();
+	}
+
+	// counted before it becomes visible, so a worker never takes uncounted task
+	{
+		std::lock_guard<std::mutex> l(_sleep_lock);
+		_pending.fetch_add(1);
+	}
+
+	{
+		auto &w = *_workers[index];
+		std::lock_guard<std::mutex> l(w.lock);
+		w.tasks.push_back(std::move(t));
+	}
+
+	_wake.notify_one();
+}
+
+std::future<std::string> executor::sign_claims(sp_claims cl, sp_crypto c) {
+	auto p = std::make_shared<std::promise<std::string>>();
+	auto f = p->get_future();
+
+	sign_claims(std::move(cl), std::move(c), [p](std::exception_ptr e, std::string token) {
+		if (e) {
+			p->set_exception(e);
+		} else {
+			p->set_value(std::move(token));
+		}
+	});
+
+	return f;
+}
+
+void executor::sign_claims(sp_claims cl, sp_crypto c, sign_done done) {
+	if (!cl || !c) {
+		throw std::invalid_argument("claims and crypto must not be null");
+	}
+
+	if (!done) {
+		throw std::invalid_argument("empty completion");
+	}
+
+	post([cl, c, done]() {
+		std::string token;
+
+		try {
+			token = jws::sign_claims(*cl, c);
+		} catch (...) {
+			done(std::current_exception(), std::string());
+			return;
+		}
+
+		done(nullptr, std::move(token));
+	});
+}
+
+std::future<bool> executor::verify(std::string bearer, sp_crypto c, jws::verify_cb v) {
+	auto p = std::make_shared<std::promise<bool>>();
+	auto f = p->get_future();
+
+	verify(std::move(bearer), std::move(c), std::move(v), [p](std::exception_ptr e, bool ok) {
+		if (e) {
+			p->set_exception(e);
+		} else {
+			p->set_value(ok);
+		}
+	});
+
+	return f;
+}
+
+void executor::verify(std::string bearer, sp_crypto c, jws::verify_cb v, verify_done done) {
+	if (!c) {
+		throw std::invalid_argument("crypto must not be null");
+	}
+
+	if (!done) {
+		throw std::invalid_argument("empty completion");
+	}
+
+	auto b = std::make_shared<std::string>(std::move(bearer));
+
+	post([b, c, v, done]() {
+		bool ok;
+
+		try {
+			ok = do_verify(*b, c, v);
+		} catch (...) {
+			done(std::current_exception(), false);
+			return;
+		}
+
+		done(nullptr, ok);
+	});
+}
+
+executor &executor::global() {
+	static executor e;
+	return e;
+}
+
+int executor::worker_index() {
+	auto &self = tls();
+
+	return self.owner == nullptr ? -1 : static_cast<int>(self.index);
+}
+
+void executor::run(unsigned index) {
+	auto &self = tls();
+	self.owner = this;
+	self.index = index;
+
+	task t;
+
+	for (;;) {
+		if (take(index, t)) {
+			_pending.fetch_sub(1);
+
+			try {
+				t();
+			} catch (...) {
+			}
+
+			t = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> l(_sleep_lock);
+
+		_wake.wait(l, [this]() { return _pending.load() > 0 || _stop; });
+
+		if (_stop && _pending.load() == 0) {
+			break;
+		}
+	}
+
+	self.owner = nullptr;
+}
+
+bool executor::take(unsigned index, task &t) {
+	{
+		auto &w = *_workers[index];
+		std::lock_guard<std::mutex> l(w.lock);
+
+		if (!w.tasks.empty()) {
+			t = std::move(w.tasks.back());
+			w.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < _workers.size(); ++i) {
+		auto &w = *_workers[(index + i) % _workers.size()];
+		std::lock_guard<std::mutex> l(w.lock);
+
+		if (!w.tasks.empty()) {
+			t = std::move(w.tasks.front());
+			w.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool executor::do_verify(const std::string &bearer, sp_crypto c, const jws::verify_cb &v) {
+	auto j = jws::parse(bearer);
+
+	return j->verify(c, v);
+}
+
+} // namespace jwtpp
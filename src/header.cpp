@@ -31,6 +31,14 @@ hdr::hdr(alg_t a)
 	_h["alg"]  = crypto::alg2str(a);
 }
 
+hdr::hdr(alg_t a, const std::string &kid)
+	: hdr(a)
+{
+	if (!kid.empty()) {
+		_h["kid"] = kid;
+	}
+}
+
 hdr::hdr(const std::string &data)
 	: _h()
 {
@@ -20,9 +20,14 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <memory>
+
 #include <openssl/hmac.h>
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
+#include <jwtpp/basic.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -40,50 +45,80 @@ hmac::hmac(const secure_string &secret, alg_t a)
 }
 
 std::string hmac::sign(const std::string &data) {
-	if (data.empty()) {
-		throw std::invalid_argument("data is empty");
+	probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
+
+	switch (_alg) {
+	case alg_t::HS256: return basic_signer<alg_t::HS256>::sign(_secret, data);
+	case alg_t::HS384: return basic_signer<alg_t::HS384>::sign(_secret, data);
+	case alg_t::HS512: return basic_signer<alg_t::HS512>::sign(_secret, data);
+	default:
+		// Should never happen
+		throw std::runtime_error("Invalid alg");
 	}
+}
 
-	const EVP_MD *evp;
+void hmac::sign_many(const string_view *data, size_t count, std::string *sigs) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	const EVP_MD *md = nullptr;
 
 	switch (_alg) {
-	case alg_t::HS256: evp = EVP_sha256(); break;
-	case alg_t::HS384: evp = EVP_sha384(); break;
-	case alg_t::HS512: evp = EVP_sha512(); break;
+	case alg_t::HS256: md = EVP_sha256(); break;
+	case alg_t::HS384: md = EVP_sha384(); break;
+	case alg_t::HS512: md = EVP_sha512(); break;
 	default:
 		// Should never happen
 		throw std::runtime_error("Invalid alg");
 	}
 
-	HMAC_CTX *hmac;
+	std::unique_ptr<HMAC_CTX, void (*)(HMAC_CTX *)> ctx(HMAC_CTX_new(), HMAC_CTX_free);
 
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-	HMAC_CTX hmac_l;
-	HMAC_CTX_init(&hmac_l);
-	hmac = &hmac_l;
-#else
-	hmac = HMAC_CTX_new();
-#endif
+	if (!ctx || HMAC_Init_ex(ctx.get(), _secret.data(), static_cast<int>(_secret.size()), md, nullptr) != 1) {
+		throw std::runtime_error("Couldn't sign HMAC");
+	}
 
-	HMAC_Init_ex(hmac, _secret.data(), static_cast<int>(_secret.length()), evp, nullptr);
-	HMAC_Update(hmac, reinterpret_cast<const uint8_t *>(data.c_str()), data.size());
+	uint8_t      mac[EVP_MAX_MD_SIZE];
+	char         enc[b64::encoded_uri_size(EVP_MAX_MD_SIZE)];
+	unsigned int len = 0;
 
-	auto res = std::shared_ptr<uint8_t>(new uint8_t[EVP_MD_size(evp)], std::default_delete<uint8_t[]>());
-	uint32_t size;
+	for (size_t i = 0; i < count; i++) {
+		probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
 
-	HMAC_Final(hmac, res.get(), &size);
+		if (data[i].empty()) {
+			throw std::invalid_argument("data is empty");
+		}
 
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-	HMAC_CTX_cleanup(hmac);
-#else
-	HMAC_CTX_free(hmac);
-#endif
+		// NULL key and md reset context to the inner/outer pads computed above
+		if ((i != 0 && HMAC_Init_ex(ctx.get(), nullptr, 0, nullptr, nullptr) != 1) ||
+		    HMAC_Update(ctx.get(), reinterpret_cast<const uint8_t *>(data[i].data()), data[i].size()) != 1 ||
+		    HMAC_Final(ctx.get(), mac, &len) != 1) {
+			throw std::runtime_error("Couldn't sign HMAC");
+		}
 
-	return b64::encode_uri(res.get(), size);
+		sigs[i].assign(enc, b64::encode_uri(mac, len, enc));
+	}
+#else
+	crypto::sign_many(data, count, sigs);
+#endif // OPENSSL_VERSION_NUMBER >= 0x10100000L
 }
 
 bool hmac::verify(const std::string &data, const std::string &sig) {
-	return sig == sign(data);
+	probe::timer t(stats::stage::CRYPTO_VERIFY, _alg);
+
+	switch (_alg) {
+	case alg_t::HS256: return basic_verifier<alg_t::HS256>::verify(_secret, data, sig);
+	case alg_t::HS384: return basic_verifier<alg_t::HS384>::verify(_secret, data, sig);
+	case alg_t::HS512: return basic_verifier<alg_t::HS512>::verify(_secret, data, sig);
+	default:
+		// Should never happen
+		throw std::runtime_error("Invalid alg");
+	}
+}
+
+std::string hmac::canonical_jwk() const {
+	return jwtpp::canonical_jwk({
+		{"k",   b64::encode_uri(reinterpret_cast<const uint8_t *>(_secret.data()), _secret.size())},
+		{"kty", "oct"},
+	});
 }
 
 } // namespace jwtpp
@@ -0,0 +1,315 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fstream>
+#include <sstream>
+
+#include <openssl/bn.h>
+#include <openssl/err.h>
+
+#include <jwtpp/jwks.hh>
+#include <jwtpp/tools.hh>
+
+namespace jwtpp {
+
+namespace {
+
+using sp_bignum = std::shared_ptr<BIGNUM>;
+using up_bignum = std::unique_ptr<BIGNUM, void (*)(BIGNUM *)>;
+
+std::string str(const Json::Value &key, const char *name, bool required = true) {
+	if (!key.isMember(name)) {
+		if (required) {
+			throw std::runtime_error(std::string("jwk: missing \"") + name + "\"");
+		}
+
+		return std::string();
+	}
+
+	if (!key[name].isString()) {
+		throw std::runtime_error(std::string("jwk: invalid \"") + name + "\"");
+	}
+
+	return key[name].asString();
+}
+
+BIGNUM *bn(const Json::Value &key, const char *name, bool required = true) {
+	auto v = str(key, name, required);
+	if (v.empty()) {
+		if (required) {
+			throw std::runtime_error(std::string("jwk: empty \"") + name + "\"");
+		}
+
+		return nullptr;
+	}
+
+	auto raw = b64::decode_uri(v.data(), v.size());
+
+	BIGNUM *b = BN_bin2bn(raw.data(), static_cast<int>(raw.size()), nullptr);
+	OPENSSL_cleanse(raw.data(), raw.size());
+
+	if (b == nullptr) {
+		throw std::runtime_error(std::string("jwk: couldn't decode \"") + name + "\"");
+	}
+
+	return b;
+}
+
+sp_crypto load_rsa(const Json::Value &key, alg_t a) {
+	sp_rsa_key r(RSA_new(), ::RSA_free);
+
+	// owned here until RSA takes them, so a malformed later member does not leak earlier ones
+	up_bignum n(bn(key, "n"), ::BN_clear_free);
+	up_bignum e(bn(key, "e"), ::BN_clear_free);
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	r->n = n.release();
+	r->e = e.release();
+#else
+	if (RSA_set0_key(r.get(), n.get(), e.get(), nullptr) != 1) {
+		throw std::runtime_error("jwk: couldn't set RSA key");
+	}
+
+	n.release();
+	e.release();
+#endif
+
+	if (key.isMember("d")) {
+		up_bignum d(bn(key, "d"), ::BN_clear_free);
+		up_bignum p(bn(key, "p", false), ::BN_clear_free);
+		up_bignum q(bn(key, "q", false), ::BN_clear_free);
+		up_bignum dp(bn(key, "dp", false), ::BN_clear_free);
+		up_bignum dq(bn(key, "dq", false), ::BN_clear_free);
+		up_bignum qi(bn(key, "qi", false), ::BN_clear_free);
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+		r->d = d.release();
+		r->p = p.release();
+		r->q = q.release();
+		r->dmp1 = dp.release();
+		r->dmq1 = dq.release();
+		r->iqmp = qi.release();
+#else
+		if (RSA_set0_key(r.get(), nullptr, nullptr, d.get()) != 1) {
+			throw std::runtime_error("jwk: couldn't set RSA private key");
+		}
+
+		d.release();
+
+		if (p && q) {
+			if (RSA_set0_factors(r.get(), p.get(), q.get()) != 1) {
+				throw std::runtime_error("jwk: couldn't set RSA factors");
+			}
+
+			p.release();
+			q.release();
+		}
+
+		if (dp && dq && qi) {
+			if (RSA_set0_crt_params(r.get(), dp.get(), dq.get(), qi.get()) != 1) {
+				throw std::runtime_error("jwk: couldn't set RSA CRT parameters");
+			}
+
+			dp.release();
+			dq.release();
+			qi.release();
+		}
+#endif
+	}
+
+	return make_rsa_crypto(r, a);
+}
+
+sp_crypto load_ec(const Json::Value &key, alg_t a) {
+	auto crv = str(key, "crv");
+
+	int   nid;
+	alg_t expected;
+
+	if (crv == "P-256") {
+		nid      = NID_X9_62_prime256v1;
+		expected = alg_t::ES256;
+	} else if (crv == "P-384") {
+		nid      = NID_secp384r1;
+		expected = alg_t::ES384;
+	} else if (crv == "P-521") {
+		nid      = NID_secp521r1;
+		expected = alg_t::ES512;
+	} else {
+		throw std::runtime_error("jwk: unsupported curve " + crv);
+	}
+
+	if (a == alg_t::UNKNOWN) {
+		a = expected;
+	} else if (a != expected) {
+		throw std::runtime_error("jwk: alg does not match curve");
+	}
+
+	sp_ecdsa_key e(EC_KEY_new_by_curve_name(nid), ::EC_KEY_free);
+	if (!e) {
+		throw std::runtime_error("jwk: couldn't create EC key");
+	}
+
+	sp_bignum x(bn(key, "x"), ::BN_free);
+	sp_bignum y(bn(key, "y"), ::BN_free);
+
+	if (EC_KEY_set_public_key_affine_coordinates(e.get(), x.get(), y.get()) != 1) {
+		ERR_clear_error();
+		throw std::runtime_error("jwk: invalid EC point");
+	}
+
+	if (key.isMember("d")) {
+		sp_bignum d(bn(key, "d"), ::BN_clear_free);
+
+		if (EC_KEY_set_private_key(e.get(), d.get()) != 1) {
+			throw std::runtime_error("jwk: invalid EC private key");
+		}
+	}
+
+	return std::make_shared<class ecdsa>(e, a);
+}
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+sp_crypto load_okp(const Json::Value &key) {
+	auto crv = str(key, "crv");
+	if (crv != "Ed25519") {
+		throw std::runtime_error("jwk: unsupported curve " + crv);
+	}
+
+	sp_evp_key k;
+
+	if (key.isMember("d")) {
+		auto d = str(key, "d");
+		auto raw = b64::decode_uri(d.data(), d.size());
+
+		try {
+			k = eddsa::load_raw_private(raw.data(), raw.size());
+		} catch (...) {
+			OPENSSL_cleanse(raw.data(), raw.size());
+			throw;
+		}
+
+		OPENSSL_cleanse(raw.data(), raw.size());
+	} else {
+		auto x = str(key, "x");
+		auto raw = b64::decode_uri(x.data(), x.size());
+		k = eddsa::load_raw_public(raw.data(), raw.size());
+	}
+
+	return std::make_shared<class eddsa>(k);
+}
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+
+sp_crypto load_oct(const Json::Value &key, alg_t a) {
+	auto k = str(key, "k");
+	auto raw = b64::decode_uri(k.data(), k.size());
+
+	secure_string secret(raw.begin(), raw.end());
+	OPENSSL_cleanse(raw.data(), raw.size());
+
+	return std::make_shared<class hmac>(secret, a == alg_t::UNKNOWN ? alg_t::HS256 : a);
+}
+
+} // namespace
+
+sp_crypto jwk::load(const Json::Value &key) {
+	if (!key.isObject()) {
+		throw std::runtime_error("jwk: not an object");
+	}
+
+	auto kty = str(key, "kty");
+	auto alg = str(key, "alg", false);
+
+	alg_t a = alg.empty() ? alg_t::UNKNOWN : crypto::str2alg(alg);
+
+	if (!alg.empty() && (a == alg_t::UNKNOWN || a == alg_t::NONE)) {
+		throw std::runtime_error("jwk: invalid alg " + alg);
+	}
+
+	sp_crypto c;
+
+	if (kty == "RSA") {
+		c = load_rsa(key, a == alg_t::UNKNOWN ? alg_t::RS256 : a);
+	} else if (kty == "EC") {
+		c = load_ec(key, a);
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	} else if (kty == "OKP") {
+		c = load_okp(key);
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	} else if (kty == "oct") {
+		c = load_oct(key, a);
+	} else {
+		throw std::runtime_error("jwk: unsupported kty " + kty);
+	}
+
+	auto kid = str(key, "kid", false);
+
+	// RFC 7638 section 1: thumbprint is suitable as kid for keys that have none.
+	// Not for oct keys: their thumbprint is an unsalted hash of the secret
+	if (kid.empty() && kty != "oct") {
+		kid = c->thumbprint();
+	}
+
+	c->kid(kid);
+
+	return c;
+}
+
+sp_crypto jwk::load_from_string(const std::string &str) {
+	return load(unmarshal(str));
+}
+
+keyset jwks::load(const Json::Value &set) {
+	if (!set.isObject() || !set.isMember("keys") || !set["keys"].isArray()) {
+		throw std::runtime_error("jwks: missing \"keys\"");
+	}
+
+	keyset ks;
+
+	for (const auto &key : set["keys"]) {
+		if (key.isMember("use") && key["use"].asString() == "enc") {
+			continue;
+		}
+
+		ks.add(jwk::load(key));
+	}
+
+	return ks;
+}
+
+keyset jwks::load_from_string(const std::string &str) {
+	return load(unmarshal(str));
+}
+
+keyset jwks::load_from_file(const std::string &path) {
+	std::ifstream f(path);
+	if (!f) {
+		throw std::runtime_error("cannot open file " + path);
+	}
+
+	std::stringstream s;
+	s << f.rdbuf();
+
+	return load_from_string(s.str());
+}
+
+} // namespace jwtpp
@@ -0,0 +1,276 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fstream>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif // defined(__linux__)
+
+#include <jwtpp/jwks.hh>
+
+namespace jwtpp {
+
+jwks_watcher::jwks_watcher(const std::string &path, sp_keyset_holder holder, error_cb on_error, std::chrono::milliseconds interval)
+	: _path(path)
+	, _holder(holder)
+	, _on_error(on_error)
+	, _interval(interval)
+	, _reload_lock()
+	, _loaded()
+	, _signature()
+	, _generation(0)
+	, _stop(true)
+	, _lock()
+	, _cv()
+	, _thread()
+	, _wake{-1, -1}
+{
+	if (!_holder) {
+		throw std::invalid_argument("uninitialized keyset holder");
+	}
+}
+
+jwks_watcher::~jwks_watcher() {
+	stop();
+}
+
+void jwks_watcher::start() {
+	if (_thread.joinable()) {
+		return;
+	}
+
+	reload();
+
+	_stop = false;
+
+#if defined(__linux__)
+	if (::pipe2(_wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+		_wake[0] = _wake[1] = -1;
+	}
+#endif // defined(__linux__)
+
+	_thread = std::thread(&jwks_watcher::run, this);
+}
+
+void jwks_watcher::stop() {
+	if (!_thread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop = true;
+	}
+
+	_cv.notify_all();
+
+#if defined(__linux__)
+	if (_wake[1] >= 0) {
+		char c = 0;
+		(void)::write(_wake[1], &c, 1);
+	}
+#endif // defined(__linux__)
+
+	_thread.join();
+
+#if defined(__linux__)
+	if (_wake[0] >= 0) {
+		::close(_wake[0]);
+		::close(_wake[1]);
+		_wake[0] = _wake[1] = -1;
+	}
+#endif // defined(__linux__)
+}
+
+std::string jwks_watcher::signature() const {
+	struct stat st;
+
+	if (::stat(_path.c_str(), &st) != 0) {
+		return std::string();
+	}
+
+	std::stringstream s;
+	s << st.st_ino << ":" << st.st_size << ":" << st.st_mtime;
+#if defined(__linux__)
+	s << "." << st.st_mtim.tv_nsec;
+#endif // defined(__linux__)
+
+	return s.str();
+}
+
+bool jwks_watcher::reload() {
+	std::lock_guard<std::mutex> lock(_reload_lock);
+
+	auto sig = signature();
+
+	std::ifstream f(_path);
+	if (!f) {
+		throw std::runtime_error("cannot open file " + _path);
+	}
+
+	std::stringstream s;
+	s << f.rdbuf();
+
+	auto set = unmarshal(s.str());
+
+	if (!set.isObject() || !set.isMember("keys") || !set["keys"].isArray()) {
+		throw std::runtime_error("jwks: missing \"keys\"");
+	}
+
+	std::unordered_map<std::string, loaded_key> loaded;
+	keyset ks;
+	bool changed = false;
+
+	for (const auto &key : set["keys"]) {
+		if (key.isMember("use") && key["use"].asString() == "enc") {
+			continue;
+		}
+
+		if (!key.isMember("kid") || !key["kid"].isString()) {
+			throw std::runtime_error("jwks: key without \"kid\"");
+		}
+
+		auto kid = key["kid"].asString();
+		auto jwk_str = marshal(key);
+
+		auto prev = _loaded.find(kid);
+
+		loaded_key k;
+		k.jwk = jwk_str;
+
+		if (prev != _loaded.end() && prev->second.jwk == jwk_str) {
+			k.c = prev->second.c;
+		} else {
+			k.c = jwk::load(key);
+			k.c->warm();
+			changed = true;
+		}
+
+		ks.add(kid, k.c);
+		loaded[kid] = k;
+	}
+
+	_signature = sig;
+
+	if (!changed && loaded.size() == _loaded.size() && _generation.load() != 0) {
+		return false;
+	}
+
+	_holder->publish(std::move(ks));
+	_loaded.swap(loaded);
+	_generation++;
+
+	return true;
+}
+
+void jwks_watcher::run() {
+	int fd = -1;
+
+#if defined(__linux__)
+	std::string dir(".");
+	std::string name(_path);
+
+	auto pos = _path.rfind('/');
+	if (pos != std::string::npos) {
+		dir  = pos == 0 ? std::string("/") : _path.substr(0, pos);
+		name = _path.substr(pos + 1);
+	}
+
+	fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	// watch directory rather than file so atomic replace via rename is noticed
+	if (fd >= 0 && ::inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ATTRIB) < 0) {
+		::close(fd);
+		fd = -1;
+	}
+#endif // defined(__linux__)
+
+	while (!_stop) {
+		bool notified = false;
+
+#if defined(__linux__)
+		if (fd >= 0 && _wake[0] >= 0) {
+			struct pollfd fds[2] = {
+				{fd, POLLIN, 0},
+				{_wake[0], POLLIN, 0},
+			};
+
+			if (::poll(fds, 2, static_cast<int>(_interval.count())) > 0 && (fds[0].revents & POLLIN)) {
+				alignas(struct inotify_event) char buf[4096];
+				ssize_t len;
+
+				while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+					for (char *p = buf; p < buf + len;) {
+						auto ev = reinterpret_cast<struct inotify_event *>(p);
+
+						if (ev->len > 0 && name == ev->name) {
+							notified = true;
+						}
+
+						p += sizeof(struct inotify_event) + ev->len;
+					}
+				}
+			}
+		} else
+#endif // defined(__linux__)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_cv.wait_for(lock, _interval, [this]() { return _stop.load(); });
+		}
+
+		if (_stop) {
+			break;
+		}
+
+		if (!notified) {
+			std::lock_guard<std::mutex> lock(_reload_lock);
+
+			if (signature() == _signature) {
+				continue;
+			}
+		}
+
+		try {
+			reload();
+		} catch (const std::exception &e) {
+			if (_on_error) {
+				_on_error(e);
+			}
+		}
+	}
+
+#if defined(__linux__)
+	if (fd >= 0) {
+		::close(fd);
+	}
+#endif // defined(__linux__)
+}
+
+} // namespace jwtpp
@@ -20,41 +20,66 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
 
 namespace jwtpp {
 
 static const std::string bearer_hdr("bearer ");
 
-jws::jws(alg_t a, const std::string &data, sp_claims cl, const std::string &sig)
+jws::jws(alg_t a, const std::string &data, sp_claims cl, const std::string &sig, const std::string &kid)
 	: _alg(a)
 	, _data(data)
 	, _claims(cl)
-	, _sig(sig) {
+	, _sig(sig)
+	, _kid(kid) {
 
 }
 
 bool jws::verify(sp_crypto c, verify_cb v) {
+	probe::op o(stats::stage::VERIFY, _alg);
+
 	if (!c) {
 		throw std::runtime_error("uninitialized crypto");
 	}
 
 	if (c->alg() != _alg) {
+		o.result(stats::result::ALG_MISMATCH);
 		throw std::runtime_error("invalid crypto alg");
 	}
 
 	if (!c->verify(_data, _sig)) {
+		o.result(stats::result::BAD_SIGNATURE);
 		return false;
 	}
 
 	if (v) {
-		return v(_claims);
+		probe::timer t(stats::stage::POLICY, _alg);
+
+		if (!v(_claims)) {
+			o.result(stats::result::REJECTED);
+			return false;
+		}
 	}
 
+	o.result(stats::result::OK);
+
 	return true;
 }
 
 sp_jws jws::parse(const std::string &full_bearer) {
+	probe::op    o(stats::stage::PARSE);
+	probe::timer dec(stats::stage::DECODE, alg_t::UNKNOWN, false);
+	probe::timer json(stats::stage::JSON, alg_t::UNKNOWN, false);
+
+	o.result(stats::result::MALFORMED);
+
 	if (full_bearer.empty() || full_bearer.length() < bearer_hdr.length()) {
 		throw std::invalid_argument("Bearer is invalid or empty");
 	}
@@ -77,11 +102,15 @@ sp_jws jws::parse(const std::string &full_bearer) {
 
 	Json::Value hdr;
 
-	try {
-		hdr = unmarshal_b64(tokens[0]);
-	} catch (...) {
-		throw;
-	}
+	dec.start();
+	std::string decoded = b64::decode(tokens[0]);
+	dec.stop();
+
+	json.start();
+	hdr = unmarshal(decoded);
+	json.stop();
+
+	o.result(stats::result::BAD_HEADER);
 
 	if (!hdr.isMember("typ") || !hdr.isMember("alg")) {
 		throw std::runtime_error("Invalid JWT header");
@@ -96,14 +125,32 @@ sp_jws jws::parse(const std::string &full_bearer) {
 		throw std::runtime_error("Invalid alg");
 	}
 
-	sp_claims cl;
+	o.alg(a);
+	dec.alg(a);
+	json.alg(a);
 
-	try {
-		cl = std::make_shared<class claims>(tokens[1], true);
-	} catch (...) {
-		throw;
+	std::string kid;
+
+	if (hdr.isMember("kid")) {
+		if (!hdr["kid"].isString()) {
+			throw std::runtime_error("Invalid kid");
+		}
+
+		kid = hdr["kid"].asString();
 	}
 
+	o.result(stats::result::BAD_CLAIMS);
+
+	dec.start();
+	decoded = b64::decode_uri(tokens[1]);
+	dec.stop();
+
+	sp_claims cl;
+
+	json.start();
+	cl = std::make_shared<class claims>(decoded);
+	json.stop();
+
 	std::string d = tokens[0];
 	d += ".";
 	d += tokens[1];
@@ -111,11 +158,13 @@ sp_jws jws::parse(const std::string &full_bearer) {
 	jws *j;
 
 	try {
-		j = new jws(a, d, cl, tokens[2]);
+		j = new jws(a, d, cl, tokens[2], kid);
 	} catch (...) {
 		throw;
 	}
 
+	o.result(stats::result::OK);
+
 	return sp_jws(j);
 }
 
@@ -124,18 +173,26 @@ std::string jws::sign(const std::string &data, sp_crypto c) {
 }
 
 std::string jws::sign_claims(class claims &cl, sp_crypto c) {
+	probe::op o(stats::stage::SIGN, c->alg());
+
 	std::string out;
 
-	hdr h(c->alg());
-	out = h.b64();
-	out += ".";
-	out += cl.b64();
+	{
+		probe::timer t(stats::stage::JSON, c->alg());
+
+		hdr h(c->alg(), c->kid());
+		out = h.b64();
+		out += ".";
+		out += cl.b64();
+	}
 
 	std::string sig;
 	sig = jws::sign(out, c);
 	out += ".";
 	out += sig;
 
+	o.result(stats::result::OK);
+
 	return out;
 }
 
@@ -145,6 +202,130 @@ std::string jws::sign_bearer(class claims &cl, sp_crypto c) {
 	return bearer;
 }
 
+token_batch jws::sign_batch(span<class claims> cl, sp_crypto c, unsigned threads) {
+	if (!c) {
+		throw std::invalid_argument("uninitialized crypto");
+	}
+
+	token_batch out;
+
+	if (cl.empty()) {
+		return out;
+	}
+
+	probe::op o(stats::stage::SIGN, c->alg());
+
+	const size_t count = cl.size();
+
+	// signing inputs back to back, header is serialized once
+	std::string         input;
+	std::vector<size_t> input_ends(count);
+
+	{
+		probe::timer t(stats::stage::JSON, c->alg());
+
+		hdr h(c->alg(), c->kid());
+
+		std::string prefix = h.b64();
+		prefix += ".";
+
+		input.reserve(count * (prefix.size() + 256));
+
+		for (size_t i = 0; i < count; ++i) {
+			input += prefix;
+			input += cl[i].b64();
+			input_ends[i] = input.size();
+		}
+	}
+
+	std::vector<string_view> data(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		size_t begin = i == 0 ? 0 : input_ends[i - 1];
+		data[i] = string_view(input.data() + begin, input_ends[i] - begin);
+	}
+
+	std::vector<std::string> sigs(count);
+
+	auto alg = c->alg();
+	bool symmetric = alg == alg_t::HS256 || alg == alg_t::HS384 || alg == alg_t::HS512;
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// private key operations dominate, small chunks keep threads evenly loaded
+	const size_t batch = 4;
+
+	threads = symmetric ? 1 : static_cast<unsigned>(std::min<size_t>(threads, (count + batch - 1) / batch));
+
+	if (threads <= 1) {
+		c->sign_many(data.data(), count, sigs.data());
+	} else {
+		std::atomic<size_t> next(0);
+		std::exception_ptr  error;
+		std::once_flag      error_once;
+
+		auto worker = [&]() {
+			for (;;) {
+				size_t from = next.fetch_add(batch, std::memory_order_relaxed);
+				if (from >= count) {
+					break;
+				}
+
+				size_t to = std::min(from + batch, count);
+
+				try {
+					c->sign_many(&data[from], to - from, &sigs[from]);
+				} catch (...) {
+					std::call_once(error_once, [&error]() { error = std::current_exception(); });
+					next.store(count, std::memory_order_relaxed);
+				}
+			}
+		};
+
+		std::vector<std::thread> pool;
+
+		for (unsigned i = 1; i < threads; ++i) {
+			try {
+				pool.emplace_back(worker);
+			} catch (const std::system_error &) {
+				// run with what has been started, calling thread takes part anyway
+				break;
+			}
+		}
+
+		worker();
+
+		for (auto &t : pool) {
+			t.join();
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	size_t total = input.size() + count;
+	for (auto &s : sigs) {
+		total += s.size();
+	}
+
+	out._buf.reserve(total);
+	out._ends.reserve(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		out._buf.append(data[i].data(), data[i].size());
+		out._buf += ".";
+		out._buf += sigs[i];
+		out._ends.push_back(out._buf.size());
+	}
+
+	o.result(stats::result::OK);
+
+	return out;
+}
+
 std::vector<std::string> jws::tokenize(const std::string &text, char sep) {
 	std::vector<std::string> tokens;
 	std::size_t start = 0;
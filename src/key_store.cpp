@@ -0,0 +1,166 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <functional>
+
+#include <jwtpp/key_store.hh>
+
+namespace jwtpp {
+
+key_store::key_store(size_t capacity, size_t shards)
+	: _capacity(capacity)
+	, _shard_capacity(0)
+	, _shards()
+	, _hits(0)
+	, _misses(0)
+	, _evictions(0)
+{
+	if (capacity == 0) {
+		throw std::invalid_argument("capacity must not be 0");
+	}
+
+	if (shards == 0) {
+		shards = capacity < 16 ? 1 : 16;
+	}
+
+	_shard_capacity = (capacity + shards - 1) / shards;
+
+	for (size_t i = 0; i < shards; ++i) {
+		_shards.emplace_back(new shard());
+	}
+}
+
+key_store::shard &key_store::select(const std::string &kid) {
+	return *_shards[std::hash<std::string>()(kid) % _shards.size()];
+}
+
+void key_store::add(key_blob blob) {
+	if (blob.kid.empty()) {
+		throw std::invalid_argument("kid is empty");
+	}
+
+	auto b = std::make_shared<const key_blob>(std::move(blob));
+
+	auto &s = select(b->kid);
+
+	std::lock_guard<std::mutex> lock(s.lock);
+
+	s.blobs[b->kid] = b;
+
+	auto it = s.cache.find(b->kid);
+	if (it != s.cache.end()) {
+		s.lru.erase(it->second.pos);
+		s.cache.erase(it);
+	}
+}
+
+bool key_store::remove(const std::string &kid) {
+	auto &s = select(kid);
+
+	std::lock_guard<std::mutex> lock(s.lock);
+
+	auto it = s.cache.find(kid);
+	if (it != s.cache.end()) {
+		s.lru.erase(it->second.pos);
+		s.cache.erase(it);
+	}
+
+	return s.blobs.erase(kid) != 0;
+}
+
+sp_crypto key_store::get(const std::string &kid) {
+	auto &s = select(kid);
+
+	sp_blob blob;
+
+	{
+		std::lock_guard<std::mutex> lock(s.lock);
+
+		auto it = s.cache.find(kid);
+		if (it != s.cache.end()) {
+			s.lru.splice(s.lru.begin(), s.lru, it->second.pos);
+			_hits.fetch_add(1, std::memory_order_relaxed);
+			return it->second.c;
+		}
+
+		auto b = s.blobs.find(kid);
+		if (b == s.blobs.end()) {
+			return nullptr;
+		}
+
+		blob = b->second;
+	}
+
+	_misses.fetch_add(1, std::memory_order_relaxed);
+
+	auto c = blob->load();
+
+	std::lock_guard<std::mutex> lock(s.lock);
+
+	// key has been replaced or removed while loading, do not cache stale crypto
+	auto b = s.blobs.find(kid);
+	if (b == s.blobs.end() || b->second != blob) {
+		return c;
+	}
+
+	// concurrent miss has already materialized it
+	auto it = s.cache.find(kid);
+	if (it != s.cache.end()) {
+		return it->second.c;
+	}
+
+	s.lru.push_front(kid);
+
+	cached entry;
+	entry.c   = c;
+	entry.pos = s.lru.begin();
+
+	s.cache.emplace(kid, entry);
+
+	while (s.cache.size() > _shard_capacity) {
+		s.cache.erase(s.lru.back());
+		s.lru.pop_back();
+		_evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return c;
+}
+
+struct key_store::stats key_store::stats() const {
+	struct stats st;
+
+	st.hits         = _hits.load(std::memory_order_relaxed);
+	st.misses       = _misses.load(std::memory_order_relaxed);
+	st.evictions    = _evictions.load(std::memory_order_relaxed);
+	st.keys         = 0;
+	st.materialized = 0;
+
+	for (const auto &s : _shards) {
+		std::lock_guard<std::mutex> lock(s->lock);
+		st.keys         += s->blobs.size();
+		st.materialized += s->cache.size();
+	}
+
+	return st;
+}
+
+} // namespace jwtpp
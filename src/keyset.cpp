@@ -0,0 +1,357 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+#include <jwtpp/keyset.hh>
+#include <jwtpp/jwks.hh>
+#include <jwtpp/epoch.hh>
+#include <jwtpp/tools.hh>
+
+namespace jwtpp {
+
+namespace {
+
+enum class key_kind {
+	RSA,
+	EC,
+	ED,
+};
+
+bool symmetric(alg_t a) {
+	return a == alg_t::HS256 || a == alg_t::HS384 || a == alg_t::HS512;
+}
+
+key_kind kind(alg_t a) {
+	switch (a) {
+	case alg_t::RS256:
+	case alg_t::RS384:
+	case alg_t::RS512:
+	case alg_t::PS256:
+	case alg_t::PS384:
+	case alg_t::PS512:
+		return key_kind::RSA;
+	case alg_t::ES256:
+	case alg_t::ES384:
+	case alg_t::ES512:
+		return key_kind::EC;
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	case alg_t::EdDSA:
+		return key_kind::ED;
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	default:
+		throw std::invalid_argument("invalid alg for key blob");
+	}
+}
+
+} // namespace
+
+sp_crypto key_blob::load() const {
+	sp_crypto c;
+
+	if (fmt == format::JWK) {
+		auto j = unmarshal(data);
+		if (!j.isObject()) {
+			throw std::runtime_error("jwk: not an object");
+		}
+
+		if (!j.isMember("alg") && alg != alg_t::UNKNOWN) {
+			j["alg"] = crypto::alg2str(alg);
+		}
+
+		c = jwk::load(j);
+	} else {
+		auto der = reinterpret_cast<const uint8_t *>(data.data());
+
+		switch (kind(alg)) {
+		case key_kind::RSA: {
+			sp_rsa_key r;
+
+			if (fmt == format::PEM) {
+				r = rsa::load_from_string(data);
+			} else if (fmt == format::DER_PRIVATE) {
+				r = rsa::load_private_der(der, data.size());
+			} else {
+				r = rsa::load_public_der(der, data.size());
+			}
+
+			c = make_rsa_crypto(r, alg);
+			break;
+		}
+		case key_kind::EC: {
+			sp_ecdsa_key e;
+
+			if (fmt == format::PEM) {
+				e = ecdsa::load_from_string(data);
+			} else if (fmt == format::DER_PRIVATE) {
+				e = ecdsa::load_private_der(der, data.size());
+			} else {
+				e = ecdsa::load_public_der(der, data.size());
+			}
+
+			c = std::make_shared<class ecdsa>(e, alg);
+			break;
+		}
+#if defined(JWTPP_SUPPORTED_EDDSA)
+		case key_kind::ED: {
+			sp_evp_key e;
+
+			if (fmt == format::PEM) {
+				e = eddsa::load_from_string(data);
+			} else if (fmt == format::DER_PRIVATE) {
+				e = eddsa::load_private_der(der, data.size());
+			} else {
+				e = eddsa::load_public_der(der, data.size());
+			}
+
+			c = std::make_shared<class eddsa>(e, alg);
+			break;
+		}
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+		default:
+			throw std::invalid_argument("invalid alg for key blob");
+		}
+	}
+
+	if (!kid.empty()) {
+		c->kid(kid);
+	}
+
+	return c;
+}
+
+void keyset::add(sp_crypto c) {
+	if (!c) {
+		throw std::invalid_argument("uninitialized crypto");
+	}
+
+	add(c->kid(), c);
+}
+
+void keyset::add(const std::string &kid, sp_crypto c) {
+	if (!c) {
+		throw std::invalid_argument("uninitialized crypto");
+	}
+
+	if (kid.empty()) {
+		throw std::invalid_argument("kid is empty");
+	}
+
+	auto prev = _keys.find(kid);
+	if (prev != _keys.end()) {
+		try {
+			auto it = _thumbprints.find(prev->second->thumbprint());
+			if (it != _thumbprints.end() && it->second == prev->second) {
+				_thumbprints.erase(it);
+			}
+		} catch (const std::runtime_error &) {
+		}
+	}
+
+	_keys[kid] = c;
+
+	// "jkt" binds public keys, HMAC secret has no business being looked up by its hash
+	if (symmetric(c->alg())) {
+		return;
+	}
+
+	try {
+		_thumbprints[c->thumbprint()] = c;
+	} catch (const std::runtime_error &) {
+		// key type without thumbprint support is reachable by kid only
+	}
+}
+
+sp_crypto keyset::find(const std::string &kid) const {
+	auto it = _keys.find(kid);
+	if (it == _keys.end()) {
+		return nullptr;
+	}
+
+	return it->second;
+}
+
+sp_crypto keyset::find_by_thumbprint(const std::string &jkt) const {
+	auto it = _thumbprints.find(jkt);
+	if (it == _thumbprints.end()) {
+		return nullptr;
+	}
+
+	return it->second;
+}
+
+keyset keyset::load(const std::vector<key_blob> &blobs, std::vector<key_error> &errors, unsigned threads) {
+	errors.clear();
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// keys are small units of work, hand them out in batches to keep the counter cold
+	const size_t batch = 8;
+
+	threads = static_cast<unsigned>(std::min<size_t>(threads, (blobs.size() + batch - 1) / batch));
+
+	std::vector<sp_crypto>   loaded(blobs.size());
+	std::vector<std::string> failed(blobs.size());
+	std::atomic<size_t>      next(0);
+
+	auto worker = [&]() {
+		for (;;) {
+			size_t from = next.fetch_add(batch, std::memory_order_relaxed);
+			if (from >= blobs.size()) {
+				break;
+			}
+
+			size_t to = std::min(from + batch, blobs.size());
+
+			for (size_t i = from; i < to; ++i) {
+				try {
+					auto c = blobs[i].load();
+					c->warm();
+					loaded[i] = c;
+				} catch (const std::exception &e) {
+					failed[i] = e.what();
+				} catch (...) {
+					// anything escaping a worker thread would terminate the process
+					failed[i] = "unknown error";
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for (unsigned i = 1; i < threads; ++i) {
+		try {
+			pool.emplace_back(worker);
+		} catch (const std::system_error &) {
+			// run with what has been started, calling thread takes part anyway
+			break;
+		}
+	}
+
+	worker();
+
+	for (auto &t : pool) {
+		t.join();
+	}
+
+	keyset ks;
+
+	for (size_t i = 0; i < blobs.size(); ++i) {
+		if (loaded[i] && loaded[i]->kid().empty()) {
+			failed[i] = "kid is empty";
+			loaded[i].reset();
+		}
+
+		if (loaded[i]) {
+			ks.add(loaded[i]);
+		} else {
+			key_error e;
+			e.index = i;
+			e.kid   = blobs[i].kid;
+			e.what  = failed[i];
+
+			errors.push_back(e);
+		}
+	}
+
+	return ks;
+}
+
+keyset_holder::snapshot::snapshot(const std::atomic<keyset *> &ks) noexcept
+	: _ks(nullptr)
+{
+	epoch::pin();
+	_ks = ks.load();
+}
+
+keyset_holder::snapshot::snapshot(snapshot &&other) noexcept
+	: _ks(other._ks)
+{
+	other._ks = nullptr;
+}
+
+keyset_holder::snapshot::~snapshot() {
+	if (_ks != nullptr) {
+		epoch::unpin();
+	}
+}
+
+keyset_holder::keyset_holder()
+	: _current(new keyset())
+	, _lock()
+	, _retired()
+{}
+
+keyset_holder::keyset_holder(keyset ks)
+	: _current(new keyset(std::move(ks)))
+	, _lock()
+	, _retired()
+{}
+
+keyset_holder::~keyset_holder() {
+	delete _current.load();
+
+	for (auto &r : _retired) {
+		delete r.first;
+	}
+}
+
+keyset_holder::snapshot keyset_holder::read() const noexcept {
+	return snapshot(_current);
+}
+
+sp_crypto keyset_holder::find(const std::string &kid) const {
+	auto s = read();
+	return s->find(kid);
+}
+
+void keyset_holder::publish(keyset ks) {
+	auto next = new keyset(std::move(ks));
+
+	std::lock_guard<std::mutex> lock(_lock);
+
+	auto prev = _current.exchange(next);
+
+	_retired.emplace_back(prev, epoch::advance());
+
+	reclaim();
+}
+
+void keyset_holder::reclaim() {
+	auto it = _retired.begin();
+
+	while (it != _retired.end()) {
+		if (epoch::safe(it->second)) {
+			delete it->first;
+			it = _retired.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+} // namespace jwtpp
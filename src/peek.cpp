@@ -0,0 +1,361 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/jwtpp.hh>
+
+namespace jwtpp {
+
+namespace {
+
+const char bearer_prefix[] = "bearer ";
+
+char *skip_ws(char *p, char *end) noexcept {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+		++p;
+	}
+
+	return p;
+}
+
+int hex(char c) noexcept {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+bool hex4(const char *p, const char *end, uint32_t &cp) noexcept {
+	if (end - p < 4) {
+		return false;
+	}
+
+	cp = 0;
+
+	for (int i = 0; i < 4; ++i) {
+		int v = hex(p[i]);
+		if (v < 0) {
+			return false;
+		}
+
+		cp = (cp << 4) | static_cast<uint32_t>(v);
+	}
+
+	return true;
+}
+
+char *put_utf8(char *w, uint32_t cp) noexcept {
+	if (cp < 0x80) {
+		*w++ = static_cast<char>(cp);
+	} else if (cp < 0x800) {
+		*w++ = static_cast<char>(0xc0 | (cp >> 6));
+		*w++ = static_cast<char>(0x80 | (cp & 0x3f));
+	} else if (cp < 0x10000) {
+		*w++ = static_cast<char>(0xe0 | (cp >> 12));
+		*w++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+		*w++ = static_cast<char>(0x80 | (cp & 0x3f));
+	} else {
+		*w++ = static_cast<char>(0xf0 | (cp >> 18));
+		*w++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+		*w++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+		*w++ = static_cast<char>(0x80 | (cp & 0x3f));
+	}
+
+	return w;
+}
+
+// p points to opening quote. String is unescaped in place, any escape sequence
+// is at least as long as its expansion. Returns position past closing quote
+char *scan_string(char *p, char *end, string_view &out) noexcept {
+	char *r = ++p;
+	char *w = p;
+
+	while (r < end) {
+		char c = *r++;
+
+		if (c == '"') {
+			out = string_view(p, static_cast<size_t>(w - p));
+			return r;
+		}
+
+		if (static_cast<unsigned char>(c) < 0x20) {
+			return nullptr;
+		}
+
+		if (c != '\\') {
+			*w++ = c;
+			continue;
+		}
+
+		if (r >= end) {
+			return nullptr;
+		}
+
+		switch (*r++) {
+		case '"':  *w++ = '"';  break;
+		case '\\': *w++ = '\\'; break;
+		case '/':  *w++ = '/';  break;
+		case 'b':  *w++ = '\b'; break;
+		case 'f':  *w++ = '\f'; break;
+		case 'n':  *w++ = '\n'; break;
+		case 'r':  *w++ = '\r'; break;
+		case 't':  *w++ = '\t'; break;
+		case 'u': {
+			uint32_t cp;
+
+			if (!hex4(r, end, cp)) {
+				return nullptr;
+			}
+
+			r += 4;
+
+			if (cp >= 0xd800 && cp <= 0xdbff) {
+				uint32_t lo;
+
+				if (end - r < 6 || r[0] != '\\' || r[1] != 'u' || !hex4(r + 2, end, lo) || lo < 0xdc00 || lo > 0xdfff) {
+					return nullptr;
+				}
+
+				r += 6;
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+			} else if (cp >= 0xdc00 && cp <= 0xdfff) {
+				return nullptr;
+			}
+
+			w = put_utf8(w, cp);
+			break;
+		}
+		default:
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+// skips number, literal, object or array. Nested strings are not unescaped
+char *skip_value(char *p, char *end) noexcept {
+	if (p >= end) {
+		return nullptr;
+	}
+
+	if (*p != '{' && *p != '[') {
+		while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+			if (*p == '"' || *p == '{' || *p == '[' || *p == ':') {
+				return nullptr;
+			}
+
+			++p;
+		}
+
+		return p;
+	}
+
+	size_t depth = 0;
+	bool   in_str = false;
+
+	for (; p < end; ++p) {
+		char c = *p;
+
+		if (in_str) {
+			if (c == '\\') {
+				++p;
+			} else if (c == '"') {
+				in_str = false;
+			}
+		} else if (c == '"') {
+			in_str = true;
+		} else if (c == '{' || c == '[') {
+			++depth;
+		} else if (c == '}' || c == ']') {
+			if (--depth == 0) {
+				return p + 1;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+} // namespace
+
+unverified_peek::unverified_peek() noexcept
+	: _header_count(0)
+	, _claims_count(0)
+	, _token()
+{}
+
+bool unverified_peek::index(char *p, char *end, member *members, size_t &count) noexcept {
+	count = 0;
+
+	p = skip_ws(p, end);
+
+	if (p >= end || *p++ != '{') {
+		return false;
+	}
+
+	p = skip_ws(p, end);
+
+	if (p < end && *p == '}') {
+		return skip_ws(p + 1, end) == end;
+	}
+
+	for (;;) {
+		if (p >= end || *p != '"' || count == max_members) {
+			return false;
+		}
+
+		member &m = members[count++];
+
+		if ((p = scan_string(p, end, m.key)) == nullptr) {
+			return false;
+		}
+
+		p = skip_ws(p, end);
+
+		if (p >= end || *p++ != ':') {
+			return false;
+		}
+
+		p = skip_ws(p, end);
+
+		if (p < end && *p == '"') {
+			p = scan_string(p, end, m.value);
+		} else {
+			char *v = p;
+			p = skip_value(p, end);
+			if (p != nullptr) {
+				m.value = string_view(v, static_cast<size_t>(p - v));
+			}
+		}
+
+		if (p == nullptr) {
+			return false;
+		}
+
+		p = skip_ws(p, end);
+
+		if (p >= end) {
+			return false;
+		}
+
+		if (*p == ',') {
+			p = skip_ws(p + 1, end);
+			continue;
+		}
+
+		if (*p == '}') {
+			return skip_ws(p + 1, end) == end;
+		}
+
+		return false;
+	}
+}
+
+string_view unverified_peek::find(const member *members, size_t count, string_view name) noexcept {
+	for (size_t i = 0; i < count; ++i) {
+		if (members[i].key == name) {
+			return members[i].value;
+		}
+	}
+
+	return string_view();
+}
+
+bool unverified_peek::parse(const char *token, size_t size) noexcept {
+	_header_count = 0;
+	_claims_count = 0;
+	_token        = string_view();
+
+	const size_t prefix = sizeof(bearer_prefix) - 1;
+
+	if (size >= prefix) {
+		size_t i = 0;
+
+		while (i < prefix && bearer_prefix[i] == (token[i] | 0x20)) {
+			++i;
+		}
+
+		if (i == prefix) {
+			token += prefix;
+			size  -= prefix;
+		}
+	}
+
+	auto dot1 = static_cast<const char *>(std::memchr(token, '.', size));
+	if (dot1 == nullptr) {
+		return false;
+	}
+
+	auto rest = static_cast<size_t>(token + size - (dot1 + 1));
+	auto dot2 = static_cast<const char *>(std::memchr(dot1 + 1, '.', rest));
+	if (dot2 == nullptr || std::memchr(dot2 + 1, '.', static_cast<size_t>(token + size - (dot2 + 1))) != nullptr) {
+		return false;
+	}
+
+	auto out = reinterpret_cast<uint8_t *>(_buf);
+
+	size_t hdr_size = buffer_size;
+	if (!b64::decode_uri(token, static_cast<size_t>(dot1 - token), out, hdr_size)) {
+		return false;
+	}
+
+	size_t claims_size = buffer_size - hdr_size;
+	if (!b64::decode_uri(dot1 + 1, static_cast<size_t>(dot2 - dot1 - 1), out + hdr_size, claims_size)) {
+		return false;
+	}
+
+	if (!index(_buf, _buf + hdr_size, _header, _header_count)
+		|| !index(_buf + hdr_size, _buf + hdr_size + claims_size, _claims, _claims_count)) {
+		_header_count = 0;
+		_claims_count = 0;
+		return false;
+	}
+
+	_token = string_view(token, size);
+
+	return true;
+}
+
+string_view unverified_peek::header(string_view name) const noexcept {
+	return find(_header, _header_count, name);
+}
+
+string_view unverified_peek::claim(string_view name) const noexcept {
+	return find(_claims, _claims_count, name);
+}
+
+bool unverified_peek::has_claim(string_view name) const noexcept {
+	for (size_t i = 0; i < _claims_count; ++i) {
+		if (_claims[i].key == name) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace jwtpp
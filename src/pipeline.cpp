@@ -0,0 +1,316 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <vector>
+
+#include <jwtpp/pipeline.hh>
+#include <jwtpp/spsc.hh>
+
+namespace jwtpp {
+
+struct pipeline::item {
+	item()
+		: tag(0)
+		, bearer()
+		, j()
+		, c()
+		, st(status::OK)
+	{}
+
+	uint64_t    tag;
+	std::string bearer;
+	sp_jws      j;
+	sp_crypto   c;
+	status      st;
+};
+
+struct pipeline::state {
+	state(key_resolver r, sink o, jws::verify_cb p, const options &opts)
+		: resolve(std::move(r))
+		, out(std::move(o))
+		, policy(std::move(p))
+		, batch_size(std::max<size_t>(1, opts.batch_size))
+		, input(opts.queue_size)
+		, parsed(opts.queue_size)
+		, verified(opts.queue_size)
+		, input_closed(false)
+		, parse_done(false)
+		, verify_done(false)
+	{}
+
+	key_resolver       resolve;
+	sink               out;
+	jws::verify_cb     policy;
+	size_t             batch_size;
+	spsc_queue<item>   input;
+	spsc_queue<item>   parsed;
+	spsc_queue<item>   verified;
+	std::atomic<bool>  input_closed;
+	std::atomic<bool>  parse_done;
+	std::atomic<bool>  verify_done;
+};
+
+namespace {
+
+template <typename T>
+void push_wait(spsc_queue<T> &q, T &v) {
+	backoff b;
+
+	while (!q.try_push(v)) {
+		b.wait();
+	}
+}
+
+// pop from q, on empty queue return false once upstream is done and q is drained
+template <typename T>
+bool pop_wait(spsc_queue<T> &q, const std::atomic<bool> &upstream_done, T &v) {
+	backoff b;
+
+	for (;;) {
+		bool done = upstream_done.load(std::memory_order_acquire);
+
+		if (q.try_pop(v)) {
+			return true;
+		}
+
+		if (done) {
+			return false;
+		}
+
+		b.wait();
+	}
+}
+
+} // namespace
+
+pipeline::pipeline(key_resolver resolve, sink out, jws::verify_cb policy, options opts)
+	: _s()
+	, _parse()
+	, _verify()
+	, _validate()
+	, _closed(false)
+{
+	if (!resolve || !out) {
+		throw std::invalid_argument("resolver and sink must be set");
+	}
+
+	_s.reset(new state(std::move(resolve), std::move(out), std::move(policy), opts));
+
+	_parse    = std::thread(&pipeline::parse_stage, this);
+	_verify   = std::thread(&pipeline::verify_stage, this);
+	_validate = std::thread(&pipeline::validate_stage, this);
+}
+
+pipeline::~pipeline() {
+	close();
+}
+
+void pipeline::submit(uint64_t tag, std::string bearer) {
+	if (_closed) {
+		throw std::logic_error("pipeline is closed");
+	}
+
+	item i;
+	i.tag    = tag;
+	i.bearer = std::move(bearer);
+
+	push_wait(_s->input, i);
+}
+
+bool pipeline::try_submit(uint64_t tag, std::string &bearer) {
+	if (_closed) {
+		throw std::logic_error("pipeline is closed");
+	}
+
+	item i;
+	i.tag    = tag;
+	i.bearer = std::move(bearer);
+
+	if (!_s->input.try_push(i)) {
+		bearer = std::move(i.bearer);
+		return false;
+	}
+
+	return true;
+}
+
+void pipeline::close() {
+	if (_closed) {
+		return;
+	}
+
+	_closed = true;
+	_s->input_closed.store(true, std::memory_order_release);
+
+	_parse.join();
+	_verify.join();
+	_validate.join();
+}
+
+const char *pipeline::status2str(status s) {
+	switch (s) {
+	case status::OK:
+		return "ok";
+	case status::MALFORMED:
+		return "malformed token";
+	case status::UNKNOWN_KEY:
+		return "unknown key";
+	case status::ALG_MISMATCH:
+		return "alg mismatch";
+	case status::BAD_SIGNATURE:
+		return "bad signature";
+	case status::POLICY:
+		return "rejected by policy";
+	default:
+		return "unknown";
+	}
+}
+
+void pipeline::parse_stage() {
+	item i;
+
+	while (pop_wait(_s->input, _s->input_closed, i)) {
+		try {
+			i.j = jws::parse(i.bearer);
+		} catch (...) {
+			i.st = status::MALFORMED;
+		}
+
+		i.bearer.clear();
+
+		if (i.st == status::OK) {
+			try {
+				i.c = _s->resolve(*i.j);
+			} catch (...) {
+			}
+
+			if (!i.c) {
+				i.st = status::UNKNOWN_KEY;
+			} else if (i.c->alg() != i.j->alg()) {
+				i.st = status::ALG_MISMATCH;
+			}
+		}
+
+		push_wait(_s->parsed, i);
+	}
+
+	_s->parse_done.store(true, std::memory_order_release);
+}
+
+void pipeline::verify_stage() {
+	std::vector<item>   batch;
+	std::vector<size_t> order;
+
+	batch.reserve(_s->batch_size);
+
+	for (;;) {
+		item i;
+
+		if (!pop_wait(_s->parsed, _s->parse_done, i)) {
+			break;
+		}
+
+		batch.push_back(std::move(i));
+
+		while (batch.size() < _s->batch_size && _s->parsed.try_pop(i)) {
+			batch.push_back(std::move(i));
+		}
+
+		order.clear();
+
+		for (size_t n = 0; n < batch.size(); ++n) {
+			if (batch[n].st == status::OK) {
+				order.push_back(n);
+			}
+		}
+
+		// same key back to back keeps its state hot between verifications
+		std::stable_sort(order.begin(), order.end(), [&batch](size_t a, size_t b) {
+			auto &l = batch[a];
+			auto &r = batch[b];
+
+			if (l.c->alg() != r.c->alg()) {
+				return l.c->alg() < r.c->alg();
+			}
+
+			return std::less<const crypto *>()(l.c.get(), r.c.get());
+		});
+
+		for (auto n : order) {
+			auto &b = batch[n];
+
+			try {
+				if (!b.j->verify(b.c)) {
+					b.st = status::BAD_SIGNATURE;
+				}
+			} catch (...) {
+				b.st = status::BAD_SIGNATURE;
+			}
+		}
+
+		for (auto &b : batch) {
+			push_wait(_s->verified, b);
+		}
+
+		batch.clear();
+	}
+
+	_s->verify_done.store(true, std::memory_order_release);
+}
+
+void pipeline::validate_stage() {
+	item i;
+
+	while (pop_wait(_s->verified, _s->verify_done, i)) {
+		sp_claims cl;
+
+		if (i.st == status::OK) {
+			// aliasing pointer keeps parsed token alive with its claims
+			cl = sp_claims(i.j, &i.j->claims());
+
+			if (_s->policy) {
+				bool ok = false;
+
+				try {
+					ok = _s->policy(cl);
+				} catch (...) {
+				}
+
+				if (!ok) {
+					i.st = status::POLICY;
+					cl.reset();
+				}
+			}
+		}
+
+		i.j.reset();
+		i.c.reset();
+
+		try {
+			_s->out(i.tag, i.st, std::move(cl));
+		} catch (...) {
+		}
+	}
+}
+
+} // namespace jwtpp
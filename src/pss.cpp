@@ -5,6 +5,9 @@
 #include <iostream>
 
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
+#include <jwtpp/basic.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -24,38 +27,35 @@ pss::pss(sp_rsa_key key, alg_t a)
 }
 
 std::string pss::sign(const std::string &data) {
-	if (data.empty()) {
-		throw std::invalid_argument("data is empty");
+	probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
+
+	switch (_alg) {
+	case alg_t::PS256: return basic_signer<alg_t::PS256>::sign(_r, data);
+	case alg_t::PS384: return basic_signer<alg_t::PS384>::sign(_r, data);
+	case alg_t::PS512: return basic_signer<alg_t::PS512>::sign(_r, data);
+	default:
+		throw std::runtime_error("Invalid alg");
 	}
-
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
-
-	auto padded = std::shared_ptr<uint8_t>(new uint8_t[_key_size], std::default_delete<uint8_t[]>());
-
-	auto sig = std::shared_ptr<uint8_t>(new uint8_t[_key_size], std::default_delete<uint8_t[]>());
-
-	if (RSA_padding_add_PKCS1_PSS(_r.get(), padded.get(), d.data(), digest::md(_hash_type), -1) != 1) {
-		throw std::runtime_error("failed to create signature");
-	}
-
-	if (RSA_private_encrypt(_key_size, padded.get(), sig.get(), _r.get(), RSA_NO_PADDING) < 0) {
-		throw std::runtime_error("couldn't sign RSA");
-	}
-
-	return b64::encode_uri(sig.get(), _key_size);
 }
 
 bool pss::verify(const std::string &data, const std::string &sig) {
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
-
-	auto decrypted_sig = std::shared_ptr<uint8_t>(new uint8_t[_key_size], std::default_delete<uint8_t[]>());
-	auto decoded_sig = b64::decode_uri(sig.data(), sig.length());
-
-	if(RSA_public_decrypt(decoded_sig.size(), decoded_sig.data(), decrypted_sig.get(), _r.get(), RSA_NO_PADDING) < 0) {
-		throw std::runtime_error("invalid signature");
+	probe::timer t(stats::stage::CRYPTO_VERIFY, _alg);
+
+	switch (_alg) {
+	case alg_t::PS256: return basic_verifier<alg_t::PS256>::verify(_r, data, sig);
+	case alg_t::PS384: return basic_verifier<alg_t::PS384>::verify(_r, data, sig);
+	case alg_t::PS512: return basic_verifier<alg_t::PS512>::verify(_r, data, sig);
+	default:
+		throw std::runtime_error("Invalid alg");
 	}
+}
+
+void pss::warm() {
+	rsa_warm(_r.get());
+}
 
-	return RSA_verify_PKCS1_PSS(_r.get(), d.data(), digest::md(_hash_type), decrypted_sig.get(), -1) == 1;
+std::string pss::canonical_jwk() const {
+	return rsa_canonical_jwk(_r.get());
 }
 
 } // namespace jwtpp
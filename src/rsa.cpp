@@ -22,8 +22,14 @@
 
 #include <iostream>
 
+#include <openssl/err.h>
+#include <openssl/x509.h>
+
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/probe.hh>
+#include <jwtpp/basic.hh>
 #include <jwtpp/statics.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -38,38 +44,34 @@ rsa::rsa(sp_rsa_key key, alg_t a)
 	_key_size = static_cast<unsigned int>(RSA_size(_r.get()));
 }
 
-rsa::~rsa() {
-	static_instance();
-}
+rsa::~rsa() {}
 
 std::string rsa::sign(const std::string &data) {
-	if (data.empty()) {
-		throw std::invalid_argument("data is empty");
+	probe::timer t(stats::stage::CRYPTO_SIGN, _alg);
+
+	switch (_alg) {
+	case alg_t::RS256: return basic_signer<alg_t::RS256>::sign(_r, data);
+	case alg_t::RS384: return basic_signer<alg_t::RS384>::sign(_r, data);
+	case alg_t::RS512: return basic_signer<alg_t::RS512>::sign(_r, data);
+	default:
+		throw std::runtime_error("Invalid alg");
 	}
-
-	std::shared_ptr<uint8_t> sig = std::shared_ptr<uint8_t>(new uint8_t[_key_size], std::default_delete<uint8_t[]>());
-
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
-
-	if (RSA_sign(hash2nid(_hash_type), d.data(), static_cast<int>(d.size()), sig.get(), &_key_size, _r.get()) != 1) {
-		throw std::runtime_error("Couldn't sign RSA");
-	}
-
-	return b64::encode_uri(sig.get(), _key_size);
 }
 
 bool rsa::verify(const std::string &data, const std::string &sig) {
-	digest d(_hash_type, reinterpret_cast<const uint8_t *>(data.data()), data.length());
-
-	std::vector<uint8_t> s = b64::decode_uri(sig.data(), sig.length());
+	probe::timer t(stats::stage::CRYPTO_VERIFY, _alg);
+
+	switch (_alg) {
+	case alg_t::RS256: return basic_verifier<alg_t::RS256>::verify(_r, data, sig);
+	case alg_t::RS384: return basic_verifier<alg_t::RS384>::verify(_r, data, sig);
+	case alg_t::RS512: return basic_verifier<alg_t::RS512>::verify(_r, data, sig);
+	default:
+		throw std::runtime_error("Invalid alg");
+	}
+}
 
-	return RSA_verify(
-		hash2nid(_hash_type)
-		, d.data()
-		, static_cast<int>(d.size())
-		, reinterpret_cast<const uint8_t *>(s.data())
-		, static_cast<int>(s.size())
-		, _r.get()) == 1;
+void rsa::warm() {
+	rsa_warm(_r.get());
 }
 
 sp_rsa_key rsa::gen(int size) {
@@ -87,6 +89,8 @@ sp_rsa_key rsa::gen(int size) {
 }
 
 sp_rsa_key rsa::load_from_file(const std::string &path, password_cb on_password) {
+	openssl_init();
+
 	RSA *r;
 
 	auto f = up_file(::std::fopen(path.c_str(), "re"), ::std::fclose);
@@ -107,6 +111,8 @@ sp_rsa_key rsa::load_from_file(const std::string &path, password_cb on_password)
 }
 
 sp_rsa_key rsa::load_from_string(const std::string& str, password_cb on_password) {
+	openssl_init();
+
 	RSA *r;
 	
 	auto bio = std::unique_ptr<BIO, BIODeleter>{BIO_new_mem_buf(str.data(), str.size())};
@@ -123,25 +129,97 @@ sp_rsa_key rsa::load_from_string(const std::string& str, password_cb on_password
 	return std::shared_ptr<RSA>(r, ::RSA_free);
 }
 
-int rsa::password_loader(char *buf, int size, int rwflag, void *u) {
-	auto wrap = reinterpret_cast<on_password_wrap *>(u);
+sp_rsa_key rsa::load_private_der(const uint8_t *der, size_t size) {
+	RSA *r = nullptr;
+
+	const uint8_t *p = der;
+
+	switch (der_seq_tag(der, size, 1)) {
+	case V_ASN1_INTEGER:
+		// PKCS#1 RSAPrivateKey
+		r = d2i_RSAPrivateKey(nullptr, &p, static_cast<long>(size));
+		break;
+	case V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED: {
+		// PKCS#8 PrivateKeyInfo
+		auto p8 = std::shared_ptr<PKCS8_PRIV_KEY_INFO>(
+			d2i_PKCS8_PRIV_KEY_INFO(nullptr, &p, static_cast<long>(size)), ::PKCS8_PRIV_KEY_INFO_free);
+
+		if (p8) {
+			auto pkey = sp_evp_key(EVP_PKCS82PKEY(p8.get()), ::EVP_PKEY_free);
+			if (pkey) {
+				r = EVP_PKEY_get1_RSA(pkey.get());
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
 
-	if (wrap->cb == nullptr) {
-		wrap->required = true;
-		return 0;
+	if (r == nullptr) {
+		ERR_clear_error();
+		throw std::runtime_error("read rsa key");
 	}
 
-	secure_string pass;
-	int pass_size = 0;
+	return std::shared_ptr<RSA>(r, ::RSA_free);
+}
 
-	try {
-		wrap->cb(pass, rwflag);
-		pass_size = pass.copy(buf, secure_string::size_type(size), 0);
-	} catch (...) {
-		pass_size = 0;
+sp_rsa_key rsa::load_public_der(const uint8_t *der, size_t size) {
+	RSA *r = nullptr;
+
+	const uint8_t *p = der;
+
+	switch (der_seq_tag(der, size, 0)) {
+	case V_ASN1_INTEGER:
+		// PKCS#1 RSAPublicKey
+		r = d2i_RSAPublicKey(nullptr, &p, static_cast<long>(size));
+		break;
+	case V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED:
+		// SubjectPublicKeyInfo
+		r = d2i_RSA_PUBKEY(nullptr, &p, static_cast<long>(size));
+		break;
+	default:
+		break;
 	}
 
-	return pass_size;
+	if (r == nullptr) {
+		ERR_clear_error();
+		throw std::runtime_error("read rsa key");
+	}
+
+	return std::shared_ptr<RSA>(r, ::RSA_free);
+}
+
+sp_rsa_key rsa::load_raw(const uint8_t *n, size_t n_size, const uint8_t *e, size_t e_size) {
+	if (n == nullptr || n_size == 0 || e == nullptr || e_size == 0) {
+		throw std::invalid_argument("invalid rsa key params");
+	}
+
+	sp_rsa_key r(RSA_new(), ::RSA_free);
+
+	BIGNUM *bn_n = BN_bin2bn(n, static_cast<int>(n_size), nullptr);
+	BIGNUM *bn_e = BN_bin2bn(e, static_cast<int>(e_size), nullptr);
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	r->n = bn_n;
+	r->e = bn_e;
+
+	if (bn_n == nullptr || bn_e == nullptr) {
+		throw std::runtime_error("read rsa key");
+	}
+#else
+	if (bn_n == nullptr || bn_e == nullptr || RSA_set0_key(r.get(), bn_n, bn_e, nullptr) != 1) {
+		BN_free(bn_n);
+		BN_free(bn_e);
+		throw std::runtime_error("read rsa key");
+	}
+#endif
+
+	return r;
+}
+
+std::string rsa::canonical_jwk() const {
+	return rsa_canonical_jwk(_r.get());
 }
 
 } // namespace jwtpp
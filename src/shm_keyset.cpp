@@ -0,0 +1,607 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/shm_keyset.hh>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <jwtpp/epoch.hh>
+
+namespace jwtpp {
+
+namespace {
+
+const uint64_t keyset_magic = 0x31736b7070747766ULL; // "fwtppks1"
+const uint32_t keyset_version = 1;
+
+struct data_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint64_t generation;
+	uint32_t index_slots;
+	uint32_t reserved;
+	uint64_t size;
+};
+
+struct data_entry {
+	uint32_t kid_off;
+	uint32_t kid_len;
+	uint32_t data_off;
+	uint32_t data_len;
+	int32_t  fmt;
+	int32_t  alg;
+};
+
+// index holds entry number + 1, 0 marks empty slot
+using index_t = uint32_t;
+
+uint64_t fnv1a(const char *s, size_t len) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		h ^= static_cast<uint8_t>(s[i]);
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+std::string segment_name(const std::string &name, uint64_t generation) {
+	return name + "." + std::to_string(generation);
+}
+
+std::runtime_error sys_error(const std::string &what) {
+	return std::runtime_error(what + ": " + std::string(std::strerror(errno)));
+}
+
+class pin_guard final {
+public:
+	pin_guard() noexcept { epoch::pin(); }
+	~pin_guard() { epoch::unpin(); }
+
+	pin_guard(const pin_guard &) = delete;
+	pin_guard &operator=(const pin_guard &) = delete;
+};
+
+} // namespace
+
+struct shm_keyset::control {
+	std::atomic<uint64_t> generation;
+	char                  pad[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+// control segment opened for writing and locked against other publishers
+class shm_keyset::control_lock final {
+public:
+	explicit control_lock(const std::string &name)
+		: _fd(::shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600))
+		, _ctl(nullptr)
+	{
+		if (_fd < 0) {
+			throw sys_error("shm_open " + name);
+		}
+
+		if (::flock(_fd, LOCK_EX) != 0 || ::ftruncate(_fd, sizeof(control)) != 0) {
+			auto err = sys_error("lock " + name);
+			::close(_fd);
+			throw err;
+		}
+
+		auto p = ::mmap(nullptr, sizeof(control), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		if (p == MAP_FAILED) {
+			auto err = sys_error("mmap");
+			::close(_fd);
+			throw err;
+		}
+
+		_ctl = static_cast<control *>(p);
+	}
+
+	~control_lock() {
+		::munmap(_ctl, sizeof(control));
+		::close(_fd);
+	}
+
+	control_lock(const control_lock &) = delete;
+	control_lock &operator=(const control_lock &) = delete;
+
+	control *operator->() const noexcept { return _ctl; }
+
+private:
+	int      _fd;
+	control *_ctl;
+};
+
+struct shm_keyset::view {
+	void                                 *base;
+	size_t                                size;
+	uint64_t                              generation;
+	size_t                                count;
+	size_t                                index_slots;
+	const data_entry                     *entries;
+	const index_t                        *index;
+	const char                           *strings;
+	std::unique_ptr<std::once_flag[]>     once;
+	std::unique_ptr<sp_crypto[]>          keys;
+	std::unique_ptr<std::atomic<bool>[]>  ready;
+
+	view()
+		: base(nullptr)
+		, size(0)
+		, generation(0)
+		, count(0)
+		, index_slots(0)
+		, entries(nullptr)
+		, index(nullptr)
+		, strings(nullptr)
+	{}
+
+	~view() {
+		if (base != nullptr) {
+			::munmap(base, size);
+		}
+	}
+
+	view(const view &) = delete;
+	view &operator=(const view &) = delete;
+
+	// map and validate "<name>.<generation>", nullptr if it was already unlinked
+	static view *open(const std::string &name, uint64_t generation) {
+		int fd = ::shm_open(segment_name(name, generation).c_str(), O_RDONLY | O_CLOEXEC, 0);
+		if (fd < 0) {
+			if (errno == ENOENT) {
+				return nullptr;
+			}
+
+			throw sys_error("shm_open " + segment_name(name, generation));
+		}
+
+		std::unique_ptr<view> v(new view());
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			::close(fd);
+			throw sys_error("fstat");
+		}
+
+		v->size = static_cast<size_t>(st.st_size);
+		if (v->size < sizeof(data_header)) {
+			::close(fd);
+			throw std::runtime_error("shm keyset segment is truncated");
+		}
+
+		v->base = ::mmap(nullptr, v->size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (v->base == MAP_FAILED) {
+			v->base = nullptr;
+			throw sys_error("mmap");
+		}
+
+		auto hdr = static_cast<const data_header *>(v->base);
+		auto p   = static_cast<const char *>(v->base);
+
+		if (hdr->magic != keyset_magic || hdr->version != keyset_version || hdr->generation != generation ||
+		    hdr->size != v->size) {
+			throw std::runtime_error("shm keyset segment is invalid");
+		}
+
+		v->generation  = generation;
+		v->count       = hdr->count;
+		v->index_slots = hdr->index_slots;
+
+		size_t entries_off = sizeof(data_header);
+		size_t index_off   = entries_off + v->count * sizeof(data_entry);
+		size_t strings_off = index_off + v->index_slots * sizeof(index_t);
+
+		if (v->index_slots == 0 || (v->index_slots & (v->index_slots - 1)) != 0 || v->index_slots <= v->count ||
+		    strings_off > v->size) {
+			throw std::runtime_error("shm keyset segment is invalid");
+		}
+
+		v->entries = reinterpret_cast<const data_entry *>(p + entries_off);
+		v->index   = reinterpret_cast<const index_t *>(p + index_off);
+		v->strings = p + strings_off;
+
+		size_t strings_size = v->size - strings_off;
+
+		for (size_t i = 0; i < v->count; i++) {
+			auto &e = v->entries[i];
+
+			if (static_cast<size_t>(e.kid_off) + e.kid_len > strings_size ||
+			    static_cast<size_t>(e.data_off) + e.data_len > strings_size) {
+				throw std::runtime_error("shm keyset segment is invalid");
+			}
+		}
+
+		for (size_t i = 0; i < v->index_slots; i++) {
+			if (v->index[i] > v->count) {
+				throw std::runtime_error("shm keyset segment is invalid");
+			}
+		}
+
+		v->once.reset(new std::once_flag[v->count]);
+		v->keys.reset(new sp_crypto[v->count]);
+		v->ready.reset(new std::atomic<bool>[v->count]);
+
+		for (size_t i = 0; i < v->count; i++) {
+			v->ready[i].store(false, std::memory_order_relaxed);
+		}
+
+		return v.release();
+	}
+
+	sp_crypto find(const std::string &kid) {
+		if (count == 0) {
+			return nullptr;
+		}
+
+		auto mask = index_slots - 1;
+		auto pos  = fnv1a(kid.data(), kid.size()) & mask;
+
+		// index is never full, probing ends at empty slot
+		for (;; pos = (pos + 1) & mask) {
+			auto n = index[pos];
+			if (n == 0) {
+				return nullptr;
+			}
+
+			auto &e = entries[n - 1];
+
+			if (e.kid_len == kid.size() && std::memcmp(strings + e.kid_off, kid.data(), kid.size()) == 0) {
+				return at(n - 1);
+			}
+		}
+	}
+
+	sp_crypto at(size_t i) {
+		std::call_once(once[i], [this, i]() {
+			auto &e = entries[i];
+
+			key_blob b;
+			b.kid  = std::string(strings + e.kid_off, e.kid_len);
+			b.fmt  = static_cast<key_blob::format>(e.fmt);
+			b.alg  = static_cast<alg_t>(e.alg);
+			b.data = std::string(strings + e.data_off, e.data_len);
+
+			keys[i] = b.load();
+			ready[i].store(true, std::memory_order_release);
+		});
+
+		return keys[i];
+	}
+};
+
+uint64_t shm_keyset::publish(const std::string &name, const std::vector<key_blob> &blobs, std::vector<key_error> &errors) {
+	// loading is the validation, its result is not kept
+	(void)keyset::load(blobs, errors);
+
+	std::vector<bool> failed(blobs.size(), false);
+	for (auto &e : errors) {
+		failed[e.index] = true;
+	}
+
+	std::unordered_map<std::string, size_t> by_kid;
+	for (size_t i = 0; i < blobs.size(); i++) {
+		if (!failed[i]) {
+			by_kid[blobs[i].kid] = i;
+		}
+	}
+
+	size_t count = by_kid.size();
+	size_t index_slots = 2;
+	while (index_slots < count * 2) {
+		index_slots <<= 1;
+	}
+
+	size_t strings_off = sizeof(data_header) + count * sizeof(data_entry) + index_slots * sizeof(index_t);
+	size_t size = strings_off;
+
+	for (auto &k : by_kid) {
+		size += blobs[k.second].kid.size() + blobs[k.second].data.size();
+	}
+
+	if (size > UINT32_MAX) {
+		throw std::runtime_error("shm keyset is too big");
+	}
+
+	control_lock ctl(name);
+
+	uint64_t prev = ctl->generation.load(std::memory_order_relaxed);
+	uint64_t next = prev + 1;
+	auto     seg  = segment_name(name, next);
+
+	// leftover of publisher which died before bumping counter
+	::shm_unlink(seg.c_str());
+
+	int fd = ::shm_open(seg.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		throw sys_error("shm_open " + seg);
+	}
+
+	if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		::close(fd);
+		::shm_unlink(seg.c_str());
+		throw sys_error("ftruncate");
+	}
+
+	auto base = static_cast<char *>(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+	::close(fd);
+
+	if (base == MAP_FAILED) {
+		::shm_unlink(seg.c_str());
+		throw sys_error("mmap");
+	}
+
+	auto hdr     = reinterpret_cast<data_header *>(base);
+	auto entries = reinterpret_cast<data_entry *>(base + sizeof(data_header));
+	auto index   = reinterpret_cast<index_t *>(base + sizeof(data_header) + count * sizeof(data_entry));
+	auto strings = base + strings_off;
+
+	size_t n   = 0;
+	size_t off = 0;
+
+	for (auto &k : by_kid) {
+		auto &b = blobs[k.second];
+		auto &e = entries[n];
+
+		e.kid_off  = static_cast<uint32_t>(off);
+		e.kid_len  = static_cast<uint32_t>(b.kid.size());
+		std::memcpy(strings + off, b.kid.data(), b.kid.size());
+		off += b.kid.size();
+
+		e.data_off = static_cast<uint32_t>(off);
+		e.data_len = static_cast<uint32_t>(b.data.size());
+		std::memcpy(strings + off, b.data.data(), b.data.size());
+		off += b.data.size();
+
+		e.fmt = static_cast<int32_t>(b.fmt);
+		e.alg = static_cast<int32_t>(b.alg);
+
+		auto mask = index_slots - 1;
+		auto pos  = fnv1a(b.kid.data(), b.kid.size()) & mask;
+
+		while (index[pos] != 0) {
+			pos = (pos + 1) & mask;
+		}
+
+		index[pos] = static_cast<index_t>(++n);
+	}
+
+	hdr->version     = keyset_version;
+	hdr->count       = static_cast<uint32_t>(count);
+	hdr->generation  = next;
+	hdr->index_slots = static_cast<uint32_t>(index_slots);
+	hdr->size        = size;
+	hdr->magic       = keyset_magic;
+
+	::munmap(base, size);
+
+	ctl->generation.store(next, std::memory_order_release);
+
+	if (prev != 0) {
+		::shm_unlink(segment_name(name, prev).c_str());
+	}
+
+	return next;
+}
+
+void shm_keyset::unlink(const std::string &name) {
+	int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return;
+		}
+
+		throw sys_error("shm_open " + name);
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(control)) {
+		auto ctl = static_cast<const control *>(::mmap(nullptr, sizeof(control), PROT_READ, MAP_SHARED, fd, 0));
+		if (ctl != MAP_FAILED) {
+			::shm_unlink(segment_name(name, ctl->generation.load()).c_str());
+			::munmap(const_cast<control *>(ctl), sizeof(control));
+		}
+	}
+
+	::close(fd);
+	::shm_unlink(name.c_str());
+}
+
+shm_keyset::shm_keyset(const std::string &name)
+	: _name(name)
+	, _fd(::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0))
+	, _ctl(nullptr)
+	, _current(new view())
+	, _lock()
+	, _retired()
+{
+	if (_fd < 0) {
+		delete _current.load();
+		throw sys_error("shm_open " + name);
+	}
+
+	// publisher sizes control segment under lock right after creating it
+	struct stat st;
+	bool sized = false;
+
+	for (int attempt = 0; attempt < 1000 && !sized; attempt++) {
+		if (::fstat(_fd, &st) != 0) {
+			break;
+		}
+
+		sized = static_cast<size_t>(st.st_size) >= sizeof(control);
+		if (!sized) {
+			::usleep(1000);
+		}
+	}
+
+	if (sized) {
+		auto p = ::mmap(nullptr, sizeof(control), PROT_READ, MAP_SHARED, _fd, 0);
+		if (p != MAP_FAILED) {
+			_ctl = static_cast<const control *>(p);
+		}
+	}
+
+	if (_ctl == nullptr) {
+		::close(_fd);
+		delete _current.load();
+		throw std::runtime_error("shm keyset " + name + " is not initialized");
+	}
+
+	try {
+		refresh();
+	} catch (...) {
+		::munmap(const_cast<control *>(_ctl), sizeof(control));
+		::close(_fd);
+		delete _current.load();
+		throw;
+	}
+}
+
+shm_keyset::~shm_keyset() {
+	delete _current.load();
+
+	for (auto &r : _retired) {
+		delete r.first;
+	}
+
+	::munmap(const_cast<control *>(_ctl), sizeof(control));
+	::close(_fd);
+}
+
+sp_crypto shm_keyset::find(const std::string &kid) {
+	{
+		pin_guard pin;
+		auto v = _current.load(std::memory_order_acquire);
+
+		if (v->generation == _ctl->generation.load(std::memory_order_acquire)) {
+			return v->find(kid);
+		}
+	}
+
+	refresh();
+
+	pin_guard pin;
+	return _current.load(std::memory_order_acquire)->find(kid);
+}
+
+bool shm_keyset::refresh() {
+	std::lock_guard<std::mutex> lock(_lock);
+
+	auto cur = _current.load(std::memory_order_relaxed);
+
+	for (;;) {
+		auto generation = _ctl->generation.load(std::memory_order_acquire);
+		if (generation == cur->generation) {
+			return false;
+		}
+
+		// segment disappears if publisher has already moved past it, retry with new counter
+		auto next = view::open(_name, generation);
+		if (next == nullptr) {
+			if (_ctl->generation.load(std::memory_order_acquire) == generation) {
+				throw std::runtime_error("shm keyset " + segment_name(_name, generation) + " is missing");
+			}
+
+			continue;
+		}
+
+		_current.store(next, std::memory_order_release);
+		_retired.emplace_back(cur, epoch::advance());
+
+		reclaim();
+
+		return true;
+	}
+}
+
+uint64_t shm_keyset::generation() const noexcept {
+	pin_guard pin;
+	return _current.load(std::memory_order_acquire)->generation;
+}
+
+size_t shm_keyset::size() const noexcept {
+	pin_guard pin;
+	return _current.load(std::memory_order_acquire)->count;
+}
+
+std::vector<sp_crypto> shm_keyset::loaded() const {
+	std::vector<sp_crypto> keys;
+
+	pin_guard pin;
+	auto v = _current.load(std::memory_order_acquire);
+
+	for (size_t i = 0; i < v->count; i++) {
+		if (v->ready[i].load(std::memory_order_acquire)) {
+			keys.push_back(v->keys[i]);
+		}
+	}
+
+	return keys;
+}
+
+std::vector<sp_crypto> shm_keyset::all() {
+	std::vector<sp_crypto> keys;
+
+	pin_guard pin;
+	auto v = _current.load(std::memory_order_acquire);
+
+	keys.reserve(v->count);
+
+	for (size_t i = 0; i < v->count; i++) {
+		keys.push_back(v->at(i));
+	}
+
+	return keys;
+}
+
+void shm_keyset::reclaim() {
+	auto it = _retired.begin();
+
+	while (it != _retired.end()) {
+		if (epoch::safe(it->second)) {
+			delete it->first;
+			it = _retired.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
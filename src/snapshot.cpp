@@ -0,0 +1,358 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/snapshot.hh>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace jwtpp {
+
+namespace {
+
+const uint64_t snapshot_magic = 0x317377707074776aULL; // "jwtppws1"
+const uint32_t snapshot_version = 1;
+
+struct file_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t keys;
+	uint64_t entries;
+	uint64_t created;
+	uint64_t size;
+	uint64_t reserved[3];
+};
+
+const uint32_t key_flag_warm = 1;
+
+struct key_record {
+	uint32_t kid_len;
+	uint32_t thumbprint_len;
+	int32_t  alg;
+	uint32_t flags;
+};
+
+struct entry_record {
+	uint64_t hash[shm_token_cache::hash_words];
+	uint64_t exp;
+	uint32_t size;
+	uint32_t reserved;
+};
+
+size_t pad8(size_t v) {
+	return (v + 7) / 8 * 8;
+}
+
+void append(std::string &out, const void *data, size_t size) {
+	out.append(static_cast<const char *>(data), size);
+	out.resize(pad8(out.size()), '\0');
+}
+
+std::runtime_error sys_error(const std::string &what) {
+	return std::runtime_error(what + ": " + std::string(std::strerror(errno)));
+}
+
+// snapshot file mapped read-only, walked with bounds checks
+class mapped_file final {
+public:
+	explicit mapped_file(const std::string &path)
+		: _base(nullptr)
+		, _size(0)
+		, _pos(0)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			throw sys_error("open " + path);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			auto err = sys_error("fstat " + path);
+			::close(fd);
+			throw err;
+		}
+
+		_size = static_cast<size_t>(st.st_size);
+
+		if (_size > 0) {
+			_base = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+
+		::close(fd);
+
+		if (_base == MAP_FAILED || _base == nullptr) {
+			_base = nullptr;
+			throw std::runtime_error("snapshot " + path + " is not readable");
+		}
+
+		::madvise(_base, _size, MADV_SEQUENTIAL);
+	}
+
+	~mapped_file() {
+		if (_base != nullptr) {
+			::munmap(_base, _size);
+		}
+	}
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	size_t size() const noexcept { return _size; }
+
+	// next size bytes, nullptr if file ends before
+	const char *take(size_t size) noexcept {
+		if (size > _size - _pos) {
+			return nullptr;
+		}
+
+		auto p = static_cast<const char *>(_base) + _pos;
+		_pos += pad8(size) < _size - _pos ? pad8(size) : _size - _pos;
+
+		return p;
+	}
+
+private:
+	void  *_base;
+	size_t _size;
+	size_t _pos;
+};
+
+} // namespace
+
+void warm_snapshot::save(const std::string &path, const shm_token_cache &cache, const std::vector<sp_crypto> &keys) {
+	indexed_keys list;
+	list.reserve(keys.size());
+
+	for (auto &c : keys) {
+		if (c != nullptr) {
+			list.push_back(indexed_key{c->kid(), c, true});
+		}
+	}
+
+	save_indexed(path, cache, list);
+}
+
+void warm_snapshot::save_indexed(const std::string &path, const shm_token_cache &cache, const indexed_keys &keys) {
+	std::string out(sizeof(file_header), '\0');
+
+	file_header hdr;
+	std::memset(&hdr, 0, sizeof(hdr));
+
+	for (auto &k : keys) {
+		auto &thumbprint = k.key->thumbprint();
+
+		key_record r;
+		std::memset(&r, 0, sizeof(r));
+		r.kid_len        = static_cast<uint32_t>(k.kid.size());
+		r.thumbprint_len = static_cast<uint32_t>(thumbprint.size());
+		r.alg            = static_cast<int32_t>(k.key->alg());
+		r.flags          = k.warm ? key_flag_warm : 0;
+
+		append(out, &r, sizeof(r));
+		append(out, k.kid.data(), k.kid.size());
+		append(out, thumbprint.data(), thumbprint.size());
+
+		hdr.keys++;
+	}
+
+	auto        now = static_cast<uint64_t>(std::time(nullptr));
+	std::string blob(cache.blob_size(), '\0');
+
+	for (size_t i = 0; i < cache.slots(); i++) {
+		entry_record r;
+		std::memset(&r, 0, sizeof(r));
+
+		size_t size = 0;
+
+		if (!cache.read_slot(i, now, r.hash, r.exp, &blob[0], size)) {
+			continue;
+		}
+
+		r.size = static_cast<uint32_t>(size);
+
+		append(out, &r, sizeof(r));
+		append(out, blob.data(), size);
+
+		hdr.entries++;
+	}
+
+	hdr.magic   = snapshot_magic;
+	hdr.version = snapshot_version;
+	hdr.created = now;
+	hdr.size    = out.size();
+
+	std::memcpy(&out[0], &hdr, sizeof(hdr));
+
+	auto tmp = path + ".tmp";
+
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		throw sys_error("open " + tmp);
+	}
+
+	size_t written = 0;
+
+	while (written < out.size()) {
+		auto n = ::write(fd, out.data() + written, out.size() - written);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			auto err = sys_error("write " + tmp);
+			::close(fd);
+			::unlink(tmp.c_str());
+			throw err;
+		}
+
+		written += static_cast<size_t>(n);
+	}
+
+	if (::fsync(fd) != 0 || ::close(fd) != 0) {
+		auto err = sys_error("sync " + tmp);
+		::unlink(tmp.c_str());
+		throw err;
+	}
+
+	if (::rename(tmp.c_str(), path.c_str()) != 0) {
+		auto err = sys_error("rename " + tmp);
+		::unlink(tmp.c_str());
+		throw err;
+	}
+}
+
+void warm_snapshot::save(const std::string &path, const shm_token_cache &cache, const keyset &keys) {
+	indexed_keys list;
+	list.reserve(keys.keys().size());
+
+	for (auto &k : keys.keys()) {
+		list.push_back(indexed_key{k.first, k.second, true});
+	}
+
+	save_indexed(path, cache, list);
+}
+
+void warm_snapshot::save(const std::string &path, const shm_token_cache &cache, shm_keyset &keys) {
+	// cached tokens may come from any key of the generation, not only ones this process used
+	auto loaded = keys.loaded();
+	auto all    = keys.all();
+
+	indexed_keys list;
+	list.reserve(all.size());
+
+	for (auto &c : all) {
+		auto warm = std::find(loaded.begin(), loaded.end(), c) != loaded.end();
+		list.push_back(indexed_key{c->kid(), c, warm});
+	}
+
+	save_indexed(path, cache, list);
+}
+
+warm_snapshot::report warm_snapshot::load(const std::string &path, shm_token_cache &cache, const lookup_cb &lookup, uint64_t now) {
+	report r;
+	std::memset(&r, 0, sizeof(r));
+
+	mapped_file f(path);
+
+	// clear() racing key checks voids restored entries
+	auto gen = cache.generation();
+
+	auto hdr = reinterpret_cast<const file_header *>(f.take(sizeof(file_header)));
+	if (hdr == nullptr || hdr->magic != snapshot_magic || hdr->version != snapshot_version || hdr->size != f.size()) {
+		throw std::runtime_error("snapshot " + path + " is invalid");
+	}
+
+	for (uint32_t i = 0; i < hdr->keys; i++) {
+		auto kr = reinterpret_cast<const key_record *>(f.take(sizeof(key_record)));
+		const char *kid = kr != nullptr ? f.take(kr->kid_len) : nullptr;
+		const char *thumbprint = kid != nullptr ? f.take(kr->thumbprint_len) : nullptr;
+
+		if (thumbprint == nullptr) {
+			throw std::runtime_error("snapshot " + path + " is truncated");
+		}
+
+		auto c = lookup(std::string(kid, kr->kid_len));
+
+		if (c != nullptr && static_cast<int32_t>(c->alg()) == kr->alg &&
+		    c->thumbprint() == std::string(thumbprint, kr->thumbprint_len)) {
+			if ((kr->flags & key_flag_warm) != 0) {
+				c->warm();
+			}
+
+			r.keys++;
+		} else {
+			r.stale_keys++;
+		}
+	}
+
+	if (now == 0) {
+		now = static_cast<uint64_t>(std::time(nullptr));
+	}
+
+	for (uint64_t i = 0; i < hdr->entries; i++) {
+		auto er = reinterpret_cast<const entry_record *>(f.take(sizeof(entry_record)));
+		const char *blob = er != nullptr ? f.take(er->size) : nullptr;
+
+		if (blob == nullptr) {
+			throw std::runtime_error("snapshot " + path + " is truncated");
+		}
+
+		// without recorded keys there is nothing to vouch for entries
+		if (r.stale_keys != 0 || r.keys == 0) {
+			r.dropped++;
+		} else if (er->exp <= now) {
+			r.expired++;
+		} else if (cache.insert_hash(er->hash, er->exp, blob, er->size, gen)) {
+			r.tokens++;
+		} else {
+			r.dropped++;
+		}
+	}
+
+	return r;
+}
+
+warm_snapshot::report warm_snapshot::load(const std::string &path, shm_token_cache &cache, const keyset &keys, uint64_t now) {
+	return load(path, cache, [&keys](const std::string &kid) {
+		return keys.find(kid);
+	}, now);
+}
+
+warm_snapshot::report warm_snapshot::load(const std::string &path, shm_token_cache &cache, shm_keyset &keys, uint64_t now) {
+	return load(path, cache, [&keys](const std::string &kid) {
+		return keys.find(kid);
+	}, now);
+}
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
@@ -6,11 +6,6 @@
 
 namespace jwtpp {
 
-//#if defined(__GNUC__)
-//__attribute__((used))
-//#endif
-//static_init *instance = instantiate<static_init>();
-
-static_init &static_instance = static_init::inst();
+// OpenSSL is initialized lazily through openssl_init(), nothing runs at load time
 
 } // namespace jwtpp
@@ -0,0 +1,435 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+#include <jwtpp/stats.hh>
+#include <jwtpp/probe.hh>
+
+namespace jwtpp {
+
+const size_t stats::stages;
+const size_t stats::results;
+const size_t stats::algs;
+const size_t stats::histogram::sub_bits;
+const size_t stats::histogram::sub_buckets;
+const size_t stats::histogram::max_bits;
+const size_t stats::histogram::buckets;
+
+namespace {
+
+size_t msb(uint64_t v) {
+#if defined(__GNUC__)
+	return 63 - static_cast<size_t>(__builtin_clzll(v));
+#else
+	size_t r = 0;
+	while (v >>= 1) {
+		r++;
+	}
+	return r;
+#endif // defined(__GNUC__)
+}
+
+} // namespace
+
+size_t stats::histogram::bucket(uint64_t ns) noexcept {
+	if (ns < sub_buckets) {
+		return static_cast<size_t>(ns);
+	}
+
+	size_t e = msb(ns);
+	if (e >= max_bits) {
+		return buckets - 1;
+	}
+
+	return (e - sub_bits + 1) * sub_buckets + static_cast<size_t>((ns >> (e - sub_bits)) - sub_buckets);
+}
+
+uint64_t stats::histogram::bucket_upper(size_t b) noexcept {
+	if (b < sub_buckets) {
+		return b;
+	}
+
+	size_t   e = b / sub_buckets + sub_bits - 1;
+	uint64_t m = b % sub_buckets + sub_buckets;
+
+	return ((m + 1) << (e - sub_bits)) - 1;
+}
+
+void stats::histogram::record(uint64_t ns, uint64_t n) {
+	if (n == 0) {
+		return;
+	}
+
+	if (_counts.empty()) {
+		_counts.resize(buckets, 0);
+	}
+
+	_counts[bucket(ns)] += n;
+
+	_min = _count ? std::min(_min, ns) : ns;
+	_max = std::max(_max, ns);
+	_count += n;
+	_sum += ns * n;
+}
+
+void stats::histogram::merge(const histogram &h) {
+	if (h._count == 0) {
+		return;
+	}
+
+	if (_counts.empty()) {
+		_counts.resize(buckets, 0);
+	}
+
+	for (size_t i = 0; i < buckets; i++) {
+		_counts[i] += h._counts[i];
+	}
+
+	_min = _count ? std::min(_min, h._min) : h._min;
+	_max = std::max(_max, h._max);
+	_count += h._count;
+	_sum += h._sum;
+}
+
+uint64_t stats::histogram::percentile(double p) const noexcept {
+	if (_count == 0) {
+		return 0;
+	}
+
+	if (p <= 0.0) {
+		return _min;
+	}
+
+	p = std::min(p, 100.0);
+
+	auto target = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(_count)));
+	if (target == 0) {
+		target = 1;
+	}
+
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < buckets; i++) {
+		seen += _counts[i];
+		if (seen >= target) {
+			return std::max(std::min(bucket_upper(i), _max), _min);
+		}
+	}
+
+	return _max;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> stats::histogram::buckets_view() const {
+	std::vector<std::pair<uint64_t, uint64_t>> out;
+
+	for (size_t i = 0; i < _counts.size(); i++) {
+		if (_counts[i] != 0) {
+			out.emplace_back(bucket_upper(i), _counts[i]);
+		}
+	}
+
+	return out;
+}
+
+stats::snapshot::snapshot()
+	: _latency(stages * algs)
+	, _counts(stages * algs * results, 0)
+{}
+
+const stats::histogram &stats::snapshot::latency(stage s, alg_t a) const {
+	return _latency.at(static_cast<size_t>(s) * algs + static_cast<size_t>(a));
+}
+
+stats::histogram stats::snapshot::latency(stage s) const {
+	histogram h;
+
+	for (size_t a = 0; a < algs; a++) {
+		h.merge(_latency.at(static_cast<size_t>(s) * algs + a));
+	}
+
+	return h;
+}
+
+uint64_t stats::snapshot::count(stage s, alg_t a, result r) const {
+	return _counts.at((static_cast<size_t>(s) * algs + static_cast<size_t>(a)) * results + static_cast<size_t>(r));
+}
+
+uint64_t stats::snapshot::count(stage s, result r) const {
+	uint64_t n = 0;
+
+	for (size_t a = 0; a < algs; a++) {
+		n += count(s, static_cast<alg_t>(a), r);
+	}
+
+	return n;
+}
+
+const char *stats::stage2str(stage s) {
+	switch (s) {
+	case stage::PARSE:
+		return "parse";
+	case stage::DECODE:
+		return "decode";
+	case stage::JSON:
+		return "json";
+	case stage::VERIFY:
+		return "verify";
+	case stage::CRYPTO_VERIFY:
+		return "crypto_verify";
+	case stage::POLICY:
+		return "policy";
+	case stage::SIGN:
+		return "sign";
+	case stage::CRYPTO_SIGN:
+		return "crypto_sign";
+	default:
+		return "unknown";
+	}
+}
+
+const char *stats::result2str(result r) {
+	switch (r) {
+	case result::OK:
+		return "ok";
+	case result::MALFORMED:
+		return "malformed";
+	case result::BAD_HEADER:
+		return "bad_header";
+	case result::BAD_CLAIMS:
+		return "bad_claims";
+	case result::ALG_MISMATCH:
+		return "alg_mismatch";
+	case result::BAD_SIGNATURE:
+		return "bad_signature";
+	case result::REJECTED:
+		return "rejected";
+	case result::EXCEPTION:
+		return "exception";
+	default:
+		return "unknown";
+	}
+}
+
+#if defined(JWTPP_WITH_STATS)
+namespace {
+
+// written by owning thread only, hence load+store instead of RMW
+inline void bump(std::atomic<uint64_t> &v, uint64_t n) noexcept {
+	v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct cells {
+	cells() {
+		for (auto &b : buckets) {
+			b.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	std::atomic<uint64_t> buckets[stats::histogram::buckets];
+	std::atomic<uint64_t> count{0};
+	std::atomic<uint64_t> sum{0};
+	std::atomic<uint64_t> min{UINT64_MAX};
+	std::atomic<uint64_t> max{0};
+};
+
+struct block {
+	block() {
+		for (auto &h : latency) {
+			h.store(nullptr, std::memory_order_relaxed);
+		}
+
+		for (auto &c : counts) {
+			c.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	~block() {
+		for (auto &h : latency) {
+			delete h.load(std::memory_order_relaxed);
+		}
+	}
+
+	// histograms are allocated on first sample, most processes use one or two algs
+	std::atomic<cells *>  latency[stats::stages * stats::algs];
+	std::atomic<uint64_t> counts[stats::stages * stats::algs * stats::results];
+	bool                  in_use{false};
+};
+
+/**
+ * \brief Blocks of all threads ever recorded. Block of exited thread is kept
+ *        with its values and handed to the next new thread
+ */
+class registry {
+public:
+	static registry &inst() {
+		// never destroyed, threads may record during static destruction
+		static registry *r = new registry;
+		return *r;
+	}
+
+	block *acquire() {
+		std::lock_guard<std::mutex> l(_lock);
+
+		for (auto &b : _blocks) {
+			if (!b->in_use) {
+				b->in_use = true;
+				return b.get();
+			}
+		}
+
+		_blocks.emplace_back(new block);
+		_blocks.back()->in_use = true;
+
+		return _blocks.back().get();
+	}
+
+	void release(block *b) {
+		std::lock_guard<std::mutex> l(_lock);
+		b->in_use = false;
+	}
+
+	template <typename F>
+	void each(F f) {
+		std::lock_guard<std::mutex> l(_lock);
+
+		for (auto &b : _blocks) {
+			f(*b);
+		}
+	}
+
+private:
+	std::mutex                          _lock;
+	std::vector<std::unique_ptr<block>> _blocks;
+};
+
+class thread_block {
+public:
+	~thread_block() {
+		if (_b != nullptr) {
+			registry::inst().release(_b);
+		}
+	}
+
+	block &get() {
+		if (_b == nullptr) {
+			_b = registry::inst().acquire();
+		}
+
+		return *_b;
+	}
+
+private:
+	block *_b{nullptr};
+};
+
+thread_local thread_block tls_block;
+
+} // namespace
+
+namespace probe {
+
+void record(stats::stage s, alg_t a, uint64_t ns) noexcept {
+	auto &slot = tls_block.get().latency[static_cast<size_t>(s) * stats::algs + static_cast<size_t>(a)];
+
+	cells *c = slot.load(std::memory_order_relaxed);
+	if (c == nullptr) {
+		c = new (std::nothrow) cells;
+		if (c == nullptr) {
+			return;
+		}
+
+		slot.store(c, std::memory_order_release);
+	}
+
+	bump(c->buckets[stats::histogram::bucket(ns)], 1);
+	bump(c->count, 1);
+	bump(c->sum, ns);
+
+	if (ns < c->min.load(std::memory_order_relaxed)) {
+		c->min.store(ns, std::memory_order_relaxed);
+	}
+
+	if (ns > c->max.load(std::memory_order_relaxed)) {
+		c->max.store(ns, std::memory_order_relaxed);
+	}
+}
+
+void count(stats::stage s, alg_t a, stats::result r) noexcept {
+	auto idx = (static_cast<size_t>(s) * stats::algs + static_cast<size_t>(a)) * stats::results + static_cast<size_t>(r);
+
+	bump(tls_block.get().counts[idx], 1);
+}
+
+} // namespace probe
+
+stats::snapshot stats::collect() {
+	snapshot snap;
+
+	registry::inst().each([&snap](block &b) {
+		for (size_t i = 0; i < stages * algs; i++) {
+			cells *c = b.latency[i].load(std::memory_order_acquire);
+			if (c == nullptr) {
+				continue;
+			}
+
+			histogram h;
+
+			for (size_t k = 0; k < histogram::buckets; k++) {
+				auto n = c->buckets[k].load(std::memory_order_relaxed);
+				if (n != 0) {
+					h.record(histogram::bucket_upper(k), n);
+				}
+			}
+
+			// exact aggregates instead of bucket approximations, unless
+			// sampled in the middle of an update
+			auto mn = c->min.load(std::memory_order_relaxed);
+			auto mx = c->max.load(std::memory_order_relaxed);
+
+			if (h._count != 0 && mn <= mx) {
+				h._sum = c->sum.load(std::memory_order_relaxed);
+				h._min = mn;
+				h._max = mx;
+			}
+
+			snap._latency[i].merge(h);
+		}
+
+		for (size_t i = 0; i < stages * algs * results; i++) {
+			snap._counts[i] += b.counts[i].load(std::memory_order_relaxed);
+		}
+	});
+
+	return snap;
+}
+#else
+stats::snapshot stats::collect() {
+	return snapshot();
+}
+#endif // defined(JWTPP_WITH_STATS)
+
+} // namespace jwtpp
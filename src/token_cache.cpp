@@ -0,0 +1,542 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/token_cache.hh>
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <openssl/sha.h>
+
+namespace jwtpp {
+
+const size_t shm_token_cache::probe_window;
+const size_t shm_token_cache::default_blob_size;
+const size_t shm_token_cache::hash_words;
+
+static_assert(shm_token_cache::hash_words * 8 == SHA256_DIGEST_LENGTH, "token hash is SHA-256");
+
+namespace {
+
+const uint64_t cache_magic = 0x316374707074776aULL; // "jwtpptc1"
+const uint32_t cache_version = 1;
+
+struct token_hash {
+	uint64_t w[shm_token_cache::hash_words];
+};
+
+token_hash hash_token(string_view token) {
+	if (token.size() > 7 && (token.data()[0] == 'B' || token.data()[0] == 'b') &&
+	    std::memcmp(token.data() + 1, "earer ", 6) == 0) {
+		token = string_view(token.data() + 7, token.size() - 7);
+	}
+
+	token_hash h;
+	SHA256(reinterpret_cast<const uint8_t *>(token.data()), token.size(), reinterpret_cast<uint8_t *>(h.w));
+
+	return h;
+}
+
+size_t round_pow2(size_t v) {
+	size_t r = 1;
+	while (r < v) {
+		r <<= 1;
+	}
+
+	return r;
+}
+
+uint64_t unix_now() {
+	return static_cast<uint64_t>(std::time(nullptr));
+}
+
+} // namespace
+
+// all fields shared between processes are atomics: seqlock readers copy
+// slots concurrently with writers, relaxed loads keep that well defined
+struct shm_token_cache::segment {
+	std::atomic<uint64_t> magic;
+	uint32_t              version;
+	uint32_t              slot_size;
+	uint64_t              slots;
+	uint64_t              blob_size;
+	std::atomic<uint64_t> generation;
+	char                  pad[64 - 40];
+};
+
+struct shm_token_cache::slot {
+	std::atomic<uint32_t> seq;
+	std::atomic<uint32_t> size;
+	std::atomic<uint64_t> exp;
+	std::atomic<uint64_t> generation;
+	std::atomic<uint64_t> hash[hash_words];
+
+	std::atomic<uint64_t> *blob() noexcept {
+		return reinterpret_cast<std::atomic<uint64_t> *>(this + 1);
+	}
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && sizeof(std::atomic<uint32_t>) == 4, "unexpected atomic size");
+
+shm_token_cache::shm_token_cache(size_t slots, size_t blob_size)
+	: _fd(-1)
+	, _base(nullptr)
+	, _size(0)
+	, _slots(0)
+	, _blob_size(0)
+	, _slot_size(0)
+	, _seg(nullptr)
+{
+	if (slots == 0) {
+		throw std::invalid_argument("cache must have slots");
+	}
+
+	_fd = ::memfd_create("jwtpp-token-cache", MFD_CLOEXEC);
+	if (_fd < 0) {
+		throw std::runtime_error("memfd_create: " + std::string(std::strerror(errno)));
+	}
+
+	try {
+		map(true, slots, blob_size);
+	} catch (...) {
+		::close(_fd);
+		throw;
+	}
+}
+
+shm_token_cache::shm_token_cache(const std::string &name, size_t slots, size_t blob_size)
+	: _fd(-1)
+	, _base(nullptr)
+	, _size(0)
+	, _slots(0)
+	, _blob_size(0)
+	, _slot_size(0)
+	, _seg(nullptr)
+{
+	if (slots == 0) {
+		throw std::invalid_argument("cache must have slots");
+	}
+
+	bool create = true;
+
+	_fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (_fd < 0 && errno == EEXIST) {
+		create = false;
+		_fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+	}
+
+	if (_fd < 0) {
+		throw std::runtime_error("shm_open " + name + ": " + std::string(std::strerror(errno)));
+	}
+
+	try {
+		map(create, slots, blob_size);
+	} catch (...) {
+		::close(_fd);
+		if (create) {
+			::shm_unlink(name.c_str());
+		}
+		throw;
+	}
+
+	if (!create && (_slots != round_pow2(slots) || _blob_size != (blob_size + 7) / 8 * 8)) {
+		::munmap(_base, _size);
+		::close(_fd);
+		throw std::runtime_error("shm segment " + name + " has different layout");
+	}
+}
+
+shm_token_cache::shm_token_cache(by_fd, int fd)
+	: _fd(::fcntl(fd, F_DUPFD_CLOEXEC, 0))
+	, _base(nullptr)
+	, _size(0)
+	, _slots(0)
+	, _blob_size(0)
+	, _slot_size(0)
+	, _seg(nullptr)
+{
+	if (_fd < 0) {
+		throw std::runtime_error("dup: " + std::string(std::strerror(errno)));
+	}
+
+	try {
+		map(false, 0, 0);
+	} catch (...) {
+		::close(_fd);
+		throw;
+	}
+}
+
+std::unique_ptr<shm_token_cache> shm_token_cache::attach(int fd) {
+	return std::unique_ptr<shm_token_cache>(new shm_token_cache(by_fd(), fd));
+}
+
+shm_token_cache::~shm_token_cache() {
+	::munmap(_base, _size);
+	::close(_fd);
+}
+
+void shm_token_cache::map(bool create, size_t slots, size_t blob_size) {
+	if (create) {
+		_slots = round_pow2(slots);
+		_blob_size = (blob_size + 7) / 8 * 8;
+		_slot_size = (sizeof(slot) + _blob_size + 63) / 64 * 64;
+		_size = sizeof(segment) + _slots * _slot_size;
+
+		if (::ftruncate(_fd, static_cast<off_t>(_size)) != 0) {
+			throw std::runtime_error("ftruncate: " + std::string(std::strerror(errno)));
+		}
+	} else {
+		// creator may still be sizing segment
+		struct stat st;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+		for (;;) {
+			if (::fstat(_fd, &st) != 0) {
+				throw std::runtime_error("fstat: " + std::string(std::strerror(errno)));
+			}
+
+			if (static_cast<size_t>(st.st_size) >= sizeof(segment)) {
+				break;
+			}
+
+			if (std::chrono::steady_clock::now() > deadline) {
+				throw std::runtime_error("shm segment is not initialized");
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		_size = static_cast<size_t>(st.st_size);
+	}
+
+	_base = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if (_base == MAP_FAILED) {
+		_base = nullptr;
+		throw std::runtime_error("mmap: " + std::string(std::strerror(errno)));
+	}
+
+	_seg = static_cast<segment *>(_base);
+
+	if (create) {
+		// segment comes zero filled, which is a valid state for every atomic,
+		// construct them anyway to start their lifetime
+		new (&_seg->generation) std::atomic<uint64_t>(1);
+		_seg->version = cache_version;
+		_seg->slot_size = static_cast<uint32_t>(_slot_size);
+		_seg->slots = _slots;
+		_seg->blob_size = _blob_size;
+
+		for (size_t i = 0; i < _slots; i++) {
+			new (at(i)) slot();
+		}
+
+		_seg->magic.store(cache_magic, std::memory_order_release);
+
+		return;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+	while (_seg->magic.load(std::memory_order_acquire) != cache_magic) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			::munmap(_base, _size);
+			throw std::runtime_error("shm segment is not a token cache");
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	_slots = static_cast<size_t>(_seg->slots);
+	_blob_size = static_cast<size_t>(_seg->blob_size);
+	_slot_size = _seg->slot_size;
+
+	if (_seg->version != cache_version || _slots == 0 || (_slots & (_slots - 1)) != 0 ||
+	    _slot_size < sizeof(slot) + _blob_size || sizeof(segment) + _slots * _slot_size > _size) {
+		::munmap(_base, _size);
+		throw std::runtime_error("shm segment has incompatible layout");
+	}
+}
+
+shm_token_cache::slot *shm_token_cache::at(size_t index) const noexcept {
+	return reinterpret_cast<slot *>(static_cast<char *>(_base) + sizeof(segment) + index * _slot_size);
+}
+
+bool shm_token_cache::insert(string_view token, uint64_t exp, const char *blob, size_t size, uint64_t gen) noexcept {
+	if (size > _blob_size || exp <= unix_now()) {
+		return false;
+	}
+
+	return insert_hash(hash_token(token).w, exp, blob, size, gen);
+}
+
+bool shm_token_cache::insert(string_view token, uint64_t exp, const char *blob, size_t size) noexcept {
+	return insert(token, exp, blob, size, generation());
+}
+
+bool shm_token_cache::insert_hash(const uint64_t *hash, uint64_t exp, const char *blob, size_t size, uint64_t gen) noexcept {
+	if (size > _blob_size || gen != generation()) {
+		return false;
+	}
+
+	// pick slot: same token, free or stale, otherwise the one expiring first
+	slot    *victim = nullptr;
+	uint64_t victim_exp = UINT64_MAX;
+	auto     now = unix_now();
+
+	for (size_t p = 0; p < probe_window; p++) {
+		slot *s = at((hash[0] + p) & (_slots - 1));
+
+		bool same = true;
+		for (size_t i = 0; i < hash_words; i++) {
+			same = same && s->hash[i].load(std::memory_order_relaxed) == hash[i];
+		}
+
+		auto e = s->exp.load(std::memory_order_relaxed);
+		if (e <= now || s->generation.load(std::memory_order_relaxed) != gen) {
+			e = 0;
+		}
+
+		if (same) {
+			victim = s;
+			break;
+		}
+
+		if (e < victim_exp) {
+			victim = s;
+			victim_exp = e;
+		}
+	}
+
+	uint32_t seq = victim->seq.load(std::memory_order_relaxed);
+	if ((seq & 1) != 0 ||
+	    !victim->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+		return false;
+	}
+
+	std::atomic_thread_fence(std::memory_order_release);
+
+	// entry tagged with stale gen is invisible anyway, recheck only saves the write
+	if (gen != generation()) {
+		victim->seq.store(seq + 2, std::memory_order_release);
+		return false;
+	}
+
+	for (size_t i = 0; i < hash_words; i++) {
+		victim->hash[i].store(hash[i], std::memory_order_relaxed);
+	}
+
+	victim->exp.store(exp, std::memory_order_relaxed);
+	victim->generation.store(gen, std::memory_order_relaxed);
+	victim->size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+
+	auto words = victim->blob();
+
+	for (size_t i = 0; i < size; i += 8) {
+		uint64_t w = 0;
+		std::memcpy(&w, blob + i, size - i < 8 ? size - i : 8);
+		words[i / 8].store(w, std::memory_order_relaxed);
+	}
+
+	victim->seq.store(seq + 2, std::memory_order_release);
+
+	return true;
+}
+
+bool shm_token_cache::insert(string_view token, class claims &cl) {
+	return insert(token, cl, generation());
+}
+
+bool shm_token_cache::insert(string_view token, class claims &cl, uint64_t gen) {
+	if (!cl.has().exp()) {
+		return false;
+	}
+
+	auto exp = std::strtoull(cl.get().exp().c_str(), nullptr, 10);
+
+	// blob is decoded claims segment, exactly what the token carries
+	const char *begin = static_cast<const char *>(std::memchr(token.data(), '.', token.size()));
+	if (begin == nullptr) {
+		return false;
+	}
+
+	begin++;
+
+	auto end = static_cast<const char *>(std::memchr(begin, '.', static_cast<size_t>(token.data() + token.size() - begin)));
+	if (end == nullptr) {
+		return false;
+	}
+
+	std::string blob(_blob_size, '\0');
+	size_t      size = blob.size();
+
+	if (!b64::decode_uri(begin, static_cast<size_t>(end - begin), reinterpret_cast<uint8_t *>(&blob[0]), size)) {
+		return false;
+	}
+
+	return insert(token, exp, blob.data(), size, gen);
+}
+
+bool shm_token_cache::find(string_view token, uint64_t now, char *blob, size_t &size) const noexcept {
+	auto h   = hash_token(token);
+	auto gen = _seg->generation.load(std::memory_order_relaxed);
+
+	for (size_t p = 0; p < probe_window; p++) {
+		slot *s = at((h.w[0] + p) & (_slots - 1));
+
+		// writer holds slot for a few hundred nanoseconds at most
+		for (int attempt = 0; attempt < 64; attempt++) {
+			uint32_t seq = s->seq.load(std::memory_order_acquire);
+			if ((seq & 1) != 0) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			bool same = true;
+			for (size_t i = 0; i < hash_words; i++) {
+				same = same && s->hash[i].load(std::memory_order_relaxed) == h.w[i];
+			}
+
+			auto exp = s->exp.load(std::memory_order_relaxed);
+			auto g   = s->generation.load(std::memory_order_relaxed);
+			auto n   = s->size.load(std::memory_order_relaxed);
+
+			if (same && n <= _blob_size) {
+				auto words = s->blob();
+
+				for (size_t i = 0; i < n; i += 8) {
+					uint64_t w = words[i / 8].load(std::memory_order_relaxed);
+					std::memcpy(blob + i, &w, n - i < 8 ? n - i : 8);
+				}
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if (s->seq.load(std::memory_order_relaxed) != seq) {
+				continue;
+			}
+
+			if (!same) {
+				break;
+			}
+
+			if (exp <= now || g != gen) {
+				return false;
+			}
+
+			size = n;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool shm_token_cache::read_slot(size_t index, uint64_t now, uint64_t *hash, uint64_t &exp, char *blob, size_t &size) const noexcept {
+	slot *s   = at(index);
+	auto  gen = _seg->generation.load(std::memory_order_relaxed);
+
+	for (int attempt = 0; attempt < 64; attempt++) {
+		uint32_t seq = s->seq.load(std::memory_order_acquire);
+		if ((seq & 1) != 0) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		for (size_t i = 0; i < hash_words; i++) {
+			hash[i] = s->hash[i].load(std::memory_order_relaxed);
+		}
+
+		exp = s->exp.load(std::memory_order_relaxed);
+
+		auto g = s->generation.load(std::memory_order_relaxed);
+		auto n = s->size.load(std::memory_order_relaxed);
+
+		bool live = exp > now && g == gen && n <= _blob_size;
+
+		if (live) {
+			auto words = s->blob();
+
+			for (size_t i = 0; i < n; i += 8) {
+				uint64_t w = words[i / 8].load(std::memory_order_relaxed);
+				std::memcpy(blob + i, &w, n - i < 8 ? n - i : 8);
+			}
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (s->seq.load(std::memory_order_relaxed) != seq) {
+			continue;
+		}
+
+		size = n;
+
+		return live;
+	}
+
+	return false;
+}
+
+sp_claims shm_token_cache::find(string_view token) const {
+	std::string blob(_blob_size, '\0');
+	size_t      size = 0;
+
+	if (!find(token, unix_now(), &blob[0], size)) {
+		return nullptr;
+	}
+
+	blob.resize(size);
+
+	return std::make_shared<class claims>(blob);
+}
+
+void shm_token_cache::clear() noexcept {
+	_seg->generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+uint64_t shm_token_cache::generation() const noexcept {
+	return _seg->generation.load(std::memory_order_acquire);
+}
+
+void shm_token_cache::unlink(const std::string &name) {
+	if (::shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+		throw std::runtime_error("shm_unlink " + name + ": " + std::string(std::strerror(errno)));
+	}
+}
+
+} // namespace jwtpp
+
+#endif // defined(__linux__)
@@ -20,9 +20,13 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <cstring>
 #include <iostream>
 
+#include <openssl/err.h>
+
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/tools.hh>
 
 namespace jwtpp {
 
@@ -52,4 +56,143 @@ Json::Value unmarshal_b64(const std::string &b64) {
 	return unmarshal(decoded);
 }
 
+void rsa_warm(RSA *r) {
+	auto size = static_cast<size_t>(RSA_size(r));
+
+	std::vector<uint8_t> in(size, 0);
+	std::vector<uint8_t> out(size, 0);
+
+	in[size - 1] = 1;
+
+	if (RSA_public_encrypt(static_cast<int>(size), in.data(), out.data(), r, RSA_NO_PADDING) < 0) {
+		ERR_clear_error();
+	}
+}
+
+namespace {
+
+bool der_length(const uint8_t *&p, const uint8_t *end, size_t &len) {
+	if (p >= end) {
+		return false;
+	}
+
+	uint8_t b = *p++;
+
+	if (b < 0x80) {
+		len = b;
+	} else {
+		size_t n = b & 0x7f;
+
+		if (n == 0 || n > sizeof(size_t) || static_cast<size_t>(end - p) < n) {
+			return false;
+		}
+
+		len = 0;
+
+		while (n--) {
+			len = (len << 8) | *p++;
+		}
+	}
+
+	return static_cast<size_t>(end - p) >= len;
+}
+
+} // namespace
+
+int der_seq_tag(const uint8_t *der, size_t size, size_t index) {
+	const uint8_t *p   = der;
+	const uint8_t *end = der + size;
+	size_t len;
+
+	if (size < 2 || *p++ != 0x30 || !der_length(p, end, len)) {
+		return -1;
+	}
+
+	end = p + len;
+
+	for (size_t i = 0; p < end; ++i) {
+		int tag = *p++;
+
+		if (i == index) {
+			return tag;
+		}
+
+		if (!der_length(p, end, len)) {
+			return -1;
+		}
+
+		p += len;
+	}
+
+	return -1;
+}
+
+sp_crypto make_rsa_crypto(sp_rsa_key r, alg_t a) {
+	switch (a) {
+	case alg_t::RS256:
+	case alg_t::RS384:
+	case alg_t::RS512:
+		return std::make_shared<class rsa>(r, a);
+	case alg_t::PS256:
+	case alg_t::PS384:
+	case alg_t::PS512:
+		return std::make_shared<class pss>(r, a);
+	default:
+		throw std::invalid_argument("invalid alg for RSA key");
+	}
+}
+
+std::string canonical_jwk(std::initializer_list<std::pair<const char *, std::string>> members) {
+	size_t size = 2;
+
+	for (const auto &m : members) {
+		size += std::strlen(m.first) + m.second.size() + 6;
+	}
+
+	std::string out;
+	out.reserve(size);
+
+	out += '{';
+
+	for (const auto &m : members) {
+		if (out.size() > 1) {
+			out += ',';
+		}
+
+		out += '"';
+		out += m.first;
+		out += "\":\"";
+		out += m.second;
+		out += '"';
+	}
+
+	out += '}';
+
+	return out;
+}
+
+std::string rsa_canonical_jwk(const RSA *r) {
+	const BIGNUM *n;
+	const BIGNUM *e;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	n = r->n;
+	e = r->e;
+#else
+	RSA_get0_key(r, &n, &e, nullptr);
+#endif
+
+	std::vector<uint8_t> n_raw(static_cast<size_t>(BN_num_bytes(n)));
+	std::vector<uint8_t> e_raw(static_cast<size_t>(BN_num_bytes(e)));
+
+	BN_bn2bin(n, n_raw.data());
+	BN_bn2bin(e, e_raw.data());
+
+	return canonical_jwk({
+		{"e",   b64::encode_uri(e_raw)},
+		{"kty", "RSA"},
+		{"n",   b64::encode_uri(n_raw)},
+	});
+}
+
 } // namespace jwtpp
@@ -0,0 +1,243 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <jwtpp/verifier.hh>
+
+namespace jwtpp {
+
+issuer_verifier::issuer_verifier()
+	: _issuers()
+	, _index()
+{}
+
+void issuer_verifier::add(const std::string &iss, sp_keyset_holder keys, jws::verify_cb policy) {
+	if (iss.empty()) {
+		throw std::invalid_argument("issuer must not be empty");
+	}
+
+	if (!keys) {
+		throw std::invalid_argument("issuer keys must not be null");
+	}
+
+	for (auto &i : _issuers) {
+		if (i.iss == iss) {
+			i.keys   = std::move(keys);
+			i.policy = std::move(policy);
+			return;
+		}
+	}
+
+	issuer i;
+	i.h      = hash(iss.data(), iss.size());
+	i.iss    = iss;
+	i.keys   = std::move(keys);
+	i.policy = std::move(policy);
+
+	_issuers.push_back(std::move(i));
+
+	rehash();
+}
+
+bool issuer_verifier::remove(const std::string &iss) {
+	for (auto it = _issuers.begin(); it != _issuers.end(); ++it) {
+		if (it->iss == iss) {
+			_issuers.erase(it);
+			rehash();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+issuer_verifier::status issuer_verifier::verify(const std::string &token) const {
+	sp_claims cl;
+	return verify(token, cl);
+}
+
+issuer_verifier::status issuer_verifier::verify(const std::string &token, sp_claims &cl) const {
+	unverified_peek p;
+
+	if (!p.parse(token)) {
+		return status::MALFORMED;
+	}
+
+	if (p.header("typ") != string_view("JWT")) {
+		return status::MALFORMED;
+	}
+
+	auto iss = p.claim("iss");
+	if (iss.empty()) {
+		return status::UNKNOWN_ISSUER;
+	}
+
+	auto i = find(iss);
+	if (i == nullptr) {
+		return status::UNKNOWN_ISSUER;
+	}
+
+	auto a = crypto::str2alg(p.alg());
+	if (a >= alg_t::UNKNOWN) {
+		return status::MALFORMED;
+	}
+
+	sp_crypto c;
+
+	{
+		auto ks = i->keys->read();
+
+		if (p.kid().empty()) {
+			if (ks->size() == 1) {
+				c = ks->keys().begin()->second;
+			}
+		} else {
+			c = ks->find(std::string(p.kid()));
+		}
+	}
+
+	if (!c) {
+		return status::UNKNOWN_KEY;
+	}
+
+	if (c->alg() != a) {
+		return status::ALG_MISMATCH;
+	}
+
+	auto t    = p.token();
+	auto dot1 = static_cast<const char *>(std::memchr(t.data(), '.', t.size()));
+	auto dot2 = static_cast<const char *>(std::memchr(dot1 + 1, '.', static_cast<size_t>(t.end() - dot1 - 1)));
+
+	std::string data(t.data(), static_cast<size_t>(dot2 - t.data()));
+	std::string sig(dot2 + 1, static_cast<size_t>(t.end() - dot2 - 1));
+
+	try {
+		if (!c->verify(data, sig)) {
+			return status::BAD_SIGNATURE;
+		}
+	} catch (...) {
+		return status::BAD_SIGNATURE;
+	}
+
+	sp_claims verified;
+
+	try {
+		verified = std::make_shared<class claims>(std::string(dot1 + 1, dot2), true);
+	} catch (...) {
+		return status::MALFORMED;
+	}
+
+	// peek and full parser may disagree on duplicate members,
+	// issuer used to pick keys must be the one reported to caller
+	if (!verified->has().iss() || verified->get().iss() != std::string(iss)) {
+		return status::MALFORMED;
+	}
+
+	if (i->policy && !i->policy(verified)) {
+		return status::POLICY;
+	}
+
+	cl = std::move(verified);
+
+	return status::OK;
+}
+
+const char *issuer_verifier::status2str(status s) {
+	switch (s) {
+	case status::OK:
+		return "ok";
+	case status::MALFORMED:
+		return "malformed token";
+	case status::UNKNOWN_ISSUER:
+		return "unknown issuer";
+	case status::UNKNOWN_KEY:
+		return "unknown key";
+	case status::ALG_MISMATCH:
+		return "alg mismatch";
+	case status::BAD_SIGNATURE:
+		return "bad signature";
+	case status::POLICY:
+		return "rejected by policy";
+	default:
+		return "unknown";
+	}
+}
+
+// FNV-1a
+uint64_t issuer_verifier::hash(const char *data, size_t size) noexcept {
+	uint64_t h = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < size; ++i) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
+
+const issuer_verifier::issuer *issuer_verifier::find(string_view iss) const noexcept {
+	if (_index.empty()) {
+		return nullptr;
+	}
+
+	auto   h    = hash(iss.data(), iss.size());
+	size_t mask = _index.size() - 1;
+
+	for (size_t pos = static_cast<size_t>(h) & mask; ; pos = (pos + 1) & mask) {
+		uint32_t slot = _index[pos];
+
+		if (slot == 0) {
+			return nullptr;
+		}
+
+		auto &i = _issuers[slot - 1];
+
+		if (i.h == h && i.iss.size() == iss.size() && std::memcmp(i.iss.data(), iss.data(), iss.size()) == 0) {
+			return &i;
+		}
+	}
+}
+
+// open addressing with linear probing, load factor kept at or below 1/2.
+// Slot holds issuer position + 1, 0 marks empty slot
+void issuer_verifier::rehash() {
+	size_t cap = 8;
+
+	while (cap < _issuers.size() * 2) {
+		cap <<= 1;
+	}
+
+	std::vector<uint32_t> index(cap, 0);
+
+	for (size_t n = 0; n < _issuers.size(); ++n) {
+		size_t pos = static_cast<size_t>(_issuers[n].h) & (cap - 1);
+
+		while (index[pos] != 0) {
+			pos = (pos + 1) & (cap - 1);
+		}
+
+		index[pos] = static_cast<uint32_t>(n + 1);
+	}
+
+	_index.swap(index);
+}
+
+} // namespace jwtpp
@@ -0,0 +1,203 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Heap allocation budgets per API call. Numbers are upper bounds taken from
+// current implementation with some slack for standard library and jsoncpp
+// differences. When a change trips a budget either fix the regression or,
+// if the extra allocations are justified, raise the budget in the same change.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <iostream>
+
+#include <jwtpp/basic.hh>
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/verifier.hh>
+
+#include "alloc_hook.hh"
+
+namespace {
+
+struct usage {
+	uint64_t allocs;
+	uint64_t bytes;
+};
+
+/**
+ * \brief Run op once to warm up lazy state, then measure average of several runs
+ */
+template <typename Op>
+usage measure(const char *name, Op op) {
+	static const int runs = 8;
+
+	op();
+
+	alloc_hook::scope s;
+
+	for (int i = 0; i < runs; i++) {
+		op();
+	}
+
+	usage u = {s.allocs() / runs, s.bytes() / runs};
+
+	std::cout << "[ ALLOCS   ] " << name << ": " << u.allocs << " allocs, " << u.bytes << " bytes" << std::endl;
+
+	return u;
+}
+
+jwtpp::claims make_claims() {
+	jwtpp::claims cl;
+
+	cl.set().iss("https://issuer.example");
+	cl.set().sub("alice");
+	cl.set().aud("https://api.example");
+	cl.set().exp("4102444800");
+
+	return cl;
+}
+
+} // namespace
+
+TEST(jwtpp, alloc_hook_counts) {
+	alloc_hook::scope s;
+
+	auto p = new int(1);
+	delete p;
+
+	EXPECT_EQ(1, s.allocs());
+	EXPECT_EQ(sizeof(int), s.bytes());
+}
+
+TEST(jwtpp, alloc_budget_b64) {
+	std::string in(256, 'x');
+	std::string enc = jwtpp::b64::encode_uri(in);
+	char        out[jwtpp::b64::encoded_uri_size(256)];
+	uint8_t     dec[256];
+
+	auto u = measure("b64::encode_uri(buffer)", [&]() {
+		jwtpp::b64::encode_uri(reinterpret_cast<const uint8_t *>(in.data()), in.size(), out);
+	});
+	EXPECT_EQ(0, u.allocs);
+
+	u = measure("b64::decode_uri(buffer)", [&]() {
+		size_t size = sizeof(dec);
+		jwtpp::b64::decode_uri(enc.data(), enc.size(), dec, size);
+	});
+	EXPECT_EQ(0, u.allocs);
+
+	u = measure("b64::encode_uri(string)", [&]() {
+		jwtpp::b64::encode_uri(in);
+	});
+	EXPECT_LE(u.allocs, 6);
+
+	u = measure("b64::decode_uri(string)", [&]() {
+		jwtpp::b64::decode_uri(enc);
+	});
+	EXPECT_LE(u.allocs, 12);
+}
+
+TEST(jwtpp, alloc_budget_hs256_cached_header) {
+	// header was already looked at with unverified_peek and key resolved,
+	// verification itself must not touch the heap
+	jwtpp::secure_string secret("secret-secret-secret-secret-1234");
+	auto                 h = std::make_shared<jwtpp::hmac>(secret, jwtpp::alg_t::HS256);
+	auto                 cl = make_claims();
+	auto                 token = jwtpp::jws::sign_claims(cl, h);
+	auto                 dot = token.rfind('.');
+
+	jwtpp::unverified_peek p;
+
+	auto u = measure("unverified_peek::parse", [&]() {
+		EXPECT_TRUE(p.parse(token));
+	});
+	EXPECT_EQ(0, u.allocs);
+
+	uint8_t sig[jwtpp::basic_verifier<jwtpp::alg_t::HS256>::max_signature_size];
+	size_t  sig_size = sizeof(sig);
+	ASSERT_TRUE(jwtpp::b64::decode_uri(token.data() + dot + 1, token.size() - dot - 1, sig, sig_size));
+
+	u = measure("basic_verifier<HS256>::verify(raw)", [&]() {
+		EXPECT_TRUE(jwtpp::basic_verifier<jwtpp::alg_t::HS256>::verify(
+			secret, reinterpret_cast<const uint8_t *>(token.data()), dot, sig, sig_size));
+	});
+	EXPECT_EQ(0, u.allocs);
+}
+
+TEST(jwtpp, alloc_budget_hs256_jws) {
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	auto cl = make_claims();
+	auto bearer = jwtpp::jws::sign_bearer(cl, h);
+	auto token = bearer.substr(7);
+	auto dot = token.rfind('.');
+	auto data = token.substr(0, dot);
+	auto sig = token.substr(dot + 1);
+
+	auto u = measure("hmac::verify", [&]() {
+		EXPECT_TRUE(h->verify(data, sig));
+	});
+	EXPECT_EQ(0, u.allocs);
+
+	u = measure("hmac::sign", [&]() {
+		h->sign(data);
+	});
+	EXPECT_LE(u.allocs, 1);
+
+	u = measure("claims construction", [&]() {
+		make_claims();
+	});
+	EXPECT_LE(u.allocs, 10);
+
+	u = measure("jws::sign_claims", [&]() {
+		jwtpp::jws::sign_claims(cl, h);
+	});
+	EXPECT_LE(u.allocs, 48);
+
+	u = measure("jws::parse", [&]() {
+		jwtpp::jws::parse(bearer);
+	});
+	EXPECT_LE(u.allocs, 100);
+
+	u = measure("jws::parse + verify", [&]() {
+		EXPECT_TRUE(jwtpp::jws::parse(bearer)->verify(h));
+	});
+	EXPECT_LE(u.allocs, 100);
+}
+
+TEST(jwtpp, alloc_budget_issuer_verifier) {
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	h->kid("k1");
+
+	jwtpp::keyset ks;
+	ks.add(h);
+
+	jwtpp::issuer_verifier v;
+	v.add("https://issuer.example", std::make_shared<jwtpp::keyset_holder>(std::move(ks)));
+
+	auto cl = make_claims();
+	auto bearer = jwtpp::jws::sign_bearer(cl, h);
+
+	auto u = measure("issuer_verifier::verify", [&]() {
+		EXPECT_EQ(jwtpp::issuer_verifier::status::OK, v.verify(bearer));
+	});
+	EXPECT_LE(u.allocs, 52);
+}
@@ -0,0 +1,129 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <new>
+
+#include "alloc_hook.hh"
+
+namespace {
+
+// zero initialized, no dynamic init so safe to touch from operator new
+thread_local alloc_hook::counts tls_counts;
+
+void *counted_alloc(std::size_t size) noexcept {
+	tls_counts.allocs++;
+	tls_counts.bytes += size;
+
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+} // namespace
+
+namespace alloc_hook {
+
+counts current() noexcept {
+	return tls_counts;
+}
+
+} // namespace alloc_hook
+
+void *operator new(std::size_t size) {
+	void *p = counted_alloc(size);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+#if defined(__cpp_aligned_new)
+void *operator new(std::size_t size, std::align_val_t al) {
+	tls_counts.allocs++;
+	tls_counts.bytes += size;
+
+	auto a = static_cast<std::size_t>(al);
+
+	void *p = std::aligned_alloc(a, (size + a - 1) / a * a);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void *operator new[](std::size_t size, std::align_val_t al) {
+	return operator new(size, al);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+#endif // defined(__cpp_aligned_new)
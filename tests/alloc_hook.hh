@@ -0,0 +1,63 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Heap allocation counting for tests and benchmarks. Global operator new and
+// delete are replaced in alloc_hook.cpp, link it into exactly one binary.
+// Counters are per thread so work done by other threads does not leak into
+// measurement. Only operator new is seen: OpenSSL allocates with malloc and
+// is not counted.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace alloc_hook {
+
+struct counts {
+	uint64_t allocs;
+	uint64_t bytes;
+};
+
+/**
+ * \brief Allocations made by calling thread since it started
+ */
+counts current() noexcept;
+
+/**
+ * \brief Counts allocations made by calling thread during its lifetime
+ */
+class scope final {
+public:
+	scope() noexcept
+		: _start(current())
+	{}
+
+	uint64_t allocs() const noexcept { return current().allocs - _start.allocs; }
+
+	uint64_t bytes() const noexcept { return current().bytes - _start.bytes; }
+
+private:
+	counts _start;
+};
+
+} // namespace alloc_hook
@@ -62,3 +62,55 @@ TEST(jwtpp, b64)
 	EXPECT_EQ(in.size(), out.size());
 	EXPECT_EQ(in, out);
 }
+
+TEST(jwtpp, b64_decode_uri_buffer)
+{
+	for (size_t len = 0; len < 64; ++len) {
+		std::vector<uint8_t> in(len);
+		for (size_t i = 0; i < len; ++i) {
+			in[i] = static_cast<uint8_t>(i * 37 + 11);
+		}
+
+		auto enc = jwtpp::b64::encode_uri(in);
+
+		uint8_t out[64];
+		size_t out_size = sizeof(out);
+
+		EXPECT_TRUE(jwtpp::b64::decode_uri(enc.data(), enc.size(), out, out_size));
+		EXPECT_EQ(len, out_size);
+		EXPECT_EQ(in, std::vector<uint8_t>(out, out + out_size));
+
+		if (len > 0) {
+			out_size = len - 1;
+			EXPECT_FALSE(jwtpp::b64::decode_uri(enc.data(), enc.size(), out, out_size));
+		}
+	}
+
+	uint8_t out[16];
+	size_t out_size = sizeof(out);
+
+	EXPECT_TRUE(jwtpp::b64::decode_uri("YQ==", 4, out, out_size));
+	EXPECT_EQ(1, out_size);
+	EXPECT_EQ('a', out[0]);
+
+	out_size = sizeof(out);
+	EXPECT_FALSE(jwtpp::b64::decode_uri("YQ+/", 4, out, out_size));
+
+	out_size = sizeof(out);
+	EXPECT_FALSE(jwtpp::b64::decode_uri("Y", 1, out, out_size));
+}
+
+TEST(jwtpp, b64_encode_uri_buffer) {
+	std::string in;
+
+	for (size_t n = 0; n < 70; n++) {
+		char out[jwtpp::b64::encoded_uri_size(70)];
+
+		auto size = jwtpp::b64::encode_uri(reinterpret_cast<const uint8_t *>(in.data()), in.size(), out);
+
+		EXPECT_EQ(jwtpp::b64::encoded_uri_size(in.size()), size);
+		EXPECT_EQ(jwtpp::b64::encode_uri(in), std::string(out, size));
+
+		in.push_back(static_cast<char>(0xf8 + n * 37));
+	}
+}
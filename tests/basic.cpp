@@ -0,0 +1,113 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <jwtpp/basic.hh>
+
+static_assert(jwtpp::basic_signer<jwtpp::alg_t::HS256>::max_signature_size == 32, "HS256 signature size");
+static_assert(jwtpp::basic_signer<jwtpp::alg_t::HS512>::max_encoded_size == 86, "HS512 encoded size");
+static_assert(jwtpp::alg_traits<jwtpp::alg_t::ES384>::hash_size == 48, "ES384 hash size");
+static_assert(jwtpp::alg_traits<jwtpp::alg_t::PS256>::family == jwtpp::alg_family::PSS, "PS256 family");
+static_assert(!jwtpp::alg_traits<jwtpp::alg_t::RS256>::fixed_size, "RS256 size depends on key");
+
+TEST(jwtpp, basic_hmac) {
+	jwtpp::secure_string secret("secret");
+
+	jwtpp::basic_signer<jwtpp::alg_t::HS384>   s(secret);
+	jwtpp::basic_verifier<jwtpp::alg_t::HS384> v(secret);
+
+	auto h = std::make_shared<jwtpp::hmac>(secret, jwtpp::alg_t::HS384);
+
+	auto sig = s.sign("data");
+	EXPECT_EQ(h->sign("data"), sig);
+	EXPECT_TRUE(v.verify("data", sig));
+	EXPECT_TRUE(h->verify("data", sig));
+	EXPECT_FALSE(v.verify("datA", sig));
+	EXPECT_FALSE(v.verify("data", sig.substr(1)));
+	EXPECT_FALSE(v.verify("data", sig + "="));
+
+	uint8_t raw[jwtpp::basic_signer<jwtpp::alg_t::HS384>::max_signature_size];
+
+	auto size = s.sign(reinterpret_cast<const uint8_t *>("data"), 4, raw);
+	EXPECT_EQ(48, size);
+	EXPECT_TRUE(v.verify(reinterpret_cast<const uint8_t *>("data"), 4, raw, size));
+
+	raw[0] ^= 1;
+	EXPECT_FALSE(v.verify(reinterpret_cast<const uint8_t *>("data"), 4, raw, size));
+
+	EXPECT_THROW(jwtpp::basic_signer<jwtpp::alg_t::HS256>(jwtpp::secure_string()), std::invalid_argument);
+	EXPECT_THROW(s.sign(""), std::invalid_argument);
+}
+
+TEST(jwtpp, basic_rsa_pss) {
+	auto key = jwtpp::rsa::gen(2048);
+
+	jwtpp::basic_signer<jwtpp::alg_t::RS256>   rs(key);
+	jwtpp::basic_verifier<jwtpp::alg_t::RS256> rv(key);
+
+	auto r = std::make_shared<jwtpp::rsa>(key, jwtpp::alg_t::RS256);
+
+	// PKCS#1 v1.5 is deterministic
+	EXPECT_EQ(r->sign("data"), rs.sign("data"));
+	EXPECT_TRUE(rv.verify("data", rs.sign("data")));
+	EXPECT_FALSE(rv.verify("data", r->sign("other")));
+	EXPECT_FALSE(rv.verify("data", "!!!"));
+
+	jwtpp::basic_signer<jwtpp::alg_t::PS512>   ps(key);
+	jwtpp::basic_verifier<jwtpp::alg_t::PS512> pv(key);
+
+	auto p = std::make_shared<jwtpp::pss>(key, jwtpp::alg_t::PS512);
+
+	EXPECT_TRUE(pv.verify("data", p->sign("data")));
+	EXPECT_TRUE(p->verify("data", ps.sign("data")));
+	EXPECT_FALSE(pv.verify("other", ps.sign("data")));
+
+	EXPECT_THROW(jwtpp::basic_signer<jwtpp::alg_t::RS256>(nullptr), std::invalid_argument);
+}
+
+TEST(jwtpp, basic_ecdsa_eddsa) {
+	auto key = jwtpp::ecdsa::gen(NID_secp384r1);
+
+	jwtpp::basic_signer<jwtpp::alg_t::ES384>   s(key);
+	jwtpp::basic_verifier<jwtpp::alg_t::ES384> v(key);
+
+	auto e = std::make_shared<jwtpp::ecdsa>(key, jwtpp::alg_t::ES384);
+
+	EXPECT_TRUE(v.verify("data", e->sign("data")));
+	EXPECT_TRUE(e->verify("data", s.sign("data")));
+	EXPECT_FALSE(v.verify("other", s.sign("data")));
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	auto ed_key = jwtpp::eddsa::gen();
+
+	jwtpp::basic_signer<jwtpp::alg_t::EdDSA>   es(ed_key);
+	jwtpp::basic_verifier<jwtpp::alg_t::EdDSA> ev(ed_key);
+
+	auto ed = std::make_shared<jwtpp::eddsa>(ed_key);
+
+	// Ed25519 is deterministic
+	EXPECT_EQ(ed->sign("data"), es.sign("data"));
+	EXPECT_TRUE(ev.verify("data", es.sign("data")));
+	EXPECT_FALSE(ev.verify("other", es.sign("data")));
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+}
@@ -22,6 +22,16 @@
 
 #include <gtest/gtest.h>
 
+#include <set>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif // !defined(_WIN32)
+
 #include <jwtpp/jwtpp.hh>
 
 TEST(jwtpp, create_close_claims)
@@ -88,3 +98,114 @@ TEST(jwtpp, set__claim)
 	EXPECT_TRUE(cl.has().any("iat"));
 	EXPECT_TRUE(cl.get().anyInt("iat") == ts);
 }
+
+TEST(jwtpp, set_random_jti)
+{
+	std::set<std::string> seen;
+
+	for (int i = 0; i < 10000; i++) {
+		jwtpp::claims cl;
+		cl.set().jti();
+
+		auto jti = cl.get().jti();
+		EXPECT_EQ(22, jti.size());
+		EXPECT_EQ(std::string::npos, jti.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"));
+		EXPECT_TRUE(seen.insert(jti).second);
+	}
+
+	// every thread has own generator, streams must not repeat each other
+	std::vector<std::vector<std::string>> ids(4);
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < ids.size(); t++) {
+		threads.emplace_back([&ids, t]() {
+			for (int i = 0; i < 1000; i++) {
+				jwtpp::claims cl;
+				cl.set().jti();
+				ids[t].push_back(cl.get().jti());
+			}
+		});
+	}
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	for (auto &v : ids) {
+		for (auto &jti : v) {
+			EXPECT_TRUE(seen.insert(jti).second);
+		}
+	}
+}
+
+#if !defined(_WIN32)
+TEST(jwtpp, set_random_jti_fork)
+{
+	jwtpp::claims warm;
+	warm.set().jti();
+
+	int fds[2];
+	ASSERT_EQ(0, pipe(fds));
+
+	pid_t pid = fork();
+	ASSERT_NE(-1, pid);
+
+	if (pid == 0) {
+		jwtpp::claims cl;
+		cl.set().jti();
+		auto jti = cl.get().jti();
+		_exit(write(fds[1], jti.data(), jti.size()) == static_cast<ssize_t>(jti.size()) ? 0 : 1);
+	}
+
+	// parent continues the stream child inherited, child must have reseeded
+	jwtpp::claims cl;
+	cl.set().jti();
+
+	int status = 0;
+	ASSERT_EQ(pid, waitpid(pid, &status, 0));
+	ASSERT_TRUE(WIFEXITED(status));
+	ASSERT_EQ(0, WEXITSTATUS(status));
+
+	char buf[64];
+	auto n = read(fds[0], buf, sizeof(buf));
+	close(fds[0]);
+	close(fds[1]);
+
+	ASSERT_EQ(22, n);
+	EXPECT_NE(cl.get().jti(), std::string(buf, static_cast<size_t>(n)));
+}
+#endif // !defined(_WIN32)
+
+TEST(jwtpp, copy_claims)
+{
+	jwtpp::claims a;
+	a.set().sub("alice");
+
+	jwtpp::claims b(a);
+	b.set().sub("bob");
+
+	EXPECT_EQ("alice", a.get().sub());
+	EXPECT_EQ("bob", b.get().sub());
+
+	std::vector<jwtpp::claims> v;
+	for (int i = 0; i < 16; i++) {
+		v.push_back(a);
+		v.back().set().any("n", static_cast<Json::Int>(i));
+	}
+
+	for (int i = 0; i < 16; i++) {
+		EXPECT_EQ(i, v[i].get().anyInt("n"));
+	}
+
+	b = a;
+	EXPECT_EQ("alice", b.get().sub());
+	b.set().sub("carol");
+	EXPECT_EQ("alice", a.get().sub());
+
+	jwtpp::claims c(std::move(b));
+	EXPECT_EQ("carol", c.get().sub());
+
+	// vector<claims> moves elements on reallocation instead of copying JSON
+	static_assert(std::is_nothrow_move_constructible<jwtpp::claims>::value, "claims move must be noexcept");
+	static_assert(std::is_nothrow_move_assignable<jwtpp::claims>::value, "claims move must be noexcept");
+}
@@ -0,0 +1,146 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <jwtpp/completion_queue.hh>
+
+#if defined(__linux__)
+
+#include <thread>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+TEST(jwtpp, completion_queue_epoll) {
+	jwtpp::executor         ex(2);
+	jwtpp::completion_queue q(16);
+
+	EXPECT_EQ(16, q.capacity());
+
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+	ASSERT_GE(ep, 0);
+
+	epoll_event ev = {};
+	ev.events  = EPOLLIN;
+	ev.data.fd = q.fd();
+	ASSERT_EQ(0, epoll_ctl(ep, EPOLL_CTL_ADD, q.fd(), &ev));
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	auto cl = std::make_shared<jwtpp::claims>();
+	cl->set().iss("troian");
+
+	const uint64_t n = 100;
+
+	for (uint64_t i = 0; i < n; i++) {
+		q.sign_claims(ex, i, cl, h);
+	}
+
+	std::vector<jwtpp::completion_queue::completion> out;
+	size_t wakeups = 0;
+
+	while (out.size() < n) {
+		ASSERT_EQ(1, epoll_wait(ep, &ev, 1, 5000));
+		++wakeups;
+		q.drain(out);
+	}
+
+	EXPECT_LE(wakeups, n);
+
+	std::vector<bool> seen(n, false);
+	for (auto &c : out) {
+		EXPECT_EQ(jwtpp::completion_queue::op::SIGN, c.kind);
+		EXPECT_TRUE(c.ok);
+		EXPECT_FALSE(c.token.empty());
+		seen[c.tag] = true;
+	}
+	EXPECT_EQ(std::vector<bool>(n, true), seen);
+
+	auto token = out.front().token;
+	out.clear();
+
+	q.verify(ex, 1, "Bearer " + token, h);
+	q.verify(ex, 2, "garbage", h);
+	q.verify(ex, 3, "Bearer " + token, std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256));
+
+	while (out.size() < 3) {
+		ASSERT_EQ(1, epoll_wait(ep, &ev, 1, 5000));
+		q.drain(out);
+	}
+
+	for (auto &c : out) {
+		EXPECT_EQ(jwtpp::completion_queue::op::VERIFY, c.kind);
+		EXPECT_EQ(c.tag == 1, c.ok);
+		EXPECT_EQ(c.tag == 2, c.error != nullptr);
+	}
+
+	// drained and no signal left
+	EXPECT_EQ(0, epoll_wait(ep, &ev, 1, 0));
+
+	close(ep);
+}
+
+TEST(jwtpp, completion_queue_producers) {
+	jwtpp::completion_queue q(8);
+
+	const uint64_t per_thread = 5000;
+	const unsigned threads = 4;
+
+	std::vector<std::thread> producers;
+
+	for (unsigned t = 0; t < threads; t++) {
+		producers.emplace_back([&q, t, per_thread]() {
+			for (uint64_t i = 0; i < per_thread; i++) {
+				jwtpp::completion_queue::completion c;
+				c.tag  = t * per_thread + i;
+				c.kind = jwtpp::completion_queue::op::VERIFY;
+				c.ok   = true;
+				q.push(std::move(c));
+			}
+		});
+	}
+
+	std::vector<jwtpp::completion_queue::completion> out;
+	std::vector<uint64_t> last(threads, 0);
+
+	while (out.size() < threads * per_thread) {
+		size_t before = out.size();
+		q.drain(out, 3);
+
+		// each producer's completions arrive in order
+		for (size_t i = before; i < out.size(); i++) {
+			auto t = static_cast<unsigned>(out[i].tag / per_thread);
+			EXPECT_LE(last[t], out[i].tag % per_thread + 1);
+			last[t] = out[i].tag % per_thread + 1;
+		}
+	}
+
+	for (auto &p : producers) {
+		p.join();
+	}
+
+	EXPECT_EQ(std::vector<uint64_t>(threads, per_thread), last);
+	EXPECT_EQ(0, q.drain(out));
+}
+
+#endif // defined(__linux__)
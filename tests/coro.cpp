@@ -0,0 +1,188 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <jwtpp/coro.hh>
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// fire and forget coroutine, enough to drive awaitables in tests
+struct detached {
+	struct promise_type {
+		detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+// single threaded loop standing for caller's event loop
+class loop {
+public:
+	void post(std::function<void ()> f) {
+		std::lock_guard<std::mutex> l(_lock);
+		_q.push_back(std::move(f));
+		_cv.notify_one();
+	}
+
+	void run_until(const bool &done) {
+		while (!done) {
+			std::function<void ()> f;
+
+			{
+				std::unique_lock<std::mutex> l(_lock);
+				_cv.wait(l, [this]() { return !_q.empty(); });
+				f = std::move(_q.front());
+				_q.pop_front();
+			}
+
+			f();
+		}
+	}
+
+	std::thread::id id() const { return std::this_thread::get_id(); }
+
+private:
+	std::mutex                         _lock;
+	std::condition_variable            _cv;
+	std::deque<std::function<void ()>> _q;
+};
+
+} // namespace
+
+TEST(jwtpp, coro_sign_verify) {
+	jwtpp::executor pool(2);
+	loop            l;
+	bool            done = false;
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	auto cl = std::make_shared<jwtpp::claims>();
+	cl->set().iss("troian");
+
+	auto caller = std::this_thread::get_id();
+
+	[&]() -> detached {
+		auto token = co_await jwtpp::async_sign_claims(cl, h, l, pool);
+		EXPECT_EQ(caller, std::this_thread::get_id());
+		EXPECT_EQ(jwtpp::jws::sign_claims(*cl, h), token);
+
+		bool ok = co_await jwtpp::async_verify("Bearer " + token, h, l, nullptr, pool);
+		EXPECT_TRUE(ok);
+		EXPECT_EQ(caller, std::this_thread::get_id());
+
+		ok = co_await jwtpp::async_verify("Bearer " + token, h, l, [](jwtpp::sp_claims c) {
+			return c->check().iss("other");
+		}, pool);
+		EXPECT_FALSE(ok);
+
+		EXPECT_THROW(co_await jwtpp::async_verify("garbage", h, l, nullptr, pool), std::exception);
+
+		done = true;
+	}();
+
+	l.run_until(done);
+}
+
+TEST(jwtpp, coro_batch) {
+	jwtpp::executor pool(3);
+	loop            l;
+	bool            done = false;
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS512);
+
+	std::vector<jwtpp::sp_claims> cl;
+	for (int i = 0; i < 64; i++) {
+		auto c = std::make_shared<jwtpp::claims>();
+		c->set().sub("user" + std::to_string(i));
+		cl.push_back(c);
+	}
+
+	[&]() -> detached {
+		auto tokens = co_await jwtpp::async_sign_claims_batch(cl, h, l, pool);
+		EXPECT_EQ(cl.size(), tokens.size());
+
+		std::vector<std::string> bearers;
+		for (auto &t : tokens) {
+			bearers.push_back("Bearer " + t);
+		}
+		bearers.push_back("garbage");
+
+		auto res = co_await jwtpp::async_verify_batch(bearers, h, l, nullptr, pool);
+		EXPECT_EQ(bearers.size(), res.size());
+
+		for (size_t i = 0; i < tokens.size(); i++) {
+			EXPECT_TRUE(res[i]);
+		}
+		EXPECT_FALSE(res.back());
+
+		auto empty = co_await jwtpp::async_verify_batch({}, h, l, nullptr, pool);
+		EXPECT_TRUE(empty.empty());
+
+		done = true;
+	}();
+
+	l.run_until(done);
+}
+
+TEST(jwtpp, coro_batch_null_entry) {
+	jwtpp::executor pool(3);
+	loop            l;
+	bool            done = false;
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	// entries before the null one are already in flight when it is rejected
+	std::vector<jwtpp::sp_claims> cl;
+	for (int i = 0; i < 32; i++) {
+		auto c = std::make_shared<jwtpp::claims>();
+		c->set().sub("user" + std::to_string(i));
+		cl.push_back(i == 16 ? nullptr : c);
+	}
+
+	[&]() -> detached {
+		EXPECT_THROW(co_await jwtpp::async_sign_claims_batch(cl, h, l, pool), std::invalid_argument);
+
+		std::vector<std::string> bearers = {"Bearer a.b.c", "Bearer d.e.f"};
+
+		auto res = co_await jwtpp::async_verify_batch(bearers, nullptr, l, nullptr, pool);
+		EXPECT_EQ(2, res.size());
+		EXPECT_FALSE(res[0]);
+		EXPECT_FALSE(res[1]);
+
+		done = true;
+	}();
+
+	l.run_until(done);
+}
+
+#endif // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
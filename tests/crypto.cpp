@@ -22,7 +22,10 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include <jwtpp/jwtpp.hh>
+#include <jwtpp/jwks.hh>
 
 TEST(jwtpp, crypto_str2alg) {
 	EXPECT_EQ(jwtpp::alg_t::NONE,  jwtpp::crypto::str2alg("none"));
@@ -42,8 +45,23 @@ TEST(jwtpp, crypto_str2alg) {
 	EXPECT_EQ(jwtpp::alg_t::EdDSA, jwtpp::crypto::str2alg("EdDSA"));
 #endif // defined(JWTPP_SUPPORTED_EDDSA)
 	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("bsd"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg(""));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("HS25"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("HS2566"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("hs256"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("HX256"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("ES257"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg("None"));
+	EXPECT_EQ(jwtpp::alg_t::UNKNOWN, jwtpp::crypto::str2alg(std::string("HS256\0", 6)));
+
+	// view into a larger buffer, e.g. header being parsed
+	const char hdr[] = "\"alg\":\"RS384\"";
+	EXPECT_EQ(jwtpp::alg_t::RS384, jwtpp::crypto::str2alg(jwtpp::string_view(hdr + 7, 5)));
 }
 
+static_assert(jwtpp::crypto::alg2str(jwtpp::alg_t::PS384)[2] == '3', "alg2str is constexpr");
+static_assert(jwtpp::crypto::alg2str(jwtpp::alg_t::UNKNOWN) == nullptr, "alg2str is constexpr");
+
 TEST(jwtpp, crypto_alg2str) {
 	EXPECT_EQ(std::string(jwtpp::crypto::alg2str(jwtpp::alg_t::NONE)),  std::string("none"));
 	EXPECT_EQ(std::string(jwtpp::crypto::alg2str(jwtpp::alg_t::HS256)), std::string("HS256"));
@@ -63,3 +81,104 @@ TEST(jwtpp, crypto_alg2str) {
 #endif // defined(JWTPP_SUPPORTED_EDDSA)
 	EXPECT_EQ(jwtpp::crypto::alg2str(jwtpp::alg_t::UNKNOWN), nullptr);
 }
+
+TEST(jwtpp, crypto_thumbprint) {
+	// RFC 7638 section 3.1
+	const std::string jwk =
+		"{\"kty\":\"RSA\","
+		"\"n\":\"0vx7agoebGcQSuuPiLJXZptN9nndrQmbXEps2aiAFbWhM78LhWx4cbbfAAtVT86zwu1RK7aPFFxuhDR1L6tSoc_BJECPebWKRXjBZCiFV4n3oknjhMstn64tZ_2W-5JsGY4Hc5n9yBXArwl93lqt7_RN5w6Cf0h4QyQ5v-65YGjQR0_FDW2QvzqY368QQMicAtaSqzs8KJZgnYb9c7d0zgdAZHzu6qMQvRL5hajrn1n91CbOpbISD08qNLyrdkt-bFTWhAI4vMQFh6WeZu0fM4lFd2NcRwr3XPksINHaQ-G_xBniIqbw0Ls1jF44-csFCur-kEgU8awapJzKnqDKgw\","
+		"\"e\":\"AQAB\","
+		"\"alg\":\"RS256\","
+		"\"kid\":\"2011-04-29\"}";
+
+	jwtpp::sp_crypto c;
+
+	EXPECT_NO_THROW(c = jwtpp::jwk::load_from_string(jwk));
+	ASSERT_TRUE(c != nullptr);
+	EXPECT_EQ("NzbLsXh8uDCcd-6MNwXF4W_7noWXFZAfHkxZsRGC9Xs", c->thumbprint());
+	EXPECT_EQ("2011-04-29", c->kid());
+
+	// same key wrapped into PSS has the same thumbprint, absent kid defaults to it
+	auto no_kid = jwtpp::unmarshal(jwk);
+	no_kid.removeMember("kid");
+	no_kid["alg"] = "PS256";
+
+	EXPECT_NO_THROW(c = jwtpp::jwk::load(no_kid));
+	EXPECT_EQ("NzbLsXh8uDCcd-6MNwXF4W_7noWXFZAfHkxZsRGC9Xs", c->thumbprint());
+	EXPECT_EQ(c->thumbprint(), c->kid());
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	auto h_jwk = jwtpp::jwk::load_from_string("{\"kty\":\"oct\",\"k\":\"" + jwtpp::b64::encode_uri("secret") + "\"}");
+	EXPECT_EQ(43, h->thumbprint().size());
+	EXPECT_EQ(h->thumbprint(), h_jwk->thumbprint());
+
+	// thumbprint of oct key is a hash of the secret, it must not end up in token headers
+	EXPECT_TRUE(h_jwk->kid().empty());
+
+	auto ec = std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_secp384r1), jwtpp::alg_t::ES384);
+	EXPECT_EQ(43, ec->thumbprint().size());
+
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	auto ed_key = jwtpp::eddsa::gen();
+	auto ed = std::make_shared<jwtpp::eddsa>(ed_key);
+	auto ed_pub = std::make_shared<jwtpp::eddsa>(jwtpp::eddsa::get_pub(ed_key));
+	EXPECT_EQ(43, ed->thumbprint().size());
+	EXPECT_EQ(ed->thumbprint(), ed_pub->thumbprint());
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+}
+
+TEST(jwtpp, crypto_sign_batch) {
+	std::vector<jwtpp::claims> cls(50);
+
+	for (size_t i = 0; i < cls.size(); i++) {
+		cls[i].set().sub("user" + std::to_string(i));
+		cls[i].set().iss("jwtpp");
+	}
+
+	auto rsa_key = jwtpp::rsa::gen(1024);
+
+	std::vector<jwtpp::sp_crypto> keys = {
+		std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256),
+		std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS512),
+		std::make_shared<jwtpp::rsa>(rsa_key, jwtpp::alg_t::RS256),
+		std::make_shared<jwtpp::pss>(rsa_key, jwtpp::alg_t::PS256),
+		std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), jwtpp::alg_t::ES256),
+	};
+
+	keys[0]->kid("k0");
+
+	for (auto &c : keys) {
+		for (unsigned threads : {1u, 4u}) {
+			auto batch = jwtpp::jws::sign_batch(cls, c, threads);
+
+			ASSERT_EQ(cls.size(), batch.size());
+
+			size_t total = 0;
+
+			for (size_t i = 0; i < batch.size(); i++) {
+				auto token = std::string(batch[i]);
+				total += token.size();
+
+				// deterministic algorithms produce exactly what sign_claims does
+				if (c->alg() == jwtpp::alg_t::HS256 || c->alg() == jwtpp::alg_t::HS512 || c->alg() == jwtpp::alg_t::RS256) {
+					EXPECT_EQ(jwtpp::jws::sign_claims(cls[i], c), token);
+				}
+
+				auto jws = jwtpp::jws::parse("Bearer " + token);
+				ASSERT_TRUE(jws != nullptr);
+				EXPECT_TRUE(jws->verify(c));
+				EXPECT_EQ("user" + std::to_string(i), jws->claims().get().sub());
+			}
+
+			EXPECT_EQ(total, batch.buffer().size());
+		}
+	}
+
+	EXPECT_THROW(jwtpp::jws::sign_batch(cls, nullptr), std::invalid_argument);
+
+	jwtpp::claims one[1];
+	one[0].set().sub("single");
+	EXPECT_EQ(1, jwtpp::jws::sign_batch(one, keys[0]).size());
+
+	EXPECT_TRUE(jwtpp::jws::sign_batch(jwtpp::span<jwtpp::claims>(), keys[0]).empty());
+}
@@ -22,6 +22,7 @@
 
 #include <gtest/gtest.h>
 #include <openssl/err.h>
+#include <openssl/x509.h>
 
 #include <jwtpp/jwtpp.hh>
 
@@ -86,3 +87,50 @@ TEST(jwtpp, sign_verify_ecdsa256) {
 	bearer = "Bearer bla.bla.bla";
 	EXPECT_THROW(jws = jwtpp::jws::parse(bearer), std::exception);
 }
+
+TEST(jwtpp, ecdsa_load_der_raw) {
+	jwtpp::claims cl;
+
+	jwtpp::sp_ecdsa_key key;
+	EXPECT_NO_THROW(key = jwtpp::ecdsa::gen(NID_X9_62_prime256v1));
+
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, std::make_shared<jwtpp::ecdsa>(key, jwtpp::alg_t::ES256)));
+
+	uint8_t *buf = nullptr;
+	int len = i2d_ECPrivateKey(key.get(), &buf);
+	std::vector<uint8_t> sec1(buf, buf + len);
+	OPENSSL_free(buf);
+
+	buf = nullptr;
+	len = i2d_EC_PUBKEY(key.get(), &buf);
+	std::vector<uint8_t> spki(buf, buf + len);
+	OPENSSL_free(buf);
+
+	buf = nullptr;
+	auto point_len = EC_KEY_key2buf(key.get(), POINT_CONVERSION_UNCOMPRESSED, &buf, nullptr);
+	std::vector<uint8_t> point(buf, buf + point_len);
+	OPENSSL_free(buf);
+
+	buf = nullptr;
+	auto d_len = EC_KEY_priv2buf(key.get(), &buf);
+	std::vector<uint8_t> d(buf, buf + d_len);
+	OPENSSL_free(buf);
+
+	jwtpp::sp_ecdsa_key k;
+
+	EXPECT_NO_THROW(k = jwtpp::ecdsa::load_private_der(sec1.data(), sec1.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::ecdsa>(k, jwtpp::alg_t::ES256)));
+
+	EXPECT_NO_THROW(k = jwtpp::ecdsa::load_public_der(spki.data(), spki.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::ecdsa>(k, jwtpp::alg_t::ES256)));
+
+	EXPECT_NO_THROW(k = jwtpp::ecdsa::load_raw_public(NID_X9_62_prime256v1, point.data(), point.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::ecdsa>(k, jwtpp::alg_t::ES256)));
+
+	EXPECT_NO_THROW(k = jwtpp::ecdsa::load_raw_private(NID_X9_62_prime256v1, d.data(), d.size()));
+	auto resigned = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, std::make_shared<jwtpp::ecdsa>(k, jwtpp::alg_t::ES256)));
+	EXPECT_TRUE(resigned->verify(std::make_shared<jwtpp::ecdsa>(key, jwtpp::alg_t::ES256)));
+
+	EXPECT_THROW(jwtpp::ecdsa::load_raw_public(NID_secp384r1, point.data(), point.size()), std::exception);
+	EXPECT_THROW(jwtpp::ecdsa::load_private_der(spki.data(), spki.size()), std::exception);
+}
@@ -26,6 +26,8 @@
 
 #include <gtest/gtest.h>
 
+#include <openssl/x509.h>
+
 TEST(jwtpp, sign_verify_eddsa) {
 	jwtpp::claims cl;
 
@@ -85,4 +87,56 @@ TEST(jwtpp, sign_verify_eddsa) {
 	EXPECT_THROW(jws = jwtpp::jws::parse(bearer), std::exception);
 }
 
+TEST(jwtpp, eddsa_load_der_raw) {
+	jwtpp::claims cl;
+
+	jwtpp::sp_evp_key key;
+	EXPECT_NO_THROW(key = jwtpp::eddsa::gen());
+
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, std::make_shared<jwtpp::eddsa>(key)));
+
+	uint8_t *buf = nullptr;
+	int len = i2d_PUBKEY(key.get(), &buf);
+	std::vector<uint8_t> spki(buf, buf + len);
+	OPENSSL_free(buf);
+
+	auto p8 = std::shared_ptr<PKCS8_PRIV_KEY_INFO>(EVP_PKEY2PKCS8(key.get()), ::PKCS8_PRIV_KEY_INFO_free);
+	buf = nullptr;
+	len = i2d_PKCS8_PRIV_KEY_INFO(p8.get(), &buf);
+	std::vector<uint8_t> pkcs8(buf, buf + len);
+	OPENSSL_free(buf);
+
+	std::vector<uint8_t> raw_pub(32);
+	std::vector<uint8_t> raw_priv(32);
+	size_t raw_len = 32;
+	EVP_PKEY_get_raw_public_key(key.get(), raw_pub.data(), &raw_len);
+	raw_len = 32;
+	EVP_PKEY_get_raw_private_key(key.get(), raw_priv.data(), &raw_len);
+
+	jwtpp::sp_evp_key k;
+
+	EXPECT_NO_THROW(k = jwtpp::eddsa::load_public_der(spki.data(), spki.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::eddsa>(k)));
+
+	EXPECT_NO_THROW(k = jwtpp::eddsa::load_private_der(pkcs8.data(), pkcs8.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::eddsa>(k)));
+
+	EXPECT_NO_THROW(k = jwtpp::eddsa::load_raw_public(raw_pub.data(), raw_pub.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::eddsa>(k)));
+
+	EXPECT_NO_THROW(k = jwtpp::eddsa::load_raw_private(raw_priv.data(), raw_priv.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::eddsa>(k)));
+
+	EXPECT_THROW(jwtpp::eddsa::load_raw_public(raw_pub.data(), 31), std::exception);
+	EXPECT_THROW(jwtpp::eddsa::load_private_der(spki.data(), spki.size()), std::exception);
+
+	auto ec = jwtpp::ecdsa::gen(NID_X9_62_prime256v1);
+	buf = nullptr;
+	len = i2d_EC_PUBKEY(ec.get(), &buf);
+	std::vector<uint8_t> ec_spki(buf, buf + len);
+	OPENSSL_free(buf);
+
+	EXPECT_THROW(jwtpp::eddsa::load_public_der(ec_spki.data(), ec_spki.size()), std::exception);
+}
+
 #endif // defined(JWTPP_SUPPORTED_EDDSA)
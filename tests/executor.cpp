@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <jwtpp/executor.hh>
+
+TEST(jwtpp, executor_post) {
+	std::atomic<int> count(0);
+
+	{
+		jwtpp::executor ex(4);
+		EXPECT_EQ(4, ex.size());
+		EXPECT_EQ(-1, jwtpp::executor::worker_index());
+
+		for (int i = 0; i < 1000; i++) {
+			ex.post([&ex, &count]() {
+				EXPECT_GE(jwtpp::executor::worker_index(), 0);
+
+				// nested posts land on own queue
+				ex.post([&count]() { ++count; });
+				throw std::runtime_error("dropped");
+			});
+		}
+	}
+
+	EXPECT_EQ(1000, count.load());
+}
+
+TEST(jwtpp, executor_sign_verify_future) {
+	jwtpp::executor ex(2);
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	h->kid("k1");
+
+	auto cl = std::make_shared<jwtpp::claims>();
+	cl->set().iss("troian");
+
+	auto f = ex.sign_claims(cl, h);
+	auto token = f.get();
+
+	EXPECT_EQ(jwtpp::jws::sign_claims(*cl, h), token);
+
+	EXPECT_TRUE(ex.verify("Bearer " + token, h).get());
+	EXPECT_FALSE(ex.verify("Bearer " + token, h, [](jwtpp::sp_claims c) {
+		return c->check().iss("other");
+	}).get());
+
+	auto other = std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256);
+	EXPECT_FALSE(ex.verify("Bearer " + token, other).get());
+
+	auto bad = ex.verify("garbage", h);
+	EXPECT_THROW(bad.get(), std::exception);
+
+	EXPECT_THROW(ex.sign_claims(nullptr, h), std::exception);
+}
+
+TEST(jwtpp, executor_callbacks) {
+	jwtpp::executor ex(3);
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS384);
+
+	auto cl = std::make_shared<jwtpp::claims>();
+	cl->set().sub("alice");
+
+	const int n = 200;
+
+	std::mutex              lock;
+	std::condition_variable cv;
+	int                     ok = 0;
+	int                     done = 0;
+
+	for (int i = 0; i < n; i++) {
+		ex.sign_claims(cl, h, [&](std::exception_ptr e, std::string token) {
+			EXPECT_TRUE(e == nullptr);
+
+			ex.verify("Bearer " + token, h, nullptr, [&](std::exception_ptr ve, bool res) {
+				std::lock_guard<std::mutex> l(lock);
+				ok += (ve == nullptr && res) ? 1 : 0;
+				++done;
+				cv.notify_one();
+			});
+		});
+	}
+
+	std::unique_lock<std::mutex> l(lock);
+	cv.wait(l, [&]() { return done == n; });
+
+	EXPECT_EQ(n, ok);
+}
@@ -0,0 +1,218 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/jwks.hh>
+
+static std::string bn2b64(const BIGNUM *b) {
+	std::vector<uint8_t> buf(static_cast<size_t>(BN_num_bytes(b)));
+	BN_bn2bin(b, buf.data());
+	return jwtpp::b64::encode_uri(buf);
+}
+
+static Json::Value rsa_jwk(jwtpp::sp_rsa_key key, const std::string &kid) {
+	const BIGNUM *n;
+	const BIGNUM *e;
+	RSA_get0_key(key.get(), &n, &e, nullptr);
+
+	Json::Value j;
+	j["kty"] = "RSA";
+	j["kid"] = kid;
+	j["n"] = bn2b64(n);
+	j["e"] = bn2b64(e);
+
+	return j;
+}
+
+static void write_file(const std::string &path, const Json::Value &set) {
+	std::string tmp = path + ".tmp";
+	{
+		std::ofstream f(tmp);
+		f << jwtpp::marshal(set);
+	}
+	std::rename(tmp.c_str(), path.c_str());
+}
+
+TEST(jwtpp, jwk_load_rsa) {
+	jwtpp::claims cl;
+	cl.set().iss("troian");
+
+	jwtpp::sp_rsa_key key;
+	EXPECT_NO_THROW(key = jwtpp::rsa::gen(2048));
+
+	auto signer = std::make_shared<jwtpp::rsa>(key, jwtpp::alg_t::RS256);
+
+	jwtpp::sp_crypto c;
+	EXPECT_NO_THROW(c = jwtpp::jwk::load(rsa_jwk(key, "r1")));
+	ASSERT_TRUE(c != nullptr);
+
+	EXPECT_EQ("r1", c->kid());
+	EXPECT_EQ(jwtpp::alg_t::RS256, c->alg());
+
+	EXPECT_NO_THROW(c->warm());
+
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, signer));
+	EXPECT_TRUE(jws->verify(c));
+
+	auto j = rsa_jwk(key, "r1");
+	j["alg"] = "PS256";
+	EXPECT_NO_THROW(c = jwtpp::jwk::load(j));
+	EXPECT_EQ(jwtpp::alg_t::PS256, c->alg());
+
+	j["alg"] = "ES256";
+	EXPECT_THROW(jwtpp::jwk::load(j), std::exception);
+
+	// malformed member after others were decoded
+	j = rsa_jwk(key, "r1");
+	j["e"] = 5;
+	EXPECT_THROW(jwtpp::jwk::load(j), std::exception);
+
+	j = rsa_jwk(key, "r1");
+	j["d"] = j["n"];
+	j["p"] = j["e"];
+	j["q"] = j["e"];
+	j["dq"] = 5;
+	EXPECT_THROW(jwtpp::jwk::load(j), std::exception);
+}
+
+TEST(jwtpp, jwk_load_ec) {
+	jwtpp::claims cl;
+
+	auto key = jwtpp::ecdsa::gen(NID_X9_62_prime256v1);
+	auto signer = std::make_shared<jwtpp::ecdsa>(key, jwtpp::alg_t::ES256);
+
+	auto x = std::shared_ptr<BIGNUM>(BN_new(), ::BN_free);
+	auto y = std::shared_ptr<BIGNUM>(BN_new(), ::BN_free);
+	EC_POINT_get_affine_coordinates_GFp(EC_KEY_get0_group(key.get()), EC_KEY_get0_public_key(key.get()), x.get(), y.get(), nullptr);
+
+	Json::Value j;
+	j["kty"] = "EC";
+	j["crv"] = "P-256";
+	j["x"] = bn2b64(x.get());
+	j["y"] = bn2b64(y.get());
+
+	jwtpp::sp_crypto c;
+	EXPECT_NO_THROW(c = jwtpp::jwk::load(j));
+	ASSERT_TRUE(c != nullptr);
+	EXPECT_EQ(jwtpp::alg_t::ES256, c->alg());
+
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, signer));
+	EXPECT_TRUE(jws->verify(c));
+
+	j["crv"] = "P-192";
+	EXPECT_THROW(jwtpp::jwk::load(j), std::exception);
+}
+
+TEST(jwtpp, jwk_load_oct) {
+	jwtpp::claims cl;
+
+	auto signer = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS384);
+
+	jwtpp::sp_crypto c;
+	EXPECT_NO_THROW(c = jwtpp::jwk::load_from_string("{\"kty\":\"oct\",\"alg\":\"HS384\",\"k\":\"" + jwtpp::b64::encode_uri("secret") + "\"}"));
+	ASSERT_TRUE(c != nullptr);
+
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, signer));
+	EXPECT_TRUE(jws->verify(c));
+
+	EXPECT_THROW(jwtpp::jwk::load_from_string("{\"kty\":\"foo\"}"), std::exception);
+	EXPECT_THROW(jwtpp::jwk::load_from_string("{\"kty\":\"oct\"}"), std::exception);
+}
+
+TEST(jwtpp, jwks_load) {
+	auto k1 = jwtpp::rsa::gen(1024);
+
+	Json::Value set;
+	set["keys"].append(rsa_jwk(k1, "k1"));
+
+	auto enc = rsa_jwk(k1, "k2");
+	enc["use"] = "enc";
+	set["keys"].append(enc);
+
+	jwtpp::keyset ks;
+	EXPECT_NO_THROW(ks = jwtpp::jwks::load(set));
+	EXPECT_EQ(1, ks.size());
+	EXPECT_TRUE(ks.find("k1") != nullptr);
+
+	EXPECT_THROW(jwtpp::jwks::load_from_string("{}"), std::exception);
+}
+
+TEST(jwtpp, jwks_watcher_reload) {
+	std::string path = ::testing::TempDir() + "jwtpp_jwks_watcher.json";
+
+	auto k1 = jwtpp::rsa::gen(1024);
+	auto k2 = jwtpp::rsa::gen(1024);
+
+	Json::Value set;
+	set["keys"].append(rsa_jwk(k1, "k1"));
+	write_file(path, set);
+
+	auto holder = std::make_shared<jwtpp::keyset_holder>();
+
+	std::atomic<int> errors(0);
+
+	jwtpp::jwks_watcher w(path, holder, [&errors](const std::exception &) { errors++; }, std::chrono::milliseconds(20));
+
+	EXPECT_NO_THROW(w.start());
+	EXPECT_EQ(1, w.generation());
+
+	auto c1 = holder->find("k1");
+	ASSERT_TRUE(c1 != nullptr);
+	EXPECT_TRUE(holder->find("k2") == nullptr);
+
+	// nothing changed, nothing published
+	EXPECT_FALSE(w.reload());
+
+	set["keys"].append(rsa_jwk(k2, "k2"));
+	write_file(path, set);
+
+	for (int i = 0; i < 250 && w.generation() < 2; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	EXPECT_EQ(2, w.generation());
+	EXPECT_TRUE(holder->find("k2") != nullptr);
+
+	// unchanged key reused
+	EXPECT_EQ(c1, holder->find("k1"));
+
+	std::ofstream(path) << "{broken";
+
+	for (int i = 0; i < 250 && errors == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	w.stop();
+
+	EXPECT_GE(errors.load(), 1);
+	EXPECT_TRUE(holder->find("k2") != nullptr);
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,180 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <openssl/x509.h>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/key_store.hh>
+
+static jwtpp::key_blob oct_blob(const std::string &kid, const std::string &secret) {
+	jwtpp::key_blob b;
+	b.kid  = kid;
+	b.fmt  = jwtpp::key_blob::format::JWK;
+	b.alg  = jwtpp::alg_t::HS256;
+	b.data = "{\"kty\":\"oct\",\"k\":\"" + jwtpp::b64::encode_uri(secret) + "\"}";
+
+	return b;
+}
+
+TEST(jwtpp, key_blob_load) {
+	jwtpp::sp_crypto c;
+
+	EXPECT_NO_THROW(c = oct_blob("k1", "secret").load());
+	ASSERT_TRUE(c != nullptr);
+	EXPECT_EQ("k1", c->kid());
+	EXPECT_EQ(jwtpp::alg_t::HS256, c->alg());
+
+	auto key = jwtpp::rsa::gen(1024);
+
+	auto bio = std::unique_ptr<BIO, jwtpp::BIODeleter>(BIO_new(BIO_s_mem()));
+	PEM_write_bio_RSAPrivateKey(bio.get(), key.get(), nullptr, nullptr, 0, nullptr, nullptr);
+
+	char *pem;
+	auto pem_len = BIO_get_mem_data(bio.get(), &pem);
+
+	jwtpp::key_blob b;
+	b.kid  = "r1";
+	b.fmt  = jwtpp::key_blob::format::PEM;
+	b.alg  = jwtpp::alg_t::PS384;
+	b.data = std::string(pem, static_cast<size_t>(pem_len));
+
+	EXPECT_NO_THROW(c = b.load());
+	EXPECT_EQ(jwtpp::alg_t::PS384, c->alg());
+
+	b.alg = jwtpp::alg_t::HS256;
+	EXPECT_THROW(b.load(), std::exception);
+
+	uint8_t *buf = nullptr;
+	int len = i2d_RSA_PUBKEY(key.get(), &buf);
+
+	b.fmt  = jwtpp::key_blob::format::DER_PUBLIC;
+	b.alg  = jwtpp::alg_t::RS512;
+	b.data = std::string(reinterpret_cast<char *>(buf), static_cast<size_t>(len));
+	OPENSSL_free(buf);
+
+	EXPECT_NO_THROW(c = b.load());
+	EXPECT_EQ(jwtpp::alg_t::RS512, c->alg());
+	EXPECT_EQ("r1", c->kid());
+
+	auto ec = jwtpp::ecdsa::gen(NID_X9_62_prime256v1);
+	buf = nullptr;
+	len = i2d_ECPrivateKey(ec.get(), &buf);
+
+	b.fmt  = jwtpp::key_blob::format::DER_PRIVATE;
+	b.alg  = jwtpp::alg_t::ES256;
+	b.data = std::string(reinterpret_cast<char *>(buf), static_cast<size_t>(len));
+	OPENSSL_free(buf);
+
+	EXPECT_NO_THROW(c = b.load());
+	EXPECT_EQ(jwtpp::alg_t::ES256, c->alg());
+}
+
+TEST(jwtpp, key_store_lru) {
+	jwtpp::key_store store(2, 1);
+
+	EXPECT_THROW(jwtpp::key_store(0), std::exception);
+
+	store.add(oct_blob("k1", "s1"));
+	store.add(oct_blob("k2", "s2"));
+	store.add(oct_blob("k3", "s3"));
+
+	EXPECT_TRUE(store.get("none") == nullptr);
+
+	auto k1 = store.get("k1");
+	ASSERT_TRUE(k1 != nullptr);
+	EXPECT_EQ(k1, store.get("k1"));
+
+	auto k2 = store.get("k2");
+	ASSERT_TRUE(k2 != nullptr);
+
+	// touch k1 so k2 becomes least recently used
+	EXPECT_EQ(k1, store.get("k1"));
+
+	auto k3 = store.get("k3");
+	ASSERT_TRUE(k3 != nullptr);
+
+	auto st = store.stats();
+	EXPECT_EQ(2, st.hits);
+	EXPECT_EQ(3, st.misses);
+	EXPECT_EQ(1, st.evictions);
+	EXPECT_EQ(3, st.keys);
+	EXPECT_EQ(2, st.materialized);
+
+	EXPECT_EQ(k1, store.get("k1"));
+	EXPECT_NE(k2, store.get("k2"));
+
+	store.add(oct_blob("k1", "s1-rotated"));
+	EXPECT_NE(k1, store.get("k1"));
+
+	EXPECT_TRUE(store.remove("k1"));
+	EXPECT_FALSE(store.remove("k1"));
+	EXPECT_TRUE(store.get("k1") == nullptr);
+}
+
+TEST(jwtpp, key_store_concurrent) {
+	jwtpp::key_store store(8);
+
+	jwtpp::claims cl;
+	std::vector<std::string> tokens;
+
+	for (int i = 0; i < 32; ++i) {
+		auto kid = "k" + std::to_string(i);
+		auto secret = "s" + std::to_string(i);
+
+		store.add(oct_blob(kid, secret));
+
+		auto h = std::make_shared<jwtpp::hmac>(jwtpp::secure_string(secret.c_str()), jwtpp::alg_t::HS256);
+		tokens.push_back(jwtpp::jws::sign_claims(cl, h));
+	}
+
+	std::atomic<int> failures(0);
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < 500; ++i) {
+				auto n = (i * 7 + t) % 32;
+				auto c = store.get("k" + std::to_string(n));
+				auto jws = jwtpp::jws::parse("Bearer " + tokens[n]);
+				if (!c || !jws->verify(c)) {
+					failures++;
+				}
+			}
+		});
+	}
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	EXPECT_EQ(0, failures.load());
+
+	auto st = store.stats();
+	EXPECT_EQ(2000, st.hits + st.misses);
+	EXPECT_LE(st.materialized, 16);
+}
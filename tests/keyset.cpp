@@ -0,0 +1,232 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <openssl/x509.h>
+
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/keyset.hh>
+
+TEST(jwtpp, keyset_add_find) {
+	jwtpp::keyset ks;
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	EXPECT_THROW(ks.add(h), std::exception);
+	EXPECT_THROW(ks.add("k1", nullptr), std::exception);
+
+	h->kid("k1");
+	EXPECT_NO_THROW(ks.add(h));
+	EXPECT_NO_THROW(ks.add("k2", std::make_shared<jwtpp::hmac>("secret2", jwtpp::alg_t::HS384)));
+
+	EXPECT_EQ(2, ks.size());
+	EXPECT_EQ(h, ks.find("k1"));
+	EXPECT_TRUE(ks.find("k2") != nullptr);
+	EXPECT_TRUE(ks.find("k3") == nullptr);
+}
+
+TEST(jwtpp, keyset_kid_in_header) {
+	jwtpp::claims cl;
+	cl.set().iss("troian");
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	h->kid("k1");
+
+	jwtpp::keyset ks;
+	ks.add(h);
+
+	jwtpp::keyset_holder holder(std::move(ks));
+
+	jwtpp::sp_jws jws;
+
+	EXPECT_NO_THROW(jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, h)));
+	EXPECT_EQ("k1", jws->kid());
+
+	auto c = holder.find(jws->kid());
+	ASSERT_TRUE(c != nullptr);
+	EXPECT_TRUE(jws->verify(c));
+}
+
+TEST(jwtpp, keyset_holder_rotate) {
+	jwtpp::claims cl;
+
+	auto h1 = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	auto h2 = std::make_shared<jwtpp::hmac>("secret2", jwtpp::alg_t::HS256);
+
+	jwtpp::keyset_holder holder;
+
+	EXPECT_TRUE(holder.find("k") == nullptr);
+
+	jwtpp::keyset ks1;
+	ks1.add("k", h1);
+	holder.publish(ks1);
+
+	{
+		auto s = holder.read();
+		EXPECT_EQ(h1, s->find("k"));
+
+		jwtpp::keyset ks2;
+		ks2.add("k", h2);
+		holder.publish(ks2);
+
+		// pinned snapshot stays intact across rotation
+		EXPECT_EQ(h1, s->find("k"));
+	}
+
+	EXPECT_EQ(h2, holder.find("k"));
+}
+
+TEST(jwtpp, keyset_holder_concurrent_rotate) {
+	jwtpp::claims cl;
+	cl.set().iss("troian");
+
+	std::vector<jwtpp::sp_crypto> keys;
+	std::vector<std::string> tokens;
+
+	for (int i = 0; i < 4; ++i) {
+		keys.push_back(std::make_shared<jwtpp::hmac>(jwtpp::secure_string("secret") + std::to_string(i).c_str(), jwtpp::alg_t::HS256));
+		keys.back()->kid("k" + std::to_string(i));
+		tokens.push_back(jwtpp::jws::sign_bearer(cl, keys.back()));
+	}
+
+	jwtpp::keyset_holder holder;
+
+	std::atomic<bool> stop(false);
+	std::atomic<int>  failures(0);
+
+	std::vector<std::thread> readers;
+
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&, t]() {
+			while (!stop.load()) {
+				auto jws = jwtpp::jws::parse(tokens[t]);
+				auto s = holder.read();
+				auto c = s->find(jws->kid());
+				// either key is absent or it must verify
+				if (c && !jws->verify(c)) {
+					failures++;
+				}
+			}
+		});
+	}
+
+	for (int i = 0; i < 200; ++i) {
+		jwtpp::keyset ks;
+		for (size_t k = 0; k < keys.size(); ++k) {
+			if ((i + k) % 2) {
+				ks.add(keys[k]);
+			}
+		}
+		holder.publish(ks);
+	}
+
+	stop = true;
+
+	for (auto &r : readers) {
+		r.join();
+	}
+
+	EXPECT_EQ(0, failures.load());
+}
+
+TEST(jwtpp, keyset_bulk_load) {
+	jwtpp::claims cl;
+
+	std::vector<jwtpp::key_blob> blobs;
+	std::vector<jwtpp::sp_crypto> signers;
+
+	for (int i = 0; i < 40; ++i) {
+		auto key = jwtpp::rsa::gen(1024);
+
+		uint8_t *buf = nullptr;
+		int len = i2d_RSA_PUBKEY(key.get(), &buf);
+
+		jwtpp::key_blob b;
+		b.kid  = "k" + std::to_string(i);
+		b.fmt  = jwtpp::key_blob::format::DER_PUBLIC;
+		b.alg  = jwtpp::alg_t::RS256;
+		b.data = std::string(reinterpret_cast<char *>(buf), static_cast<size_t>(len));
+		OPENSSL_free(buf);
+
+		blobs.push_back(b);
+		signers.push_back(std::make_shared<jwtpp::rsa>(key, jwtpp::alg_t::RS256));
+	}
+
+	jwtpp::key_blob broken;
+	broken.kid  = "broken";
+	broken.fmt  = jwtpp::key_blob::format::DER_PUBLIC;
+	broken.alg  = jwtpp::alg_t::RS256;
+	broken.data = "garbage";
+	blobs.push_back(broken);
+
+	std::vector<jwtpp::key_error> errors;
+	jwtpp::keyset ks;
+
+	EXPECT_NO_THROW(ks = jwtpp::keyset::load(blobs, errors, 4));
+
+	EXPECT_EQ(40, ks.size());
+	ASSERT_EQ(1, errors.size());
+	EXPECT_EQ(40, errors[0].index);
+	EXPECT_EQ("broken", errors[0].kid);
+	EXPECT_FALSE(errors[0].what.empty());
+
+	for (size_t i = 0; i < signers.size(); ++i) {
+		auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, signers[i]));
+		auto c = ks.find("k" + std::to_string(i));
+		ASSERT_TRUE(c != nullptr);
+		EXPECT_TRUE(jws->verify(c));
+	}
+
+	EXPECT_NO_THROW(ks = jwtpp::keyset::load(std::vector<jwtpp::key_blob>(), errors));
+	EXPECT_TRUE(ks.empty());
+	EXPECT_TRUE(errors.empty());
+}
+
+TEST(jwtpp, keyset_find_by_thumbprint) {
+	auto k1 = std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), jwtpp::alg_t::ES256);
+	auto k2 = std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), jwtpp::alg_t::ES256);
+	auto h  = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+
+	jwtpp::keyset ks;
+	ks.add("k1", k1);
+	ks.add("k2", k2);
+	ks.add("h", h);
+
+	EXPECT_EQ(k1, ks.find_by_thumbprint(k1->thumbprint()));
+	EXPECT_EQ(k2, ks.find_by_thumbprint(k2->thumbprint()));
+	EXPECT_TRUE(ks.find_by_thumbprint("unknown") == nullptr);
+
+	// symmetric keys are not indexed by hash of the secret
+	EXPECT_EQ(h, ks.find("h"));
+	EXPECT_TRUE(ks.find_by_thumbprint(h->thumbprint()) == nullptr);
+
+	auto k3 = std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), jwtpp::alg_t::ES256);
+	ks.add("k1", k3);
+
+	EXPECT_TRUE(ks.find_by_thumbprint(k1->thumbprint()) == nullptr);
+	EXPECT_EQ(k3, ks.find_by_thumbprint(k3->thumbprint()));
+}
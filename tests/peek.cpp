@@ -0,0 +1,112 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <jwtpp/jwtpp.hh>
+
+namespace {
+
+std::string make_token(const std::string &hdr, const std::string &payload) {
+	return jwtpp::b64::encode_uri(hdr) + "." + jwtpp::b64::encode_uri(payload) + ".c2ln";
+}
+
+} // namespace
+
+TEST(jwtpp, peek_signed_token) {
+	jwtpp::claims cl;
+	cl.set().iss("https://issuer.example");
+	cl.set().sub("alice");
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	h->kid("key-1");
+
+	auto bearer = jwtpp::jws::sign_bearer(cl, h);
+
+	jwtpp::unverified_peek p;
+
+	EXPECT_TRUE(p.parse(bearer));
+	EXPECT_EQ("HS256", std::string(p.alg()));
+	EXPECT_EQ("key-1", std::string(p.kid()));
+	EXPECT_EQ("https://issuer.example", std::string(p.claim("iss")));
+	EXPECT_EQ("alice", std::string(p.claim("sub")));
+	EXPECT_TRUE(p.has_claim("iss"));
+	EXPECT_FALSE(p.has_claim("aud"));
+	EXPECT_TRUE(p.claim("aud").empty());
+	EXPECT_EQ(bearer.substr(7), std::string(p.token()));
+
+	auto token = jwtpp::jws::sign_claims(cl, h);
+
+	EXPECT_TRUE(p.parse(token));
+	EXPECT_EQ("key-1", std::string(p.kid()));
+	EXPECT_EQ(token, std::string(p.token()));
+}
+
+TEST(jwtpp, peek_escapes_and_nested) {
+	jwtpp::unverified_peek p;
+
+	auto token = make_token(
+		  "{ \"alg\" : \"RS256\" , \"kid\":\"a\\\"b\\\\c\\/d\" }"
+		, "{\"iss\":\"\\u00e9\\ud83d\\ude00\",\"exp\":1700000000,\"ok\":true,"
+		  "\"nested\":{\"a\":[1,\"}\",{\"b\":null}]},\"list\":[\"x\",\"y\"]}");
+
+	ASSERT_TRUE(p.parse(token));
+	EXPECT_EQ("RS256", std::string(p.alg()));
+	EXPECT_EQ("a\"b\\c/d", std::string(p.kid()));
+	EXPECT_EQ("\xc3\xa9\xf0\x9f\x98\x80", std::string(p.claim("iss")));
+	EXPECT_EQ("1700000000", std::string(p.claim("exp")));
+	EXPECT_EQ("true", std::string(p.claim("ok")));
+	EXPECT_EQ("{\"a\":[1,\"}\",{\"b\":null}]}", std::string(p.claim("nested")));
+	EXPECT_EQ("[\"x\",\"y\"]", std::string(p.claim("list")));
+
+	EXPECT_TRUE(p.parse(make_token("{}", "{}")));
+	EXPECT_TRUE(p.alg().empty());
+}
+
+TEST(jwtpp, peek_malformed) {
+	jwtpp::unverified_peek p;
+
+	EXPECT_FALSE(p.parse(""));
+	EXPECT_FALSE(p.parse("Bearer "));
+	EXPECT_FALSE(p.parse("abc"));
+	EXPECT_FALSE(p.parse("abc.def"));
+	EXPECT_FALSE(p.parse("a.b.c.d"));
+	EXPECT_FALSE(p.parse("!!!.e30.c2ln"));
+	EXPECT_FALSE(p.parse(make_token("[]", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{\"alg\":\"HS256\"", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{\"alg\" \"HS256\"}", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{\"alg\":\"HS256\",}", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{\"alg\":\"\\x\"}", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{\"alg\":\"\\ud83d\"}", "{}")));
+	EXPECT_FALSE(p.parse(make_token("{}", "{\"a\":{\"b\":1}")));
+	EXPECT_FALSE(p.parse(make_token("{}", "{} x")));
+
+	std::string many = "{";
+	for (size_t i = 0; i <= jwtpp::unverified_peek::max_members; i++) {
+		many += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":1";
+	}
+	many += "}";
+
+	EXPECT_FALSE(p.parse(make_token("{}", many)));
+	EXPECT_FALSE(p.parse(make_token("{}", "{\"a\":\"" + std::string(jwtpp::unverified_peek::buffer_size, 'x') + "\"}")));
+	EXPECT_TRUE(p.claim("a").empty());
+}
@@ -0,0 +1,134 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <vector>
+
+#include <jwtpp/pipeline.hh>
+#include <jwtpp/keyset.hh>
+
+TEST(jwtpp, pipeline_statuses_in_order) {
+	using status = jwtpp::pipeline::status;
+
+	auto h1 = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	auto h2 = std::make_shared<jwtpp::hmac>("secret2", jwtpp::alg_t::HS512);
+	auto r1 = std::make_shared<jwtpp::rsa>(jwtpp::rsa::gen(1024), jwtpp::alg_t::RS256);
+	h1->kid("h1");
+	h2->kid("h2");
+	r1->kid("r1");
+
+	jwtpp::keyset ks;
+	ks.add(h1);
+	ks.add(h2);
+	ks.add(r1);
+
+	jwtpp::keyset_holder holder(std::move(ks));
+
+	std::vector<std::pair<uint64_t, status>> results;
+	std::mutex lock;
+
+	jwtpp::pipeline::options opts;
+	opts.queue_size = 4;
+	opts.batch_size = 3;
+
+	jwtpp::pipeline p(
+		[&holder](const jwtpp::jws &j) { return holder.find(j.kid()); },
+		[&](uint64_t tag, status s, jwtpp::sp_claims cl) {
+			EXPECT_EQ(s == status::OK, cl != nullptr);
+			std::lock_guard<std::mutex> l(lock);
+			results.emplace_back(tag, s);
+		},
+		[](jwtpp::sp_claims cl) { return !cl->check().sub("mallory"); },
+		opts);
+
+	jwtpp::claims cl;
+	cl.set().sub("alice");
+
+	jwtpp::claims bad;
+	bad.set().sub("mallory");
+
+	auto forged = std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256);
+	forged->kid("h1");
+
+	auto wrong_alg = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS384);
+	wrong_alg->kid("h1");
+
+	auto unknown = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	unknown->kid("nope");
+
+	std::vector<status> expected;
+
+	for (uint64_t i = 0; i < 60; i++) {
+		switch (i % 8) {
+		case 0: p.submit(i, jwtpp::jws::sign_bearer(cl, h1)); expected.push_back(status::OK); break;
+		case 1: p.submit(i, jwtpp::jws::sign_bearer(cl, r1)); expected.push_back(status::OK); break;
+		case 2: p.submit(i, jwtpp::jws::sign_bearer(cl, h2)); expected.push_back(status::OK); break;
+		case 3: p.submit(i, "Bearer garbage"); expected.push_back(status::MALFORMED); break;
+		case 4: p.submit(i, jwtpp::jws::sign_bearer(cl, unknown)); expected.push_back(status::UNKNOWN_KEY); break;
+		case 5: p.submit(i, jwtpp::jws::sign_bearer(cl, wrong_alg)); expected.push_back(status::ALG_MISMATCH); break;
+		case 6: p.submit(i, jwtpp::jws::sign_bearer(cl, forged)); expected.push_back(status::BAD_SIGNATURE); break;
+		case 7: p.submit(i, jwtpp::jws::sign_bearer(bad, h1)); expected.push_back(status::POLICY); break;
+		}
+	}
+
+	p.close();
+	EXPECT_THROW(p.submit(100, "x"), std::logic_error);
+
+	ASSERT_EQ(expected.size(), results.size());
+
+	for (size_t i = 0; i < results.size(); i++) {
+		EXPECT_EQ(i, results[i].first);
+		EXPECT_EQ(expected[i], results[i].second) << i;
+	}
+
+	EXPECT_STREQ("bad signature", jwtpp::pipeline::status2str(status::BAD_SIGNATURE));
+}
+
+TEST(jwtpp, pipeline_try_submit) {
+	size_t done = 0;
+
+	auto h = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	jwtpp::claims cl;
+	auto token = jwtpp::jws::sign_bearer(cl, h);
+
+	{
+		jwtpp::pipeline p(
+			[&h](const jwtpp::jws &) { return h; },
+			[&done](uint64_t, jwtpp::pipeline::status s, jwtpp::sp_claims) {
+				EXPECT_EQ(jwtpp::pipeline::status::OK, s);
+				++done;
+			});
+
+		for (uint64_t i = 0; i < 1000; i++) {
+			std::string b = token;
+
+			while (!p.try_submit(i, b)) {
+				EXPECT_EQ(token, b);
+			}
+		}
+	}
+
+	EXPECT_EQ(1000, done);
+}
@@ -25,6 +25,7 @@
 #include <jwtpp/jwtpp.hh>
 
 #include <openssl/err.h>
+#include <openssl/x509.h>
 
 TEST(jwtpp, rsa_gen_invalid_size) {
 	jwtpp::sp_rsa_key key;
@@ -195,3 +196,66 @@ TEST(jwtpp, load_rsa_from_file) {
 
 	EXPECT_THROW(key = jwtpp::rsa::load_from_file(TEST_RSA_KEY_PATH), std::exception);
 }
+
+TEST(jwtpp, rsa_load_der_raw) {
+	jwtpp::claims cl;
+	cl.set().iss("troian");
+
+	jwtpp::sp_rsa_key key;
+	EXPECT_NO_THROW(key = jwtpp::rsa::gen(2048));
+
+	auto der = [&key](int (*enc)(const RSA *, uint8_t **)) {
+		uint8_t *buf = nullptr;
+		int len = enc(key.get(), &buf);
+		std::vector<uint8_t> out(buf, buf + len);
+		OPENSSL_free(buf);
+		return out;
+	};
+
+	auto pkcs1_priv = der(i2d_RSAPrivateKey);
+	auto pkcs1_pub  = der(i2d_RSAPublicKey);
+	auto spki       = der(i2d_RSA_PUBKEY);
+
+	auto pkey = jwtpp::sp_evp_key(EVP_PKEY_new(), ::EVP_PKEY_free);
+	EVP_PKEY_set1_RSA(pkey.get(), key.get());
+
+	auto p8 = std::shared_ptr<PKCS8_PRIV_KEY_INFO>(EVP_PKEY2PKCS8(pkey.get()), ::PKCS8_PRIV_KEY_INFO_free);
+	uint8_t *p8_buf = nullptr;
+	int p8_len = i2d_PKCS8_PRIV_KEY_INFO(p8.get(), &p8_buf);
+	std::vector<uint8_t> pkcs8(p8_buf, p8_buf + p8_len);
+	OPENSSL_free(p8_buf);
+
+	jwtpp::sp_rsa_key k;
+
+	std::string bearer = jwtpp::jws::sign_bearer(cl, std::make_shared<jwtpp::rsa>(key, jwtpp::alg_t::RS256));
+	auto jws = jwtpp::jws::parse(bearer);
+
+	EXPECT_NO_THROW(k = jwtpp::rsa::load_private_der(pkcs1_priv.data(), pkcs1_priv.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::rsa>(k, jwtpp::alg_t::RS256)));
+
+	EXPECT_NO_THROW(k = jwtpp::rsa::load_private_der(pkcs8.data(), pkcs8.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::rsa>(k, jwtpp::alg_t::RS256)));
+
+	EXPECT_NO_THROW(k = jwtpp::rsa::load_public_der(pkcs1_pub.data(), pkcs1_pub.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::rsa>(k, jwtpp::alg_t::RS256)));
+
+	EXPECT_NO_THROW(k = jwtpp::rsa::load_public_der(spki.data(), spki.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::rsa>(k, jwtpp::alg_t::RS256)));
+
+	const BIGNUM *n;
+	const BIGNUM *e;
+	RSA_get0_key(key.get(), &n, &e, nullptr);
+
+	std::vector<uint8_t> n_raw(static_cast<size_t>(BN_num_bytes(n)));
+	std::vector<uint8_t> e_raw(static_cast<size_t>(BN_num_bytes(e)));
+	BN_bn2bin(n, n_raw.data());
+	BN_bn2bin(e, e_raw.data());
+
+	EXPECT_NO_THROW(k = jwtpp::rsa::load_raw(n_raw.data(), n_raw.size(), e_raw.data(), e_raw.size()));
+	EXPECT_TRUE(jws->verify(std::make_shared<jwtpp::rsa>(k, jwtpp::alg_t::RS256)));
+
+	EXPECT_THROW(jwtpp::rsa::load_private_der(spki.data(), spki.size()), std::exception);
+	EXPECT_THROW(jwtpp::rsa::load_public_der(pkcs1_priv.data(), pkcs1_priv.size()), std::exception);
+	EXPECT_THROW(jwtpp::rsa::load_public_der(spki.data(), 10), std::exception);
+	EXPECT_THROW(jwtpp::rsa::load_raw(nullptr, 0, e_raw.data(), e_raw.size()), std::exception);
+}
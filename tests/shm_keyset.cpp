@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <openssl/x509.h>
+
+#include <jwtpp/shm_keyset.hh>
+
+namespace {
+
+jwtpp::key_blob rsa_blob(const std::string &kid, jwtpp::sp_rsa_key key) {
+	uint8_t *buf = nullptr;
+	int len = i2d_RSA_PUBKEY(key.get(), &buf);
+
+	jwtpp::key_blob b;
+	b.kid  = kid;
+	b.fmt  = jwtpp::key_blob::format::DER_PUBLIC;
+	b.alg  = jwtpp::alg_t::RS256;
+	b.data = std::string(reinterpret_cast<char *>(buf), static_cast<size_t>(len));
+	OPENSSL_free(buf);
+
+	return b;
+}
+
+jwtpp::key_blob jwk_blob(const std::string &kid, const std::string &secret) {
+	jwtpp::key_blob b;
+	b.kid  = kid;
+	b.fmt  = jwtpp::key_blob::format::JWK;
+	b.alg  = jwtpp::alg_t::HS256;
+	b.data = R"({"kty":"oct","k":")" + jwtpp::b64::encode_uri(secret) + R"("})";
+
+	return b;
+}
+
+std::string shm_name() {
+	return "/jwtpp-test-keys-" + std::to_string(getpid());
+}
+
+} // namespace
+
+TEST(jwtpp, shm_keyset_publish_find) {
+	auto name = shm_name();
+	jwtpp::shm_keyset::unlink(name);
+
+	EXPECT_THROW(jwtpp::shm_keyset ks(name), std::runtime_error);
+
+	auto key = jwtpp::rsa::gen(1024);
+
+	jwtpp::key_blob broken;
+	broken.kid  = "broken";
+	broken.fmt  = jwtpp::key_blob::format::DER_PUBLIC;
+	broken.alg  = jwtpp::alg_t::RS256;
+	broken.data = "garbage";
+
+	std::vector<jwtpp::key_error> errors;
+	auto gen = jwtpp::shm_keyset::publish(name, {rsa_blob("r1", key), jwk_blob("h1", "secret"), broken}, errors);
+
+	EXPECT_EQ(1, gen);
+	ASSERT_EQ(1, errors.size());
+	EXPECT_EQ("broken", errors[0].kid);
+
+	jwtpp::shm_keyset ks(name);
+
+	EXPECT_EQ(1, ks.generation());
+	EXPECT_EQ(2, ks.size());
+	EXPECT_EQ(nullptr, ks.find("broken"));
+	EXPECT_EQ(nullptr, ks.find("r2"));
+
+	auto r1 = ks.find("r1");
+	ASSERT_NE(nullptr, r1);
+	EXPECT_EQ("r1", r1->kid());
+
+	// loaded once, later lookups return the same crypto
+	EXPECT_EQ(r1, ks.find("r1"));
+
+	jwtpp::claims cl;
+	cl.set().sub("alice");
+
+	auto signer = std::make_shared<jwtpp::rsa>(key, jwtpp::alg_t::RS256);
+	auto jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, signer));
+	ASSERT_NE(nullptr, jws);
+	EXPECT_TRUE(jws->verify(r1));
+
+	auto h1 = ks.find("h1");
+	ASSERT_NE(nullptr, h1);
+	jws = jwtpp::jws::parse(jwtpp::jws::sign_bearer(cl, std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256)));
+	ASSERT_NE(nullptr, jws);
+	EXPECT_TRUE(jws->verify(h1));
+
+	jwtpp::shm_keyset::unlink(name);
+}
+
+TEST(jwtpp, shm_keyset_rotation) {
+	auto name = shm_name();
+	jwtpp::shm_keyset::unlink(name);
+
+	std::vector<jwtpp::key_error> errors;
+
+	// empty generation
+	jwtpp::shm_keyset::publish(name, {}, errors);
+	jwtpp::shm_keyset ks(name);
+	EXPECT_EQ(0, ks.size());
+	EXPECT_EQ(nullptr, ks.find("k1"));
+
+	jwtpp::shm_keyset::publish(name, {jwk_blob("k1", "secret1")}, errors);
+
+	auto k1 = ks.find("k1");
+	ASSERT_NE(nullptr, k1);
+	EXPECT_EQ(2, ks.generation());
+
+	// key published by other process shows up on next lookup
+	pid_t pid = fork();
+	ASSERT_NE(-1, pid);
+
+	if (pid == 0) {
+		std::vector<jwtpp::key_error> e;
+		auto gen = jwtpp::shm_keyset::publish(name, {jwk_blob("k2", "secret2"), jwk_blob("k3", "secret3")}, e);
+		_exit(gen == 3 ? 0 : 1);
+	}
+
+	int status = 0;
+	ASSERT_EQ(pid, waitpid(pid, &status, 0));
+	ASSERT_TRUE(WIFEXITED(status));
+	ASSERT_EQ(0, WEXITSTATUS(status));
+
+	EXPECT_EQ(nullptr, ks.find("k1"));
+	EXPECT_NE(nullptr, ks.find("k2"));
+	EXPECT_EQ(3, ks.generation());
+	EXPECT_EQ(2, ks.size());
+	EXPECT_FALSE(ks.refresh());
+
+	// crypto taken from old generation stays usable
+	EXPECT_EQ("k1", k1->kid());
+
+	jwtpp::shm_keyset::unlink(name);
+}
+
+TEST(jwtpp, shm_keyset_concurrent) {
+	auto name = shm_name();
+	jwtpp::shm_keyset::unlink(name);
+
+	std::vector<jwtpp::key_error> errors;
+	jwtpp::shm_keyset::publish(name, {jwk_blob("a", "s1"), jwk_blob("b", "s2")}, errors);
+
+	jwtpp::shm_keyset ks(name);
+
+	std::atomic<bool> stop(false);
+	std::atomic<int>  missing(0);
+
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&]() {
+			while (!stop.load()) {
+				if (ks.find("a") == nullptr) {
+					missing++;
+				}
+			}
+		});
+	}
+
+	for (int i = 0; i < 50; i++) {
+		jwtpp::shm_keyset::publish(name, {jwk_blob("a", "s" + std::to_string(i)), jwk_blob("b", "s2")}, errors);
+	}
+
+	stop = true;
+	for (auto &t : readers) {
+		t.join();
+	}
+
+	EXPECT_EQ(0, missing.load());
+	ks.refresh();
+	EXPECT_EQ(51, ks.generation());
+
+	jwtpp::shm_keyset::unlink(name);
+}
+
+#endif // defined(__linux__)
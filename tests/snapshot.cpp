@@ -0,0 +1,230 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+#include <jwtpp/snapshot.hh>
+
+namespace {
+
+std::string snapshot_path() {
+	return "/tmp/jwtpp-test-snapshot-" + std::to_string(getpid());
+}
+
+std::string mint(jwtpp::sp_crypto c, const std::string &sub, std::time_t exp) {
+	jwtpp::claims cl;
+	cl.set().sub(sub);
+	cl.set().exp(std::to_string(exp));
+
+	return jwtpp::jws::sign_claims(cl, c);
+}
+
+} // namespace
+
+TEST(jwtpp, snapshot_round_trip) {
+	auto path = snapshot_path();
+
+	auto k1 = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	k1->kid("k1");
+
+	jwtpp::keyset ks;
+	ks.add(k1);
+
+	auto now = std::time(nullptr);
+
+	jwtpp::shm_token_cache cache(64);
+
+	auto alice = mint(k1, "alice", now + 100);
+	auto bob   = mint(k1, "bob", now + 50);
+
+	auto jws = jwtpp::jws::parse("Bearer " + alice);
+	ASSERT_TRUE(cache.insert(alice, jws->claims()));
+	ASSERT_TRUE(cache.insert(bob, now + 50, "{}", 2));
+
+	ASSERT_NO_THROW(jwtpp::warm_snapshot::save(path, cache, ks));
+
+	// restart: fresh cache, same keys
+	jwtpp::shm_token_cache restored(64);
+
+	auto r = jwtpp::warm_snapshot::load(path, restored, ks);
+	EXPECT_EQ(1, r.keys);
+	EXPECT_EQ(0, r.stale_keys);
+	EXPECT_EQ(0, r.dropped);
+	EXPECT_EQ(2, r.tokens);
+
+	auto hit = restored.find(alice);
+	ASSERT_NE(nullptr, hit);
+	EXPECT_EQ("alice", hit->get().sub());
+
+	// entries expired while process was down are not restored
+	jwtpp::shm_token_cache later(64);
+
+	r = jwtpp::warm_snapshot::load(path, later, ks, static_cast<uint64_t>(now + 60));
+	EXPECT_EQ(1, r.tokens);
+	EXPECT_EQ(1, r.expired);
+	EXPECT_EQ(nullptr, later.find(bob));
+	EXPECT_NE(nullptr, later.find(alice));
+
+	std::remove(path.c_str());
+}
+
+TEST(jwtpp, snapshot_key_changed) {
+	auto path = snapshot_path();
+
+	auto k1 = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	k1->kid("k1");
+
+	jwtpp::keyset ks;
+	ks.add(k1);
+
+	jwtpp::shm_token_cache cache(16);
+	ASSERT_TRUE(cache.insert(mint(k1, "alice", std::time(nullptr) + 100), std::time(nullptr) + 100, "{}", 2));
+
+	jwtpp::warm_snapshot::save(path, cache, ks);
+
+	// same kid now names different key material: cached verdicts are void
+	auto k1_rotated = std::make_shared<jwtpp::hmac>("secret2", jwtpp::alg_t::HS256);
+	k1_rotated->kid("k1");
+
+	jwtpp::keyset rotated;
+	rotated.add(k1_rotated);
+
+	jwtpp::shm_token_cache restored(16);
+
+	auto r = jwtpp::warm_snapshot::load(path, restored, rotated);
+	EXPECT_EQ(0, r.keys);
+	EXPECT_EQ(1, r.stale_keys);
+	EXPECT_EQ(0, r.tokens);
+	EXPECT_EQ(1, r.dropped);
+
+	// key removed
+	r = jwtpp::warm_snapshot::load(path, restored, jwtpp::keyset());
+	EXPECT_EQ(1, r.stale_keys);
+	EXPECT_EQ(0, r.tokens);
+
+	// smaller cache drops what does not fit
+	jwtpp::shm_token_cache tiny(16, 0);
+	r = jwtpp::warm_snapshot::load(path, tiny, ks);
+	EXPECT_EQ(0, r.tokens);
+	EXPECT_EQ(1, r.dropped);
+
+	std::remove(path.c_str());
+}
+
+TEST(jwtpp, snapshot_invalid) {
+	auto path = snapshot_path();
+
+	jwtpp::shm_token_cache cache(16);
+	jwtpp::keyset ks;
+
+	std::remove(path.c_str());
+	EXPECT_THROW(jwtpp::warm_snapshot::load(path, cache, ks), std::runtime_error);
+
+	{
+		std::ofstream f(path);
+		f << "not a snapshot";
+	}
+
+	EXPECT_THROW(jwtpp::warm_snapshot::load(path, cache, ks), std::runtime_error);
+
+	// no recorded key vouches for entries
+	ASSERT_TRUE(cache.insert("a.b.c", std::time(nullptr) + 100, "{}", 2));
+	jwtpp::warm_snapshot::save(path, cache, ks);
+
+	jwtpp::shm_token_cache restored(16);
+
+	auto r = jwtpp::warm_snapshot::load(path, restored, ks);
+	EXPECT_EQ(0, r.tokens);
+	EXPECT_EQ(1, r.dropped);
+
+	// truncated file
+	ASSERT_EQ(0, truncate(path.c_str(), 16));
+	EXPECT_THROW(jwtpp::warm_snapshot::load(path, cache, ks), std::runtime_error);
+
+	std::remove(path.c_str());
+}
+
+TEST(jwtpp, snapshot_shm_keyset) {
+	auto path = snapshot_path();
+	auto name = "/jwtpp-test-snapshot-keys-" + std::to_string(getpid());
+
+	jwtpp::shm_keyset::unlink(name);
+
+	std::vector<jwtpp::key_blob> blobs;
+	for (int i = 0; i < 3; i++) {
+		jwtpp::key_blob b;
+		b.kid  = "k" + std::to_string(i);
+		b.fmt  = jwtpp::key_blob::format::JWK;
+		b.alg  = jwtpp::alg_t::HS256;
+		b.data = R"({"kty":"oct","k":")" + jwtpp::b64::encode_uri("secret" + std::to_string(i)) + R"("})";
+		blobs.push_back(b);
+	}
+
+	std::vector<jwtpp::key_error> errors;
+	jwtpp::shm_keyset::publish(name, blobs, errors);
+
+	jwtpp::shm_token_cache cache(16);
+	ASSERT_TRUE(cache.insert("a.b.c", std::time(nullptr) + 100, "{}", 2));
+
+	{
+		jwtpp::shm_keyset ks(name);
+		ASSERT_NE(nullptr, ks.find("k1"));
+		EXPECT_EQ(1, ks.loaded().size());
+
+		jwtpp::warm_snapshot::save(path, cache, ks);
+	}
+
+	// restarted worker has keys loaded before first request
+	jwtpp::shm_keyset ks(name);
+	EXPECT_TRUE(ks.loaded().empty());
+
+	jwtpp::shm_token_cache restored(16);
+
+	auto r = jwtpp::warm_snapshot::load(path, restored, ks);
+	EXPECT_EQ(3, r.keys);
+	EXPECT_EQ(1, r.tokens);
+	EXPECT_EQ(3, ks.loaded().size());
+
+	// entries may come from other workers using k2, revoking it voids them all
+	blobs.erase(blobs.begin() + 2);
+	jwtpp::shm_keyset::publish(name, blobs, errors);
+
+	jwtpp::shm_token_cache revoked(16);
+
+	r = jwtpp::warm_snapshot::load(path, revoked, ks);
+	EXPECT_EQ(1, r.stale_keys);
+	EXPECT_EQ(0, r.tokens);
+	EXPECT_EQ(1, r.dropped);
+
+	jwtpp::shm_keyset::unlink(name);
+	std::remove(path.c_str());
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,155 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <jwtpp/stats.hh>
+
+using stage = jwtpp::stats::stage;
+using result = jwtpp::stats::result;
+
+TEST(jwtpp, stats_histogram_buckets) {
+	using h = jwtpp::stats::histogram;
+
+	for (uint64_t v = 0; v < h::sub_buckets; v++) {
+		EXPECT_EQ(v, h::bucket(v));
+		EXPECT_EQ(v, h::bucket_upper(h::bucket(v)));
+	}
+
+	// buckets are contiguous: value right above previous bucket starts next one
+	for (size_t b = h::sub_buckets; b < h::buckets; b++) {
+		EXPECT_LT(h::bucket_upper(b - 1), h::bucket_upper(b));
+		EXPECT_EQ(b, h::bucket(h::bucket_upper(b)));
+		EXPECT_EQ(b, h::bucket(h::bucket_upper(b - 1) + 1));
+	}
+
+	EXPECT_EQ(h::buckets - 1, h::bucket(UINT64_MAX));
+
+	// relative error within bucket
+	for (uint64_t v : {100ull, 1000ull, 123456ull, 987654321ull}) {
+		auto up = h::bucket_upper(h::bucket(v));
+		EXPECT_GE(up, v);
+		EXPECT_LE(static_cast<double>(up - v) / static_cast<double>(v), 1.0 / h::sub_buckets);
+	}
+}
+
+TEST(jwtpp, stats_histogram_percentile) {
+	jwtpp::stats::histogram h;
+
+	EXPECT_EQ(0, h.count());
+	EXPECT_EQ(0, h.percentile(50));
+
+	for (uint64_t v = 1; v <= 1000; v++) {
+		h.record(v * 1000);
+	}
+
+	EXPECT_EQ(1000, h.count());
+	EXPECT_EQ(1000, h.min());
+	EXPECT_EQ(1000000, h.max());
+	EXPECT_DOUBLE_EQ(500500.0, h.mean());
+
+	EXPECT_NEAR(500000.0, static_cast<double>(h.percentile(50)), 500000.0 / 32);
+	EXPECT_NEAR(990000.0, static_cast<double>(h.percentile(99)), 990000.0 / 32);
+	EXPECT_EQ(1000000, h.percentile(100));
+	EXPECT_EQ(1000, h.percentile(0));
+
+	jwtpp::stats::histogram m;
+	m.record(5);
+	m.merge(h);
+
+	EXPECT_EQ(1001, m.count());
+	EXPECT_EQ(5, m.min());
+	EXPECT_EQ(5, m.percentile(0));
+	EXPECT_FALSE(m.buckets_view().empty());
+}
+
+TEST(jwtpp, stats_collect) {
+	auto before = jwtpp::stats::collect();
+
+	auto ok = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+	auto other = std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256);
+	auto hs384 = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS384);
+
+	jwtpp::claims cl;
+	cl.set().sub("alice");
+
+	std::string bearer;
+
+	// other thread records into own block, must be visible after it exits
+	std::thread([&]() {
+		bearer = jwtpp::jws::sign_bearer(cl, ok);
+	}).join();
+
+	EXPECT_TRUE(jwtpp::jws::parse(bearer)->verify(ok));
+	EXPECT_FALSE(jwtpp::jws::parse(bearer)->verify(other));
+	EXPECT_THROW(jwtpp::jws::parse(bearer)->verify(hs384), std::exception);
+	EXPECT_FALSE(jwtpp::jws::parse(bearer)->verify(ok, [](jwtpp::sp_claims) { return false; }));
+	EXPECT_THROW(jwtpp::jws::parse("Bearer a.b"), std::exception);
+	EXPECT_THROW(jwtpp::jws::parse("Bearer " + jwtpp::b64::encode_uri("{\"typ\":\"JWT\"}") + ".e30.sig"), std::exception);
+
+	auto after = jwtpp::stats::collect();
+
+	auto delta = [&](stage s, jwtpp::alg_t a, result r) {
+		return after.count(s, a, r) - before.count(s, a, r);
+	};
+
+	if (!jwtpp::stats::enabled()) {
+		EXPECT_EQ(0, after.count(stage::PARSE, result::OK));
+		EXPECT_EQ(0, after.latency(stage::VERIFY).count());
+		return;
+	}
+
+	EXPECT_EQ(1, delta(stage::SIGN, jwtpp::alg_t::HS256, result::OK));
+	EXPECT_EQ(4, delta(stage::PARSE, jwtpp::alg_t::HS256, result::OK));
+	EXPECT_EQ(1, delta(stage::PARSE, jwtpp::alg_t::UNKNOWN, result::MALFORMED));
+	EXPECT_EQ(1, delta(stage::PARSE, jwtpp::alg_t::UNKNOWN, result::BAD_HEADER));
+	EXPECT_EQ(1, delta(stage::VERIFY, jwtpp::alg_t::HS256, result::OK));
+	EXPECT_EQ(1, delta(stage::VERIFY, jwtpp::alg_t::HS256, result::BAD_SIGNATURE));
+	EXPECT_EQ(1, delta(stage::VERIFY, jwtpp::alg_t::HS256, result::ALG_MISMATCH));
+	EXPECT_EQ(1, delta(stage::VERIFY, jwtpp::alg_t::HS256, result::REJECTED));
+
+	auto lat = [&](stage s) {
+		return after.latency(s, jwtpp::alg_t::HS256).count() - before.latency(s, jwtpp::alg_t::HS256).count();
+	};
+
+	EXPECT_EQ(1, lat(stage::SIGN));
+	EXPECT_EQ(1, lat(stage::CRYPTO_SIGN));
+	EXPECT_EQ(4, lat(stage::PARSE));
+	EXPECT_EQ(4, lat(stage::DECODE));
+	EXPECT_EQ(4, lat(stage::VERIFY));
+	EXPECT_EQ(3, lat(stage::CRYPTO_VERIFY));
+	EXPECT_EQ(1, lat(stage::POLICY));
+
+	EXPECT_GT(after.latency(stage::VERIFY, jwtpp::alg_t::HS256).percentile(50), 0);
+	EXPECT_STREQ("crypto_verify", jwtpp::stats::stage2str(stage::CRYPTO_VERIFY));
+	EXPECT_STREQ("bad_signature", jwtpp::stats::result2str(result::BAD_SIGNATURE));
+
+	// batch is one SIGN operation
+	std::vector<jwtpp::claims> batch(3);
+	(void)jwtpp::jws::sign_batch(batch, ok);
+
+	auto batched = jwtpp::stats::collect();
+	EXPECT_EQ(1, batched.count(stage::SIGN, jwtpp::alg_t::HS256, result::OK) - after.count(stage::SIGN, jwtpp::alg_t::HS256, result::OK));
+}
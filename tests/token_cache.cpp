@@ -0,0 +1,254 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include <jwtpp/token_cache.hh>
+
+namespace {
+
+std::string mint(const std::string &sub, std::time_t exp) {
+	auto c = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	jwtpp::claims cl;
+	cl.set().iss("jwtpp");
+	cl.set().sub(sub);
+	cl.set().exp(std::to_string(exp));
+
+	return jwtpp::jws::sign_claims(cl, c);
+}
+
+} // namespace
+
+TEST(jwtpp, token_cache_basic) {
+	jwtpp::shm_token_cache cache(100, 64);
+
+	EXPECT_EQ(128, cache.slots());
+	EXPECT_EQ(64, cache.blob_size());
+
+	auto now = static_cast<uint64_t>(std::time(nullptr));
+
+	char   blob[64];
+	size_t size = 0;
+
+	EXPECT_FALSE(cache.find("a.b.c", now, blob, size));
+
+	EXPECT_TRUE(cache.insert("a.b.c", now + 100, "payload", 7));
+	EXPECT_TRUE(cache.find("a.b.c", now, blob, size));
+	EXPECT_EQ(std::string("payload"), std::string(blob, size));
+
+	// "Bearer " prefix is not part of identity
+	EXPECT_TRUE(cache.find("Bearer a.b.c", now, blob, size));
+	EXPECT_FALSE(cache.find("a.b.d", now, blob, size));
+
+	// overwrite in place
+	EXPECT_TRUE(cache.insert("Bearer a.b.c", now + 100, "other payload", 13));
+	EXPECT_TRUE(cache.find("a.b.c", now, blob, size));
+	EXPECT_EQ(std::string("other payload"), std::string(blob, size));
+
+	// expiry is checked against caller time
+	EXPECT_FALSE(cache.find("a.b.c", now + 100, blob, size));
+
+	// already expired, too big
+	EXPECT_FALSE(cache.insert("x.y.z", now - 1, "p", 1));
+	std::string big(65, 'x');
+	EXPECT_FALSE(cache.insert("x.y.z", now + 100, big.data(), big.size()));
+
+	cache.clear();
+	EXPECT_FALSE(cache.find("a.b.c", now, blob, size));
+
+	EXPECT_TRUE(cache.insert("a.b.c", now + 100, "payload", 7));
+	EXPECT_TRUE(cache.find("a.b.c", now, blob, size));
+}
+
+TEST(jwtpp, token_cache_generation) {
+	jwtpp::shm_token_cache cache(16);
+
+	auto now = static_cast<uint64_t>(std::time(nullptr));
+	auto gen = cache.generation();
+
+	char   blob[64];
+	size_t size = 0;
+
+	// verdict reached before clear() is not cached
+	cache.clear();
+	EXPECT_NE(gen, cache.generation());
+	EXPECT_FALSE(cache.insert("a.b.c", now + 100, "payload", 7, gen));
+	EXPECT_FALSE(cache.find("a.b.c", now, blob, size));
+
+	auto bearer = "Bearer " + mint("alice", std::time(nullptr) + 60);
+	auto jws    = jwtpp::jws::parse(bearer);
+	EXPECT_FALSE(cache.insert(bearer, jws->claims(), gen));
+
+	gen = cache.generation();
+	EXPECT_TRUE(cache.insert("a.b.c", now + 100, "payload", 7, gen));
+	EXPECT_TRUE(cache.insert(bearer, jws->claims(), gen));
+	EXPECT_TRUE(cache.find("a.b.c", now, blob, size));
+	EXPECT_NE(nullptr, cache.find(bearer));
+}
+
+TEST(jwtpp, token_cache_claims) {
+	jwtpp::shm_token_cache cache(16);
+
+	auto bearer = "Bearer " + mint("alice", std::time(nullptr) + 60);
+
+	auto jws = jwtpp::jws::parse(bearer);
+	EXPECT_TRUE(cache.insert(bearer, jws->claims()));
+
+	auto hit = cache.find(bearer.substr(7));
+	ASSERT_NE(nullptr, hit);
+	EXPECT_EQ("alice", hit->get().sub());
+	EXPECT_EQ("jwtpp", hit->get().iss());
+
+	EXPECT_EQ(nullptr, cache.find(mint("bob", std::time(nullptr) + 60)));
+
+	// no exp, nothing to bound entry lifetime
+	jwtpp::claims noexp;
+	noexp.set().sub("carol");
+	auto tok = jwtpp::jws::sign_claims(noexp, std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256));
+	EXPECT_FALSE(cache.insert(tok, noexp));
+}
+
+TEST(jwtpp, token_cache_eviction) {
+	jwtpp::shm_token_cache cache(8, 8);
+
+	auto now = static_cast<uint64_t>(std::time(nullptr));
+
+	// more tokens than slots: table keeps working, latest inserts are found
+	for (int i = 0; i < 64; i++) {
+		EXPECT_TRUE(cache.insert("t" + std::to_string(i), now + 1000 + i, "p", 1));
+	}
+
+	char   blob[8];
+	size_t size = 0;
+
+	EXPECT_TRUE(cache.find("t63", now, blob, size));
+}
+
+TEST(jwtpp, token_cache_fork) {
+	jwtpp::shm_token_cache cache(64);
+
+	auto token = mint("alice", std::time(nullptr) + 60);
+
+	pid_t pid = fork();
+	ASSERT_NE(-1, pid);
+
+	if (pid == 0) {
+		auto jws = jwtpp::jws::parse("Bearer " + token);
+		_exit(cache.insert(token, jws->claims()) ? 0 : 1);
+	}
+
+	int status = 0;
+	ASSERT_EQ(pid, waitpid(pid, &status, 0));
+	ASSERT_TRUE(WIFEXITED(status));
+	ASSERT_EQ(0, WEXITSTATUS(status));
+
+	auto hit = cache.find(token);
+	ASSERT_NE(nullptr, hit);
+	EXPECT_EQ("alice", hit->get().sub());
+}
+
+TEST(jwtpp, token_cache_attach) {
+	std::string name = "/jwtpp-test-" + std::to_string(getpid());
+	jwtpp::shm_token_cache::unlink(name);
+
+	auto now = static_cast<uint64_t>(std::time(nullptr));
+
+	{
+		jwtpp::shm_token_cache a(name, 32, 64);
+		jwtpp::shm_token_cache b(name, 32, 64);
+		auto c = jwtpp::shm_token_cache::attach(a.fd());
+
+		EXPECT_TRUE(a.insert("a.b.c", now + 100, "payload", 7));
+
+		char   blob[64];
+		size_t size = 0;
+
+		EXPECT_TRUE(b.find("a.b.c", now, blob, size));
+		EXPECT_TRUE(c->find("a.b.c", now, blob, size));
+
+		b.clear();
+		EXPECT_FALSE(a.find("a.b.c", now, blob, size));
+
+		EXPECT_THROW(jwtpp::shm_token_cache(name, 64, 64), std::runtime_error);
+	}
+
+	jwtpp::shm_token_cache::unlink(name);
+}
+
+TEST(jwtpp, token_cache_concurrent) {
+	jwtpp::shm_token_cache cache(4, 64);
+
+	auto now = static_cast<uint64_t>(std::time(nullptr));
+
+	// each token maps to payload made of its own index, torn read would mix them
+	std::vector<std::string> tokens;
+	for (int i = 0; i < 16; i++) {
+		tokens.push_back("token" + std::to_string(i));
+	}
+
+	std::atomic<bool> stop(false);
+	std::atomic<int>  bad(0);
+
+	std::vector<std::thread> writers;
+	for (int w = 0; w < 2; w++) {
+		writers.emplace_back([&, w]() {
+			for (int n = 0; !stop.load(); n++) {
+				size_t      i = static_cast<size_t>(n * 2 + w) % tokens.size();
+				std::string payload(8 + i * 3, static_cast<char>('a' + i));
+				cache.insert(tokens[i], now + 100, payload.data(), payload.size());
+			}
+		});
+	}
+
+	for (int n = 0; n < 50000; n++) {
+		size_t i = static_cast<size_t>(n) % tokens.size();
+		char   blob[64];
+		size_t size = 0;
+
+		if (cache.find(tokens[i], now, blob, size)) {
+			if (size != 8 + i * 3 || std::string(blob, size) != std::string(size, static_cast<char>('a' + i))) {
+				bad++;
+			}
+		}
+	}
+
+	stop = true;
+	for (auto &t : writers) {
+		t.join();
+	}
+
+	EXPECT_EQ(0, bad.load());
+}
+
+#endif // defined(__linux__)
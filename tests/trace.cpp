@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <jwtpp/trace.hh>
+
+namespace {
+
+struct event {
+	bool                 begin;
+	jwtpp::stats::stage  stage;
+	jwtpp::alg_t         alg;
+	jwtpp::stats::result result;
+	uint64_t             ts;
+};
+
+thread_local std::vector<event> *tls_events = nullptr;
+
+} // namespace
+
+#if defined(JWTPP_WITH_TRACE)
+void jwtpp::trace::begin(jwtpp::stats::stage s, jwtpp::alg_t a, uint64_t ts) noexcept {
+	if (tls_events != nullptr) {
+		tls_events->push_back({true, s, a, jwtpp::stats::result::OK, ts});
+	}
+}
+
+void jwtpp::trace::end(jwtpp::stats::stage s, jwtpp::alg_t a, jwtpp::stats::result r, uint64_t ts) noexcept {
+	if (tls_events != nullptr) {
+		tls_events->push_back({false, s, a, r, ts});
+	}
+}
+#endif // defined(JWTPP_WITH_TRACE)
+
+TEST(jwtpp, trace_spans) {
+	using stage = jwtpp::stats::stage;
+	using result = jwtpp::stats::result;
+
+	auto c = std::make_shared<jwtpp::hmac>("secret", jwtpp::alg_t::HS256);
+
+	jwtpp::claims cl;
+	cl.set().sub("alice");
+
+	std::vector<event> events;
+	tls_events = &events;
+
+	auto bearer = jwtpp::jws::sign_bearer(cl, c);
+	auto j = jwtpp::jws::parse(bearer);
+	EXPECT_TRUE(j->verify(c, [](jwtpp::sp_claims) { return true; }));
+	EXPECT_FALSE(jwtpp::jws::parse(bearer)->verify(std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256)));
+	EXPECT_THROW(jwtpp::jws::parse("Bearer a.b.c"), std::exception);
+
+	tls_events = nullptr;
+
+	if (!jwtpp::trace::enabled()) {
+		EXPECT_TRUE(events.empty());
+		return;
+	}
+
+	// spans are properly nested and timestamps do not go back
+	std::vector<stage> open;
+	uint64_t           last = 0;
+
+	for (auto &e : events) {
+		EXPECT_GE(e.ts, last);
+		last = e.ts;
+
+		if (e.begin) {
+			open.push_back(e.stage);
+		} else {
+			ASSERT_FALSE(open.empty());
+			EXPECT_EQ(open.back(), e.stage);
+			open.pop_back();
+		}
+	}
+
+	EXPECT_TRUE(open.empty());
+
+	auto ends = [&](stage s) {
+		std::vector<event> out;
+		for (auto &e : events) {
+			if (!e.begin && e.stage == s) {
+				out.push_back(e);
+			}
+		}
+		return out;
+	};
+
+	auto sign = ends(stage::SIGN);
+	ASSERT_EQ(1, sign.size());
+	EXPECT_EQ(jwtpp::alg_t::HS256, sign[0].alg);
+	EXPECT_EQ(result::OK, sign[0].result);
+	EXPECT_EQ(1, ends(stage::CRYPTO_SIGN).size());
+
+	auto parse = ends(stage::PARSE);
+	ASSERT_EQ(3, parse.size());
+	EXPECT_EQ(jwtpp::alg_t::HS256, parse[0].alg);
+	EXPECT_EQ(result::OK, parse[0].result);
+	EXPECT_EQ(result::MALFORMED, parse[2].result);
+
+	// header and claims segments are decoded separately, third token fails at header
+	EXPECT_EQ(5, ends(stage::DECODE).size());
+
+	auto verify = ends(stage::VERIFY);
+	ASSERT_EQ(2, verify.size());
+	EXPECT_EQ(result::OK, verify[0].result);
+	EXPECT_EQ(result::BAD_SIGNATURE, verify[1].result);
+	EXPECT_EQ(2, ends(stage::CRYPTO_VERIFY).size());
+	EXPECT_EQ(1, ends(stage::POLICY).size());
+}
@@ -0,0 +1,148 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <jwtpp/verifier.hh>
+
+namespace {
+
+jwtpp::sp_keyset_holder make_holder(std::initializer_list<jwtpp::sp_crypto> keys) {
+	jwtpp::keyset ks;
+
+	for (auto &k : keys) {
+		ks.add(k);
+	}
+
+	return std::make_shared<jwtpp::keyset_holder>(std::move(ks));
+}
+
+std::string sign(const std::string &iss, jwtpp::sp_crypto c) {
+	jwtpp::claims cl;
+	cl.set().iss(iss);
+	cl.set().sub("alice");
+
+	return jwtpp::jws::sign_bearer(cl, c);
+}
+
+} // namespace
+
+TEST(jwtpp, verifier_routes_by_issuer) {
+	using status = jwtpp::issuer_verifier::status;
+
+	auto a1 = std::make_shared<jwtpp::hmac>("secret-a1", jwtpp::alg_t::HS256);
+	auto a2 = std::make_shared<jwtpp::hmac>("secret-a2", jwtpp::alg_t::HS384);
+	auto b1 = std::make_shared<jwtpp::hmac>("secret-b1", jwtpp::alg_t::HS256);
+	a1->kid("a1");
+	a2->kid("a2");
+	b1->kid("b1");
+
+	jwtpp::issuer_verifier v;
+
+	EXPECT_THROW(v.add("", make_holder({a1})), std::exception);
+	EXPECT_THROW(v.add("a", nullptr), std::exception);
+
+	v.add("https://a.example", make_holder({a1, a2}));
+	v.add("https://b.example", make_holder({b1}), [](jwtpp::sp_claims cl) {
+		return cl->check().sub("bob");
+	});
+
+	for (int i = 0; i < 300; i++) {
+		v.add("https://tenant" + std::to_string(i) + ".example", make_holder({b1}));
+	}
+
+	EXPECT_EQ(302, v.size());
+
+	jwtpp::sp_claims cl;
+
+	EXPECT_EQ(status::OK, v.verify(sign("https://a.example", a1), cl));
+	ASSERT_TRUE(cl != nullptr);
+	EXPECT_EQ("alice", cl->get().sub());
+
+	EXPECT_EQ(status::OK, v.verify(sign("https://a.example", a2)));
+	EXPECT_EQ(status::OK, v.verify(jwtpp::jws::sign_claims(*cl, a2)));
+	EXPECT_EQ(status::OK, v.verify(sign("https://tenant299.example", b1)));
+
+	EXPECT_EQ(status::POLICY, v.verify(sign("https://b.example", b1)));
+	EXPECT_EQ(status::UNKNOWN_ISSUER, v.verify(sign("https://c.example", a1)));
+	EXPECT_EQ(status::UNKNOWN_KEY, v.verify(sign("https://b.example", a1)));
+	EXPECT_EQ(status::MALFORMED, v.verify("Bearer abc"));
+
+	auto forged = std::make_shared<jwtpp::hmac>("other", jwtpp::alg_t::HS256);
+	forged->kid("a1");
+	EXPECT_EQ(status::BAD_SIGNATURE, v.verify(sign("https://a.example", forged)));
+
+	auto wrong_alg = std::make_shared<jwtpp::hmac>("secret-a1", jwtpp::alg_t::HS512);
+	wrong_alg->kid("a1");
+	EXPECT_EQ(status::ALG_MISMATCH, v.verify(sign("https://a.example", wrong_alg)));
+
+	EXPECT_TRUE(v.remove("https://a.example"));
+	EXPECT_FALSE(v.remove("https://a.example"));
+	EXPECT_EQ(status::UNKNOWN_ISSUER, v.verify(sign("https://a.example", a1)));
+	EXPECT_EQ(status::OK, v.verify(sign("https://tenant0.example", b1)));
+}
+
+TEST(jwtpp, verifier_kid_and_rotation) {
+	using status = jwtpp::issuer_verifier::status;
+
+	auto k1 = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	auto k2 = std::make_shared<jwtpp::hmac>("secret2", jwtpp::alg_t::HS256);
+	k1->kid("k1");
+	k2->kid("k2");
+
+	auto holder = make_holder({k1});
+
+	jwtpp::issuer_verifier v;
+	v.add("iss", holder);
+
+	// no kid is fine while issuer has single key
+	auto nokid = std::make_shared<jwtpp::hmac>("secret1", jwtpp::alg_t::HS256);
+	EXPECT_EQ(status::OK, v.verify(sign("iss", nokid)));
+
+	jwtpp::keyset ks;
+	ks.add(k1);
+	ks.add(k2);
+	holder->publish(std::move(ks));
+
+	EXPECT_EQ(status::UNKNOWN_KEY, v.verify(sign("iss", nokid)));
+	EXPECT_EQ(status::OK, v.verify(sign("iss", k2)));
+}
+
+TEST(jwtpp, verifier_duplicate_issuer) {
+	using status = jwtpp::issuer_verifier::status;
+
+	auto a = std::make_shared<jwtpp::hmac>("secret-a", jwtpp::alg_t::HS256);
+	a->kid("a");
+
+	jwtpp::issuer_verifier v;
+	v.add("a", make_holder({a}));
+	v.add("b", make_holder({a}));
+
+	// peek routes by first "iss", full parser keeps last one
+	std::string data = jwtpp::b64::encode_uri("{\"alg\":\"HS256\",\"kid\":\"a\",\"typ\":\"JWT\"}");
+	data += ".";
+	data += jwtpp::b64::encode_uri("{\"iss\":\"a\",\"iss\":\"b\"}");
+
+	EXPECT_EQ(status::MALFORMED, v.verify(data + "." + a->sign(data)));
+}
@@ -0,0 +1,503 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016-2020 Artur Troian
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// jwtpp-loadgen: token minting and verification load generator
+//
+// Mints a corpus of tokens with given alg, key size and claims size, then
+// verifies it from N threads, either flat out or at a target rate, and
+// reports throughput with latency percentiles. Replay mode verifies tokens
+// read from a file instead.
+//
+// With a target rate every thread follows its own fixed schedule and
+// latency is counted from the scheduled start, so stalls are not hidden
+// by the generator slowing down (coordinated omission).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openssl/obj_mac.h>
+
+#include <jwtpp/jwks.hh>
+#include <jwtpp/jwtpp.hh>
+#include <jwtpp/stats.hh>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+	std::string alg{"RS256"};
+	int         bits{0};
+	size_t      claims_size{0};
+	size_t      corpus{1000};
+	unsigned    threads{1};
+	double      rate{0};
+	double      duration{10};
+	uint64_t    count{0};
+	std::string replay;
+	std::string jwks;
+	std::string secret;
+	std::string out;
+	bool        json{false};
+};
+
+struct result {
+	std::string              name;
+	uint64_t                 ok{0};
+	uint64_t                 failed{0};
+	double                   elapsed{0};
+	jwtpp::stats::histogram  latency;
+};
+
+void usage(const char *prog) {
+	std::cerr <<
+		"usage: " << prog << " [options]\n"
+		"\n"
+		"mint and verify:\n"
+		"  --alg NAME           HS256..HS512, RS256..RS512, PS256..PS512, ES256..ES512, EdDSA (default RS256)\n"
+		"  --bits N             RSA/PSS modulus or HMAC secret size in bits (default 2048 / hash size)\n"
+		"  --claims-size BYTES  pad claims JSON to about this size\n"
+		"  --corpus N           number of distinct tokens to mint (default 1000)\n"
+		"  --out FILE           write minted tokens to FILE, one per line\n"
+		"\n"
+		"replay:\n"
+		"  --replay FILE        verify tokens from FILE, one per line, \"Bearer \" prefix optional\n"
+		"  --jwks FILE          keys to verify replayed tokens with, selected by kid\n"
+		"  --secret STRING      HMAC secret to verify replayed HSxxx tokens with\n"
+		"\n"
+		"load:\n"
+		"  --threads N          verifying threads (default 1)\n"
+		"  --rate R             target verifications per second over all threads, 0 = flat out (default 0)\n"
+		"  --duration SEC       verify phase length (default 10)\n"
+		"  --count N            stop verify phase after N verifications instead\n"
+		"  --json               print results as JSON\n";
+}
+
+options parse_args(int argc, char **argv) {
+	options o;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		std::string val;
+
+		auto eq = arg.find('=');
+		if (eq != std::string::npos) {
+			val = arg.substr(eq + 1);
+			arg.resize(eq);
+		}
+
+		auto next = [&]() -> const std::string & {
+			if (eq == std::string::npos) {
+				if (i + 1 >= argc) {
+					throw std::invalid_argument("missing value for " + arg);
+				}
+				val = argv[++i];
+			}
+			return val;
+		};
+
+		if (arg == "--help" || arg == "-h") {
+			usage(argv[0]);
+			std::exit(0);
+		} else if (arg == "--alg") {
+			o.alg = next();
+		} else if (arg == "--bits") {
+			o.bits = std::stoi(next());
+		} else if (arg == "--claims-size") {
+			o.claims_size = std::stoul(next());
+		} else if (arg == "--corpus") {
+			o.corpus = std::stoul(next());
+		} else if (arg == "--out") {
+			o.out = next();
+		} else if (arg == "--replay") {
+			o.replay = next();
+		} else if (arg == "--jwks") {
+			o.jwks = next();
+		} else if (arg == "--secret") {
+			o.secret = next();
+		} else if (arg == "--threads") {
+			o.threads = static_cast<unsigned>(std::stoul(next()));
+		} else if (arg == "--rate") {
+			o.rate = std::stod(next());
+		} else if (arg == "--duration") {
+			o.duration = std::stod(next());
+		} else if (arg == "--count") {
+			o.count = std::stoull(next());
+		} else if (arg == "--json") {
+			o.json = true;
+		} else {
+			throw std::invalid_argument("unknown option " + arg);
+		}
+	}
+
+	if (o.threads == 0) {
+		o.threads = 1;
+	}
+
+	if (o.corpus == 0) {
+		throw std::invalid_argument("--corpus must be positive");
+	}
+
+	if (!o.replay.empty() && o.jwks.empty() && o.secret.empty()) {
+		throw std::invalid_argument("--replay requires --jwks or --secret");
+	}
+
+	return o;
+}
+
+jwtpp::sp_crypto make_crypto(jwtpp::alg_t a, int bits) {
+	switch (a) {
+	case jwtpp::alg_t::HS256:
+	case jwtpp::alg_t::HS384:
+	case jwtpp::alg_t::HS512: {
+		if (bits == 0) {
+			bits = a == jwtpp::alg_t::HS256 ? 256 : a == jwtpp::alg_t::HS384 ? 384 : 512;
+		}
+
+		jwtpp::secure_string secret(static_cast<size_t>((bits + 7) / 8), '\0');
+		for (size_t i = 0; i < secret.size(); i++) {
+			secret[i] = static_cast<char>('a' + i % 26);
+		}
+
+		return std::make_shared<jwtpp::hmac>(secret, a);
+	}
+	case jwtpp::alg_t::RS256:
+	case jwtpp::alg_t::RS384:
+	case jwtpp::alg_t::RS512:
+		return std::make_shared<jwtpp::rsa>(jwtpp::rsa::gen(bits ? bits : 2048), a);
+	case jwtpp::alg_t::PS256:
+	case jwtpp::alg_t::PS384:
+	case jwtpp::alg_t::PS512:
+		return std::make_shared<jwtpp::pss>(jwtpp::rsa::gen(bits ? bits : 2048), a);
+	case jwtpp::alg_t::ES256:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_X9_62_prime256v1), a);
+	case jwtpp::alg_t::ES384:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_secp384r1), a);
+	case jwtpp::alg_t::ES512:
+		return std::make_shared<jwtpp::ecdsa>(jwtpp::ecdsa::gen(NID_secp521r1), a);
+#if defined(JWTPP_SUPPORTED_EDDSA)
+	case jwtpp::alg_t::EdDSA:
+		return std::make_shared<jwtpp::eddsa>(jwtpp::eddsa::gen(), a);
+#endif // defined(JWTPP_SUPPORTED_EDDSA)
+	default:
+		throw std::invalid_argument("unsupported alg");
+	}
+}
+
+jwtpp::sp_claims make_claims(size_t index, size_t claims_size) {
+	auto cl = std::make_shared<jwtpp::claims>();
+
+	cl->set().iss("https://loadgen.example");
+	cl->set().sub("user-" + std::to_string(index));
+	cl->set().aud("https://api.example");
+	cl->set().iat("1600000000");
+	cl->set().exp("4102444800");
+	cl->set().jti(std::to_string(index));
+
+	auto size = cl->b64().size() * 3 / 4;
+	if (claims_size > size + 10) {
+		// ,"pad":"..." adds 10 bytes of JSON around the value
+		cl->set().any("pad", std::string(claims_size - size - 10, 'x'));
+	}
+
+	return cl;
+}
+
+/**
+ * \brief Run op from every thread until deadline or total count is reached
+ *
+ * \param rate: total ops per second, 0 = flat out
+ * \param count: total ops, 0 = run for duration seconds
+ * \param op: op(thread, sequence), returns false on failure
+ */
+result run(const std::string &name, unsigned threads_count, double rate, uint64_t count, double duration,
+           const std::function<bool (unsigned, uint64_t)> &op) {
+	struct per_thread {
+		uint64_t                ok{0};
+		uint64_t                failed{0};
+		jwtpp::stats::histogram latency;
+	};
+
+	std::vector<per_thread>  stats(threads_count);
+	std::vector<std::thread> threads;
+	std::atomic<uint64_t>    issued(0);
+
+	auto interval = rate > 0
+		? std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(threads_count / rate))
+		: clock_type::duration::zero();
+
+	auto start = clock_type::now();
+	auto deadline = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(duration));
+
+	for (unsigned t = 0; t < threads_count; t++) {
+		threads.emplace_back([&, t]() {
+			auto &s = stats[t];
+
+			// stagger threads so scheduled starts are spread evenly
+			auto scheduled = start + interval * t / threads_count;
+
+			for (;;) {
+				uint64_t seq;
+
+				if (count != 0) {
+					seq = issued.fetch_add(1, std::memory_order_relaxed);
+					if (seq >= count) {
+						break;
+					}
+				} else {
+					seq = s.ok + s.failed;
+				}
+
+				clock_type::time_point begin;
+
+				if (interval != clock_type::duration::zero()) {
+					if (scheduled > clock_type::now()) {
+						std::this_thread::sleep_until(scheduled);
+					}
+					begin = scheduled;
+					scheduled += interval;
+				} else {
+					begin = clock_type::now();
+				}
+
+				if (count == 0 && begin >= deadline) {
+					break;
+				}
+
+				bool ok;
+
+				try {
+					ok = op(t, seq);
+				} catch (...) {
+					ok = false;
+				}
+
+				auto end = clock_type::now();
+
+				s.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+
+				if (ok) {
+					s.ok++;
+				} else {
+					s.failed++;
+				}
+			}
+		});
+	}
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	result r;
+	r.name = name;
+	r.elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+	for (auto &s : stats) {
+		r.ok += s.ok;
+		r.failed += s.failed;
+		r.latency.merge(s.latency);
+	}
+
+	return r;
+}
+
+void report(const result &r, bool json) {
+	auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+	double total = static_cast<double>(r.ok + r.failed);
+	double tput = r.elapsed > 0 ? total / r.elapsed : 0;
+
+	char buf[512];
+
+	if (json) {
+		std::snprintf(buf, sizeof(buf),
+			"{\"phase\":\"%s\",\"ok\":%llu,\"failed\":%llu,\"seconds\":%.3f,\"per_second\":%.1f,"
+			"\"latency_us\":{\"mean\":%.2f,\"p50\":%.2f,\"p99\":%.2f,\"p99.9\":%.2f,\"max\":%.2f}}",
+			r.name.c_str(),
+			static_cast<unsigned long long>(r.ok), static_cast<unsigned long long>(r.failed),
+			r.elapsed, tput,
+			r.latency.mean() / 1000.0,
+			us(r.latency.percentile(50)), us(r.latency.percentile(99)), us(r.latency.percentile(99.9)),
+			us(r.latency.max()));
+	} else {
+		std::snprintf(buf, sizeof(buf),
+			"%-8s %10llu ok %6llu failed %8.3f s %12.1f /s   latency us: mean %.2f p50 %.2f p99 %.2f p99.9 %.2f max %.2f",
+			r.name.c_str(),
+			static_cast<unsigned long long>(r.ok), static_cast<unsigned long long>(r.failed),
+			r.elapsed, tput,
+			r.latency.mean() / 1000.0,
+			us(r.latency.percentile(50)), us(r.latency.percentile(99)), us(r.latency.percentile(99.9)),
+			us(r.latency.max()));
+	}
+
+	std::cout << buf << std::endl;
+}
+
+std::vector<std::string> read_tokens(const std::string &path) {
+	std::ifstream in(path);
+	if (!in) {
+		throw std::runtime_error("cannot open " + path);
+	}
+
+	std::vector<std::string> tokens;
+	std::string              line;
+
+	while (std::getline(in, line)) {
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+			line.pop_back();
+		}
+
+		if (line.empty()) {
+			continue;
+		}
+
+		if (line.compare(0, 7, "Bearer ") != 0 && line.compare(0, 7, "bearer ") != 0) {
+			line.insert(0, "Bearer ");
+		}
+
+		tokens.push_back(std::move(line));
+	}
+
+	if (tokens.empty()) {
+		throw std::runtime_error(path + " holds no tokens");
+	}
+
+	return tokens;
+}
+
+result verify_phase(const options &o, const std::vector<std::string> &tokens,
+                    const std::function<jwtpp::sp_crypto (const jwtpp::sp_jws &)> &key) {
+	return run("verify", o.threads, o.rate, o.count, o.duration, [&](unsigned t, uint64_t seq) {
+		// threads walk the corpus from different offsets
+		auto &b = tokens[(seq + t * (tokens.size() / o.threads)) % tokens.size()];
+		auto  j = jwtpp::jws::parse(b);
+		auto  c = key(j);
+
+		return c && j->verify(c);
+	});
+}
+
+int replay(const options &o) {
+	auto tokens = read_tokens(o.replay);
+
+	jwtpp::keyset              ks;
+	std::vector<jwtpp::sp_crypto> secrets;
+
+	if (!o.jwks.empty()) {
+		ks = jwtpp::jwks::load_from_file(o.jwks);
+	}
+
+	if (!o.secret.empty()) {
+		for (auto a : {jwtpp::alg_t::HS256, jwtpp::alg_t::HS384, jwtpp::alg_t::HS512}) {
+			secrets.push_back(std::make_shared<jwtpp::hmac>(jwtpp::secure_string(o.secret.begin(), o.secret.end()), a));
+		}
+	}
+
+	auto r = verify_phase(o, tokens, [&](const jwtpp::sp_jws &j) -> jwtpp::sp_crypto {
+		for (auto &s : secrets) {
+			if (s->alg() == j->alg()) {
+				return s;
+			}
+		}
+
+		if (!j->kid().empty()) {
+			return ks.find(j->kid());
+		}
+
+		if (ks.size() == 1) {
+			return ks.keys().begin()->second;
+		}
+
+		return nullptr;
+	});
+
+	report(r, o.json);
+
+	return r.failed == 0 ? 0 : 2;
+}
+
+int mint_and_verify(const options &o) {
+	auto a = jwtpp::crypto::str2alg(o.alg);
+	if (a == jwtpp::alg_t::UNKNOWN || a == jwtpp::alg_t::NONE) {
+		throw std::invalid_argument("unknown alg " + o.alg);
+	}
+
+	auto c = make_crypto(a, o.bits);
+
+	std::vector<jwtpp::sp_claims> claims;
+	claims.reserve(o.corpus);
+
+	for (size_t i = 0; i < o.corpus; i++) {
+		claims.push_back(make_claims(i, o.claims_size));
+	}
+
+	std::vector<std::string> tokens(o.corpus);
+
+	auto m = run("mint", o.threads, 0, o.corpus, 0, [&](unsigned, uint64_t seq) {
+		tokens[seq] = jwtpp::jws::sign_bearer(*claims[seq], c);
+		return true;
+	});
+
+	report(m, o.json);
+
+	if (!o.out.empty()) {
+		std::ofstream out(o.out);
+		for (auto &t : tokens) {
+			out << t.substr(7) << '\n';
+		}
+
+		if (!out) {
+			throw std::runtime_error("cannot write " + o.out);
+		}
+	}
+
+	auto v = verify_phase(o, tokens, [&](const jwtpp::sp_jws &) { return c; });
+
+	report(v, o.json);
+
+	return (m.failed == 0 && v.failed == 0) ? 0 : 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	try {
+		auto o = parse_args(argc, argv);
+
+		return o.replay.empty() ? mint_and_verify(o) : replay(o);
+	} catch (const std::exception &e) {
+		std::cerr << "jwtpp-loadgen: " << e.what() << std::endl;
+		return 1;
+	}
+}